@@ -35,23 +35,39 @@ static inline int usypiaj_ms(unsigned ms)
 #define POLL_MS_MED 100
 #define POLL_MS_LONG 200
 
+/* Domyślne wymiary sali; w trakcie działania obowiązują wartości z nagłówka
+ * shm (uklad.h, RESTAURACJA_STOLIKI / _TASMA / _GRUP_NA_STOLIKU). */
 #define X1 10
 #define X2 10
 #define X3 10
 #define X4 10
+#define DLUGOSC_TASMY_DEFAULT 150
+#define GRUP_NA_STOLIKU_DEFAULT 4
 
-#define MAX_STOLIKI (X1 + X2 + X3 + X4)
+#define STOLIKI_MAX 100000 /* stolików jednej pojemności */
+#define DLUGOSC_TASMY_MAX 1000000
+#define GRUP_NA_STOLIKU_MAX 4 /* największy stolik ma 4 miejsca */
 
-#define MAX_TASMA 150
-#define MAX_KOLEJKA_MSG 1024
-#define KOLEJKA_REZERWA 5
+#define MAX_KOLEJKA 1024 /* pojemność pierścienia kolejki wejściowej (potęga 2) */
+/* Grupy usadzane przez szatnię pod jednym mutexem stolików
+ * (RESTAURACJA_SZATNIA_PARTIA, 1..MAX_KOLEJKA). */
+#define SZATNIA_PARTIA_DEFAULT 32
+/* Pas VIP w szatni: ile grup VIP na jedną zwykłą, gdy czekają obie
+ * (RESTAURACJA_WAGA_VIP, 0 = zwykłe dopiero bez VIP), i po ilu ms zwykła
+ * grupa przechodzi na pas VIP (RESTAURACJA_STARZENIE_MS, 0 = nigdy). */
+#define SZATNIA_WAGA_VIP_DEFAULT 4
+#define SZATNIA_STARZENIE_MS_DEFAULT 2000
+/* Odsetek grup VIP (RESTAURACJA_VIP_PROCENT, 0..100). */
+#define VIP_PROCENT_DEFAULT 2
+/* Procesy szatni (RESTAURACJA_SZATNIE); każdy ma swoją część sali
+ * (klasy pojemności), kolejkę wejściową i mutex stolików. */
+#define SZATNIE_MAX 4
 #define p10 10
 #define p15 15
 #define p20 20
 #define p40 40
 #define p50 50
 #define p60 60
-#define MAX_GRUP_NA_STOLIKU 4
 #define TP 10
 #define TK 20
 
@@ -79,11 +95,12 @@ struct Grupa
   int danie_specjalne;
 };
 
+/* Grupy siedzące przy stoliku leżą w osobnym regionie po
+ * `grup_na_stoliku` wpisów na stolik — zob. stolik_grupy(). */
 struct Stolik
 {
   int numer_stolika;
   int pojemnosc;
-  struct Grupa grupy[MAX_GRUP_NA_STOLIKU];
   int liczba_grup;
   int zajete_miejsca;
 };
@@ -94,63 +111,132 @@ struct Talerzyk
   int stolik_specjalny;
 };
 
+/* Budzik stolika: słowo futeksa, na którym śpią osoby przy stoliku czekające
+ * na danie. Obsługa podbija je tylko wtedy, gdy stolik ma co zdjąć z taśmy
+ * (talerz na swojej pozycji albo danie specjalne dla siebie). Każdy budzik
+ * na osobnej linii cache. */
+struct BudzikStolika
+{
+  int zdarzenia;
+  int czekajacy; // zwiększany pod mutexem taśmy przed zaśnięciem (tasma_zapisz_czekajacego)
+} __attribute__((aligned(64)));
+
 struct TasmaSync
 {
   pthread_mutex_t mutex;
   pthread_cond_t not_full;
-  pthread_cond_t not_empty;
   int count;
+  int glowa; /* pozycja fizyczna pozycji logicznej 0 (tasma.h) */
 };
 
+/* Jedna na szatnię: mutex chroni stoliki jej części sali (razem z ich
+ * grupami i indeksem wolnych miejsc). `cond` (zamówienia specjalne,
+ * otwarcie i zamknięcie) jest używany tylko w pierwszej, z jej mutexem. */
 struct StolikiSync
 {
-  pthread_mutex_t mutex;
+  pthread_mutex_t mutex __attribute__((aligned(64)));
   pthread_cond_t cond;
+  /* Całka zajętych miejsc części sali po czasie (miejsce·ns) do obłożenia;
+   * pod mutexem, aktualizuje stoliki_rozlicz_miejsca(). */
+  int zajete_miejsca;
+  long long ostatnia_zmiana_ns;
+  long long miejsca_ns;
 };
 
-struct QueueSync
+/* Budzenie korutyn klientów (RESTAURACJA_TRYB_KLIENTOW=korutyny) z innych
+ * procesów. Zadanie planisty czeka na słowie futeksa w segmencie
+ * (planista_czekaj) w kubełku wyznaczonym przez przesunięcie słowa, a kto to
+ * słowo zmienia, zaznacza kubełek w `kubelki` (korutyny_obudz()). Dowolny
+ * wątek planisty zdejmuje zaznaczenia i budzi zadania z tych kubełków;
+ * kolizje kubełków dają co najwyżej fałszywe przebudzenie. Bez
+ * zaparkowanych zadań zaznaczanie kończy się na odczycie `zaparkowane`. */
+#define KORUTYNY_KUBELKI 4096
+
+static inline unsigned int korutyny_kubelek(size_t przesuniecie)
 {
-  pthread_mutex_t mutex;
-  pthread_cond_t not_full;
-  pthread_cond_t not_empty;
-  int count;
-  int max;
-};
+  return (unsigned int)(((przesuniecie >> 2) * 2654435761u) >> 7) % KORUTYNY_KUBELKI;
+}
 
-struct StatystykiSync
+struct BudzeniaKorutyn
 {
-  pthread_mutex_t mutex;
+  int licznik __attribute__((aligned(64))); /* słowo futeksa wątków planisty */
+  int uspieni;
+  int zaparkowane __attribute__((aligned(64)));
+  /* Bit na słowo `kubelki`, w którym coś zaznaczono. */
+  unsigned long long podsumowanie __attribute__((aligned(64)));
+  unsigned long long kubelki[KORUTYNY_KUBELKI / 64] __attribute__((aligned(64)));
 };
 
-typedef struct // komunikat kolejki
+/* Licznik zdarzeń szatni (słowo futeksa), każdy na osobnej linii cache. */
+struct ZdarzeniaSzatni
+{
+  int licznik;
+} __attribute__((aligned(64)));
+
+/* Kolejka zleceń dla puli procesów `klient` (RESTAURACJA_TRYB_KLIENTOW=pula).
+ * Rodzic publikuje numery grup, pracownicy pobierają je CAS-em na `pobrane`.
+ * Oba liczniki są też słowami futeksa do usypiania producenta i pracowników. */
+#define PULA_ZLECENIA_MAX 256
+
+struct PulaKlientow
 {
-  long mtype;
-  struct Grupa grupa;
-} QueueMsg;
+  int opublikowane;
+  int pobrane;
+  int zlecenia[PULA_ZLECENIA_MAX];
+};
+
+struct Histogram;
+struct KolejkaGrup;
+struct SemaforShm;
+struct Statystyki;
 
 /* Centralny kontekst uruchomienia współdzielony przez wskaźniki w shm. */
 struct CommonCtx
 {
   int shm_id;
-  int sem_id;
-  int msgq_id;
+  struct SemaforShm *semafory; /* SEM_LICZBA semaforów futeksowych (semafor.h) */
+  /* Kopia wymiarów sali z nagłówka shm (uklad.h). */
+  int liczba_stolikow;
+  int dlugosc_tasmy;
+  int grup_na_stoliku;
+  int stoliki_wg_pojemnosci[4];
+  int liczba_szatni;
+  int granice_szatni[SZATNIE_MAX + 1]; /* szatnia s: stoliki [granice[s], granice[s + 1]) */
+  int szatnia_wg_osob[4];              /* kolejka dla grupy 1..4-osobowej */
   struct Stolik *stoliki;
+  struct Grupa *grupy_przy_stolikach; /* liczba_stolikow * grup_na_stoliku */
   int *restauracja_otwarta;
-  int *kuchnia_dania_wydane;
-  int *kasa_dania_sprzedane;
-  struct Talerzyk *tasma;
+  struct Talerzyk *tasma; /* dlugosc_tasmy pozycji, pierścień (tasma.h) */
   struct TasmaSync *tasma_sync;
-  struct StolikiSync *stoliki_sync;
-  struct QueueSync *queue_sync;
-  struct StatystykiSync *statystyki_sync;
+  struct BudzikStolika *budziki; /* jeden na stolik */
+  struct StolikiSync *stoliki_sync; /* [liczba_szatni] */
+  struct KolejkaGrup *kolejka; /* kolejki wejściowe grup, jedna na szatnię (kolejka.h) */
+  struct Statystyki *statystyki; /* liczniki przebiegu w shardach (statystyki.h) */
+  struct PulaKlientow *pula;
+  /* Czas od planowanego przybycia do usadzenia (zapisują klienci). */
+  struct Histogram *opoznienie_usadzenia;
+  /* Czas od usadzenia albo poprzedniego dania grupy do zdjęcia kolejnego. */
+  struct Histogram *oczekiwanie_na_danie;
+  /* Jak opoznienie_usadzenia, osobno dla grup 1..4-osobowych (indeks osoby-1). */
+  struct Histogram *usadzenie_wg_osob;
+  /* Jak wyżej, osobno dla pasa VIP i zwykłych grup (indeks KLASA_*, kolejka.h). */
+  struct Histogram *usadzenie_wg_klasy;
+  /* Planowany moment przybycia grupy (CLOCK_MONOTONIC, ns), indeks = numer
+   * grupy; klient zeruje wpis przy usadzeniu. Tablica jest ostatnia w shm. */
+  long long *przybycia_ns;
+  /* Skrzynka przydziału stolika, indeks = numer grupy (słowo futeksa):
+   * 0 = czeka, stolik + 1 = usadzona przez szatnię, -1 = grupa zrezygnowała. */
+  int *skrzynki;
   /* Usunięto: int *kolej_podsumowania; używamy semaforów tur. */
-  int *klienci_w_kolejce;
-  int *klienci_przyjeci;
-  int *klienci_opuscili;
+  char *segment;        /* początek segmentu (przesunięcia w budzenia_korutyn) */
+  struct BudzeniaKorutyn *budzenia_korutyn;
+  int *grupy_w_lokalu; /* grupy od wysłania do końca obsługi (słowo futeksa) */
+  /* Nowa grupa w kolejce / zwolnione miejsce, jeden na szatnię (futeks). */
+  struct ZdarzeniaSzatni *zdarzenia_szatni;
   pid_t pid_obsluga;
   pid_t pid_kucharz;
   pid_t pid_kierownik;
-  pid_t pid_szatnia;
+  pid_t pid_szatni[SZATNIE_MAX];
   pid_t *pid_obsluga_shm;
   pid_t *pid_kierownik_shm;
   int disable_close;
@@ -159,7 +245,33 @@ struct CommonCtx
 
 extern struct CommonCtx *common_ctx;
 
-extern const int ILOSC_STOLIKOW[4];
+/* Grupy przy stoliku `stolik` (indeks od 0); zajęte pierwsze liczba_grup. */
+static inline struct Grupa *stolik_grupy(int stolik)
+{
+  return common_ctx->grupy_przy_stolikach + (size_t)stolik * common_ctx->grup_na_stoliku;
+}
+
+/* Szatnia, do której części sali należy stolik `stolik`. */
+static inline int szatnia_stolika(int stolik)
+{
+  int s = common_ctx->liczba_szatni - 1;
+  while (s > 0 && stolik < common_ctx->granice_szatni[s])
+    s--;
+  return s;
+}
+
+/* Szatnia, która usadza grupy `osoby`-osobowe. */
+static inline int szatnia_grupy(int osoby)
+{
+  return (osoby >= 1 && osoby <= 4) ? common_ctx->szatnia_wg_osob[osoby - 1] : 0;
+}
+
+/* Mutex stolików części sali szatni `szatnia`. */
+static inline pthread_mutex_t *stoliki_mutex(int szatnia)
+{
+  return &common_ctx->stoliki_sync[szatnia].mutex;
+}
+
 extern const int CENY_DAN[6];
 
 /* Indeksy semaforów używane w modułach */
@@ -172,6 +284,7 @@ extern const int CENY_DAN[6];
 /* Semafory powiadomień dla rodzica (tury 2/3). */
 #define SEM_PARENT_NOTIFY2 5
 #define SEM_PARENT_NOTIFY3 6
+#define SEM_LICZBA 7
 
 /* Prototypy funkcji używanych między modułami. */
 void sem_operacja(int sem, int val);
@@ -180,15 +293,53 @@ void ustaw_shutdown_flag(volatile sig_atomic_t *flag);
 void ustaw_obsluge_sigterm(volatile sig_atomic_t *flag);
 void kierownik_zamknij_restauracje_i_zakoncz_klientow(void);
 void stworz_ipc(void);
-void dolacz_ipc(int shm_id_existing, int sem_id_existing);
+void dolacz_ipc(int shm_id_existing);
+void dolacz_ipc_fd(int shm_fd);
 int dolacz_ipc_z_argv(int argc, char **argv, int potrzebuje_grupy,
                       int *out_numer_grupy);
 int cena_na_indeks(int cena);
 int znajdz_stolik_dla_grupy_zablokowanej(const struct Grupa *g);
+/* Pod stoliki_mutex(szatnia): zajęte miejsca jej części sali zmieniły się
+ * o `zmiana`. */
+void stoliki_rozlicz_miejsca(int szatnia, int zmiana);
+/* Pod stoliki_mutex(szatnia_stolika(stolik)): usuwa grupę ze stolika
+ * (przesuwa pozostałe, zeruje zwolniony wpis) i rozlicza jej miejsca.
+ * Zwraca 0 albo -1, gdy grupy nie ma przy stoliku. */
+int stolik_usun_grupe(int stolik, const struct Grupa *g);
+/* Całka zajętych miejsc (miejsce·ns) całej sali do teraz; bierze po kolei
+ * mutexy stolików. */
+long long stoliki_miejsca_ns(void);
+/* Mutexy stolików wszystkich szatni, zawsze w kolejności numerów. */
+void stoliki_zablokuj_wszystkie(void);
+/* Zwalnia mutexy szatni 1.. — zostaje mutex pierwszej, z którym idzie
+ * stoliki_sync->cond. */
+void stoliki_odblokuj_pozostale(void);
 void czekaj_na_ture(int turn, volatile sig_atomic_t *shutdown);
 void sygnalizuj_ture_na(int turn);
 int sem_czekaj_sekund(int sem_idx, int seconds);
 int parsuj_int_lub_zakoncz(const char *what, const char *s);
 void zainicjuj_losowosc(void);
+int futex_czekaj(int *adres, int oczekiwana, int timeout_ms);
+void futex_obudz(int *adres, int ile);
+void korutyny_obudz(const int *adres);
+/* Czekanie na słowie futeksa: futex_czekaj albo planista_czekaj, które w
+ * zadaniu planisty parkuje korutynę zamiast wątku. */
+typedef int (*FunkcjaCzekania)(int *adres, int oczekiwana, int timeout_ms);
+int pula_opublikuj(int numer_grupy, volatile sig_atomic_t *stop);
+int pula_pobierz(volatile sig_atomic_t *shutdown);
+int grupy_zajmij(int limit, volatile sig_atomic_t *stop);
+void grupy_zwolnij(void);
+void szatnia_powiadom(int szatnia);
+/* RESTAURACJA_SZATNIA_PARTIA albo SZATNIA_PARTIA_DEFAULT (błąd: komunikat). */
+int szatnia_partia_z_env(void);
+/* RESTAURACJA_WAGA_VIP i RESTAURACJA_STARZENIE_MS, jak wyżej. */
+int szatnia_waga_vip_z_env(void);
+int szatnia_starzenie_ms_z_env(void);
+int vip_procent_z_env(void);
+int skrzynka_dostarcz(int numer_grupy, int stolik);
+int skrzynka_odbierz(int numer_grupy, int timeout_ms, FunkcjaCzekania czekaj);
+int skrzynka_odwolaj(int numer_grupy);
+void tasma_obudz_stolik(int stolik, int ile);
+void tasma_obudz_wszystkie(void);
 
 #endif /* COMMON_H */
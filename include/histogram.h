@@ -0,0 +1,29 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+// ====== INKLUDY ======
+#include <stddef.h>
+
+// Histogram czasów (w nanosekundach) o kubełkach log-liniowych: każda potęga
+// dwójki jest dzielona na 8 kubełków, więc percentyle mają błąd < 12.5%.
+// Struktura jest POD bez wskaźników — może leżeć w pamięci współdzielonej;
+// aktualizacje są atomowe (relaxed), więc wiele procesów może pisać naraz.
+
+#define HISTOGRAM_KUBELKI 496
+
+struct Histogram
+{
+    unsigned long long liczba;
+    unsigned long long suma;
+    unsigned long long min;
+    unsigned long long max;
+    unsigned long long kubelki[HISTOGRAM_KUBELKI];
+};
+
+void histogram_dodaj(struct Histogram *h, unsigned long long wartosc_ns);
+// Zwraca przybliżoną wartość percentyla `p` (0..100) w nanosekundach.
+unsigned long long histogram_percentyl(const struct Histogram *h, double p);
+// Dopisuje zwięzły opis (n, średnia, p50/p90/p99, max) w milisekundach.
+void histogram_opisz(const struct Histogram *h, char *buf, size_t rozmiar);
+
+#endif // HISTOGRAM_H
@@ -3,6 +3,15 @@
 
 #include "common.h"
 
+/* Numer grupy w argv oznaczający pracownika puli: proces nie obsługuje jednej
+ * grupy, tylko pobiera kolejne z `common_ctx->pula` aż do zamknięcia. */
+#define KLIENT_TRYB_PULA -1
+/* Numer grupy w argv oznaczający zygotę: proces czyta numery grup (int) ze
+ * standardowego wejścia i dla każdej robi fork() z gotowym IPC i logerem. */
+#define KLIENT_TRYB_ZYGOTA -2
+
 void klient(int numer_grupy);
+// Obsługuje jedną grupę bez kończenia procesu (tryb korutyn w `restauracja`).
+void klient_obsluz_grupe(int numer_grupy);
 
 #endif
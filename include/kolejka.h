@@ -0,0 +1,77 @@
+#ifndef KOLEJKA_H
+#define KOLEJKA_H
+
+// ====== INKLUDY ======
+#include "common.h"
+
+// Kolejka wejściowa grup: ograniczony pierścień MPMC w pamięci współdzielonej
+// (algorytm Vyukova — każda komórka ma numer sekwencyjny, więc wstawienie i
+// pobranie to jeden CAS na indeksie plus zapis/odczyt komórki). Do jądra
+// wchodzimy tylko przez futex, gdy klient musi zaczekać na wolne miejsce.
+//
+// Miejsca w kolejce to żetony (`wolne`): klient bierze żeton przed
+// wstawieniem, a szatnia oddaje go dopiero, gdy grupa na dobre opuści
+// szatnię (kolejka_zwolnij_miejsce). Szatnia pobiera grupy bez czekania
+// (kolejka_sprobuj_pobierz) na własne listy oczekujących — osobne dla
+// klasy i liczby osób — i tam grupa trzyma żeton, aż dostanie stolik. Nic
+// nie wraca do pierścienia, więc szatnia nie zależy od wolnego miejsca, a
+// o nowych grupach dowiaduje się z szatnia_powiadom(), nie z kolejki.
+//
+// Każda szatnia (RESTAURACJA_SZATNIE) ma własne pierścienie z własnymi
+// żetonami; wstawienie wybiera szatnię wg liczby osób (szatnia_grupy()), więc
+// grupa trafia od razu do szatni, która może ją usadzić. W szatni są dwa
+// pierścienie — pas VIP i zwykły — więc grupa VIP nie czeka na żeton za
+// pełną kolejką zwykłych grup; kolejność usadzania ustala szatnia (waga
+// pasa VIP i starzenie, szatnia.c).
+
+#define KOLEJKA_POJEMNOSC MAX_KOLEJKA
+
+enum KlasaKolejki
+{
+  KLASA_VIP = 0,
+  KLASA_ZWYKLA,
+  KLASY_KOLEJKI
+};
+
+static inline int klasa_grupy(const struct Grupa *g)
+{
+  return g->vip ? KLASA_VIP : KLASA_ZWYKLA;
+}
+
+struct KomorkaKolejki
+{
+  unsigned int sekwencja;
+  struct Grupa grupa;
+};
+
+struct KolejkaGrup
+{
+  unsigned int glowa __attribute__((aligned(64))); // następne wstawienie
+  unsigned int ogon __attribute__((aligned(64)));  // następne pobranie
+  /* Słowo futeksa: liczba wolnych żetonów. Obok licznik śpiących, żeby
+   * nie wołać FUTEX_WAKE na próżno. */
+  int wolne __attribute__((aligned(64)));
+  int czekajacy_na_miejsce;
+  struct KomorkaKolejki komorki[KOLEJKA_POJEMNOSC] __attribute__((aligned(64)));
+};
+
+// Wołać raz w rodzicu, zaraz po utworzeniu pamięci współdzielonej;
+// przygotowuje kolejki wszystkich szatni.
+void kolejka_inicjuj(void);
+// Wstawia grupę; przy braku miejsca czeka przez `czekaj` na słowie `wolne`
+// (futex_czekaj albo planista_czekaj w korutynie). Zwraca 0 albo -1, gdy
+// restauracja się zamyka lub ustawiono `stop`.
+int kolejka_wstaw(const struct Grupa *g, volatile sig_atomic_t *stop, FunkcjaCzekania czekaj);
+// Pobiera grupę z pierścienia klasy `klasa` szatni `szatnia` bez czekania;
+// -1 przy pustym. Żeton zostaje przy wołającym — oddać go trzeba przez
+// kolejka_zwolnij_miejsce().
+int kolejka_sprobuj_pobierz(int szatnia, int klasa, struct Grupa *g);
+void kolejka_zwolnij_miejsce(int szatnia, int klasa);
+// To samo dla `ile` żetonów naraz (partia szatni): jeden atomowy add.
+void kolejka_zwolnij_miejsca(int szatnia, int klasa, int ile);
+// Przybliżona liczba grup we wszystkich kolejkach.
+int kolejka_dlugosc(void);
+// Budzi klientów czekających na miejsce (zamknięcie restauracji).
+void kolejka_obudz_wszystkich(void);
+
+#endif // KOLEJKA_H
@@ -0,0 +1,49 @@
+#ifndef PLANISTA_H
+#define PLANISTA_H
+
+// ====== INKLUDY ======
+#include <stddef.h>
+
+// Planista zadań M:N: lekkie korutyny (ucontext) wykonywane przez pulę
+// wątków roboczych z kradzieżą pracy. Używany przez tryb klientów
+// "korutyny", w którym `restauracja` obsługuje wszystkie grupy w jednym
+// procesie zamiast uruchamiać proces `klient` na grupę.
+//
+// Zasady dla kodu działającego w zadaniu:
+// - nie blokuj wątku (sigsuspend, futex_czekaj, długie pthread_cond_wait) —
+//   zamiast tego wołaj planista_czekaj()/planista_uspij_ms(); zadanie
+//   czeka poza kolejką, aż obudzi je korutyny_obudz() albo termin,
+// - nie trzymaj mutexów przez planista_ustap() (zadanie może wrócić na
+//   innym wątku).
+
+#define PLANISTA_STOS_ROZMIAR (64 * 1024)
+
+typedef void (*PlanistaFunkcja)(void *arg);
+
+// Uruchamia `watki` wątków roboczych (<= 0: liczba rdzeni). Zwraca 0 przy
+// sukcesie, -1 przy błędzie.
+int planista_start(int watki);
+// Dodaje zadanie do kolejki. Zwraca 0 przy sukcesie, -1 przy braku pamięci.
+int planista_dodaj(PlanistaFunkcja fn, void *arg);
+// Oddaje wątek innym zadaniom; zadanie wraca do kolejki.
+void planista_ustap(void);
+// Usypia zadanie na co najmniej `ms` milisekund bez blokowania wątku.
+void planista_uspij_ms(unsigned ms);
+// Odpowiednik futex_czekaj() dla słów w segmencie, po których zmianie ktoś
+// woła korutyny_obudz(): w zadaniu parkuje je do obudzenia lub upływu
+// `timeout_ms` (< 0: bez limitu), poza zadaniem woła futex_czekaj(). Zwraca
+// 0 po obudzeniu lub zmianie wartości, -1 po upływie limitu.
+int planista_czekaj(int *adres, int oczekiwana, int timeout_ms);
+// Zwraca 1, gdy kod wykonuje się wewnątrz zadania planisty.
+int planista_w_zadaniu(void);
+// Czeka do `sekundy` na zakończenie wszystkich zadań i zatrzymuje wątki.
+// Zwraca liczbę zadań, które nie zdążyły się zakończyć.
+int planista_zatrzymaj(int sekundy);
+
+// Statystyki do podsumowania.
+int planista_liczba_watkow(void);
+long planista_zadania_utworzone(void);
+long planista_zadania_szczyt(void);
+long planista_kradziezy(void);
+
+#endif // PLANISTA_H
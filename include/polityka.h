@@ -0,0 +1,41 @@
+#ifndef POLITYKA_H
+#define POLITYKA_H
+
+// ====== INKLUDY ======
+#include "common.h"
+
+// Polityka wyboru stolika dla grupy (szatnia). Wybór przez
+// RESTAURACJA_POLITYKA — każdy proces czyta ją ze środowiska sam, jak
+// ustawienia segmentu:
+//   pierwszy       — first-fit: stolik o najniższym numerze, który pomieści
+//                    grupę (domyślnie, zachowanie sprzed wprowadzenia polityk),
+//   najlepszy      — best-fit: stolik z najmniejszą liczbą wolnych miejsc,
+//                    która jeszcze wystarcza,
+//   klasa          — najmniejsza klasa pojemności >= liczba osób, w niej
+//                    first-fit; większe stoliki dopiero, gdy klasa jest pełna,
+//   bez_dzielenia  — najpierw pusty stolik najmniejszej wystarczającej
+//                    pojemności, a dosiadanie się do innej grupy (best-fit)
+//                    dopiero, gdy pustego nie ma.
+// Wszystkie korzystają z indeksu wolnych miejsc (wolne_miejsca.h), więc koszt
+// nie zależy od wielkości sali. Grupa szuka tylko w części sali szatni, do
+// której trafia (szatnia_grupy()).
+
+enum PolitykaUsadzania
+{
+    POLITYKA_PIERWSZY = 0,
+    POLITYKA_NAJLEPSZY,
+    POLITYKA_KLASA,
+    POLITYKA_BEZ_DZIELENIA,
+    POLITYKA_LICZBA
+};
+
+enum PolitykaUsadzania polityka_biezaca(void);
+const char *polityka_nazwa(enum PolitykaUsadzania p);
+// Indeks stolika dla grupy wg bieżącej polityki albo -1; wołać pod
+// stoliki_mutex(szatnia_grupy(g->osoby)).
+int polityka_znajdz_stolik(const struct Grupa *g);
+// To samo dla wskazanej polityki w całej sali (benchmark porównuje ze
+// skanem); wołać pod mutexami wszystkich szatni.
+int polityka_znajdz_wg(enum PolitykaUsadzania p, int osoby);
+
+#endif // POLITYKA_H
@@ -0,0 +1,52 @@
+#ifndef PRZYBYCIA_H
+#define PRZYBYCIA_H
+
+// ====== INKLUDY ======
+#include "histogram.h"
+
+#include <signal.h>
+
+// Generator przybyć w pętli otwartej. Każda grupa ma planowany moment
+// przybycia wyliczony z profilu (RESTAURACJA_PRZYBYCIA) i tempa
+// (RESTAURACJA_TEMPO, RESTAURACJA_TEMPO_MAX, w grupach/s), niezależny od
+// tego, jak szybko generator faktycznie nadąża. Opóźnienia mierzymy od
+// planowanego momentu, więc przyblokowany generator nie ukrywa kolejki
+// (brak „coordinated omission”).
+
+enum ProfilPrzybyc
+{
+    PRZYBYCIA_BRAK = 0,    // bez harmonogramu: wszystkie grupy od razu
+    PRZYBYCIA_STALY = 1,   // stałe tempo
+    PRZYBYCIA_POISSON = 2, // odstępy wykładnicze o średniej 1/tempo
+    PRZYBYCIA_SCHODEK = 3, // tempo w 1. połowie czasu pracy, tempo_max w 2.
+    PRZYBYCIA_RAMPA = 4,   // liniowo od tempo do tempo_max w czasie pracy
+};
+
+struct PrzybyciaStat
+{
+    enum ProfilPrzybyc profil;
+    double tempo;
+    double tempo_max;
+    long wyslane;
+    long long pierwszy_ns;
+    long long ostatni_ns;
+    struct Histogram opoznienie_generatora; // faktyczne - planowane wysłanie
+};
+
+// Wczytuje profil z env; `czas_pracy_s` wyznacza przebieg schodka/rampy.
+void przybycia_inicjuj(int czas_pracy_s);
+// Ustala początek harmonogramu (CLOCK_MONOTONIC, teraz).
+void przybycia_start(void);
+// Zwraca planowany moment (ns, CLOCK_MONOTONIC) kolejnego przybycia.
+// Bezpieczne dla wielu wątków generatora.
+long long przybycia_nastepny(void);
+// Śpi do `planowany_ns` (TIMER_ABSTIME), sprawdzając `stop` co POLL_MS_MED.
+// Zwraca 0 po dotarciu do terminu, -1 gdy ustawiono `stop`.
+int przybycia_czekaj_do(long long planowany_ns, volatile sig_atomic_t *stop);
+// Zapisuje faktyczne wysłanie grupy zaplanowanej na `planowany_ns`.
+void przybycia_zapisz_wyslanie(long long planowany_ns);
+const struct PrzybyciaStat *przybycia_statystyki(void);
+const char *przybycia_nazwa_profilu(enum ProfilPrzybyc p);
+long long przybycia_teraz_ns(void);
+
+#endif // PRZYBYCIA_H
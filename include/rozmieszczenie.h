@@ -0,0 +1,43 @@
+#ifndef ROZMIESZCZENIE_H
+#define ROZMIESZCZENIE_H
+
+// ====== INKLUDY ======
+#include "zbieracz.h"
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Polityka rozmieszczenia procesów na rdzeniach (sched_setaffinity).
+// RESTAURACJA_AFINICZNOSC wybiera strategię:
+//   brak         — bez przypinania (domyślnie),
+//   zwarte       — role na kolejnych rdzeniach od pierwszego (obsługa i
+//                  szatnia sąsiadują, dzieląc cache taśmy i stolików),
+//                  klienci wspólnie na pozostałych rdzeniach,
+//   rozproszone  — role rozstawione równo po dostępnych rdzeniach, każdy
+//                  proces klienta przypięty do jednego z pozostałych
+//                  rdzeni po kolei.
+// RESTAURACJA_RDZENIE_ROL="o,s,k,m" nadpisuje rdzenie ról (obsluga,
+// szatnia, kucharz, kierownik). Rdzenie spoza maski startowej rodzica są
+// odrzucane. Gdy dla klientów nie zostaje żaden rdzeń, dostają wszystkie.
+
+enum StrategiaRozmieszczenia
+{
+    ROZMIESZCZENIE_BRAK = 0,
+    ROZMIESZCZENIE_ZWARTE = 1,
+    ROZMIESZCZENIE_ROZPROSZONE = 2,
+};
+
+// Wczytuje strategię z env i wylicza rdzenie ról oraz klientów.
+void rozmieszczenie_inicjuj(void);
+// Przypina proces pomocniczy `pid` do rdzenia jego roli.
+void rozmieszczenie_przypnij_role(pid_t pid, enum RolaProcesu rola);
+// Przypina proces klienta `pid`; `indeks` (numer grupy / pracownika)
+// wybiera rdzeń w strategii rozproszonej.
+void rozmieszczenie_przypnij_klienta(pid_t pid, long indeks);
+// Ogranicza bieżący proces (rodzica) do rdzeni klientów, żeby wątki
+// korutyn i dzieci zygoty nie wchodziły na rdzenie ról.
+void rozmieszczenie_przypnij_rodzica(void);
+// Opis do podsumowania, np. "rozproszone (obsluga 0, szatnia 2, ...)".
+void rozmieszczenie_opisz(char *buf, size_t rozmiar);
+
+#endif // ROZMIESZCZENIE_H
@@ -0,0 +1,44 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+// ====== INKLUDY ======
+#include <stddef.h>
+
+// Zaplecze segmentu pamięci współdzielonej. RESTAURACJA_SHM wybiera:
+//   sysv   — shmget/shmat, identyfikator w argv dzieci (domyślnie),
+//   memfd  — memfd_create + mmap,
+//   posix  — shm_open + mmap (nazwa od razu usuwana przez shm_unlink).
+// Przy memfd i posix dzieci nie dostają identyfikatora, tylko deskryptor:
+// silnik uruchamiania wstawia go jako FD 3 (URUCHAMIANIE_FD_PRZEKAZANY), a
+// w argv zamiast numeru jest "fd:3". Pamięć znika razem z ostatnim
+// procesem, więc nie ma czego sprzątać po awarii.
+//
+// RESTAURACJA_SHM_STRONY=zwykle|huge|thp: `huge` próbuje MFD_HUGETLB /
+// SHM_HUGETLB (przy braku zarezerwowanych stron wraca do zwykłych + THP),
+// `thp` tylko madvise(MADV_HUGEPAGE).
+// RESTAURACJA_SHM_PREFAULT=0|populate|mlock: `populate` wstępnie mapuje
+// strony w każdym procesie (MAP_POPULATE / MADV_POPULATE_WRITE), `mlock`
+// dodatkowo blokuje je w pamięci.
+
+enum BackendSegmentu
+{
+    SEGMENT_SYSV = 0,
+    SEGMENT_MEMFD = 1,
+    SEGMENT_POSIX = 2,
+};
+
+// Tworzy segment `rozmiar` bajtów (wyzerowany przez jądro) i zwraca jego
+// adres; przy błędzie kończy proces. Dla sysv ustawia common_ctx->shm_id,
+// dla pozostałych -1.
+void *segment_utworz(size_t rozmiar);
+// Dołączenie w dziecku po exec(); zwraca adres albo NULL.
+void *segment_dolacz_sysv(int shm_id);
+void *segment_dolacz_fd(int fd);
+// FD do przekazania dzieciom (-1 dla sysv).
+int segment_fd(void);
+// Argument dla dzieci: numer shm albo "fd:3".
+void segment_argument(char *buf, size_t rozmiar);
+// Opis do podsumowania, np. "memfd, 2.0 MiB, strony huge, prefault populate".
+void segment_opisz(char *buf, size_t rozmiar);
+
+#endif // SEGMENT_H
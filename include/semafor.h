@@ -0,0 +1,31 @@
+#ifndef SEMAFOR_H
+#define SEMAFOR_H
+
+// ====== INKLUDY ======
+#include <signal.h>
+
+// Semafor liczący w pamięci współdzielonej na słowie futeksa (zastępuje
+// zestaw semaforów SysV). `wartosc` to liczba żetonów; podniesienie to jeden
+// atomowy add, a FUTEX_WAKE idzie tylko wtedy, gdy ktoś śpi. Oczekiwanie ma
+// prawdziwy limit czasu (CLOCK_MONOTONIC) zamiast odpytywania, a że futex
+// z limitem wraca z EINTR po obsłudze sygnału, flaga `stop` ustawiona w
+// handlerze jest widoczna od razu.
+//
+// W odróżnieniu od semop(SEM_UNDO) żeton podniesiony przez proces, który
+// potem się kończy, zostaje — rodzic nie gubi powiadomień od dzieci.
+
+struct SemaforShm
+{
+    int wartosc;   // słowo futeksa
+    int czekajacy; // śpiący w semafor_opusc()
+} __attribute__((aligned(64)));
+
+void semafor_inicjuj(struct SemaforShm *s, int wartosc);
+void semafor_podnies(struct SemaforShm *s, int ile);
+// Zdejmuje żeton bez czekania; 0 przy sukcesie, -1 gdy semafor jest pusty.
+int semafor_sprobuj(struct SemaforShm *s);
+// Czeka na żeton najwyżej `timeout_ms` (< 0: bez limitu). Zwraca 0 po
+// zdjęciu żetonu, -1 po czasie albo gdy `stop` (może być NULL) jest ustawione.
+int semafor_opusc(struct SemaforShm *s, int timeout_ms, volatile sig_atomic_t *stop);
+
+#endif // SEMAFOR_H
@@ -0,0 +1,42 @@
+#ifndef STATYSTYKI_H
+#define STATYSTYKI_H
+
+// ====== INKLUDY ======
+#include "common.h"
+
+// Liczniki przebiegu rozbite na shardy wg rdzenia (sched_getcpu): każdy
+// piszący dodaje relaxed-atomowo do shardu swojego rdzenia, więc klienci,
+// szatnia i obsługa na różnych rdzeniach nie dzielą linii cache ani żadnego
+// mutexu. Sumujemy tylko przy raportowaniu (podsumowania).
+
+#define STATYSTYKI_SHARDY 64
+
+enum LicznikStatystyk
+{
+    STAT_KLIENCI_PRZYJECI = 0,
+    STAT_KLIENCI_OPUSCILI,
+    STAT_KLIENCI_W_KOLEJCE, // pierścień + listy szatni; w shardzie różnica, suma >= 0
+    STAT_GRUPY_OBSLUZONE,
+    STAT_GRUPY_USADZONE,
+    STAT_SZATNIA_PARTIE, // sekcje krytyczne stolików, w których szatnia usadziła grupy
+    STAT_SZATNIA_POSTARZONE, // zwykłe grupy usadzone z pasa VIP po starzeniu
+    STAT_SZATNIA_USADZONE,                          // + numer szatni (0..SZATNIE_MAX-1)
+    STAT_DANIA_WYDANE = STAT_SZATNIA_USADZONE + SZATNIE_MAX, // + indeks ceny (0..5)
+    STAT_DANIA_SPRZEDANE = STAT_DANIA_WYDANE + 6, // + indeks ceny (0..5)
+    STAT_LICZBA = STAT_DANIA_SPRZEDANE + 6
+};
+
+struct ShardStatystyk
+{
+    long long liczniki[STAT_LICZBA];
+} __attribute__((aligned(64)));
+
+struct Statystyki
+{
+    struct ShardStatystyk shardy[STATYSTYKI_SHARDY];
+};
+
+void statystyki_dodaj(enum LicznikStatystyk licznik, long long ile);
+long long statystyki_suma(enum LicznikStatystyk licznik);
+
+#endif // STATYSTYKI_H
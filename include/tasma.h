@@ -0,0 +1,102 @@
+#ifndef TASMA_H
+#define TASMA_H
+
+// ====== INKLUDY ======
+#include <stddef.h>
+#include <stdint.h>
+
+// Taśma jako pierścień z ruchomą głową. Pozycja logiczna p (ta przed
+// stolikiem p + 1, dla p < liczba stolików) leży w
+// tasma[(glowa + p) % dlugosc_tasmy], a `glowa` jest w TasmaSync. Obrót o
+// jedną pozycję to glowa - 1 zamiast przepisania całej tablicy.
+//
+// Dodanie dania obraca taśmę tak jak dawniej — o najmniejszą liczbę
+// pozycji >= 1, po której pozycja 0 jest pusta — czyli głowa przechodzi na
+// najwyższą wolną pozycję logiczną. Tę wskazuje indeks wolnych pozycji
+// (REGION_TASMA_WOLNE): trzypoziomowa mapa bitowa po pozycjach fizycznych,
+// jak w wolne_miejsca.h, przeszukiwana od góry __builtin_clzll. Poziom 2
+// ma najwyżej TASMA_SLOWA_L2_MAX słowa, więc dodanie kosztuje stałą liczbę
+// operacji niezależnie od długości taśmy.
+//
+// Danie leży na swojej pozycji fizycznej aż do zdjęcia, więc dania specjalne
+// stolika trzymamy na liście tych pozycji (REGION_TASMA_SPECJALNE, ogniwa w
+// REGION_TASMA_NASTEPNY): klient sprawdza, czy czeka na niego danie i
+// gdzie, bez przeglądania taśmy.
+//
+// Budzenie po dodaniu dania też nie przegląda stolików. Obrót przesuwa
+// wszystkie talerze względem stolików, więc licznik zwykłych dań na stolik
+// trzeba by przepisywać przy każdym dodaniu; zamiast tego trzymamy bit na
+// pozycję fizyczną z zwykłym daniem (REGION_TASMA_ZWYKLE) i bit na stolik,
+// przy którym ktoś śpi (REGION_STOLIKI_CZEKAJACE, dwa poziomy). Stoliki do
+// obudzenia to iloczyn słowa śpiących stolików z 64 bitami zwykłych dań
+// przesuniętymi o głowę — słowo na 64 stoliki, i tylko dla niepustych słów.
+// Nowe danie specjalne budzi tylko swój stolik.
+
+#define TASMA_SLOWA_L2_MAX 4 // 4 * 64^3 >= DLUGOSC_TASMY_MAX
+
+// Liczba słów 64-bitowych indeksu dla taśmy o `dlugosc` pozycjach.
+static inline size_t tasma_wolne_slowa(int dlugosc)
+{
+    size_t w0 = ((size_t)(dlugosc > 0 ? dlugosc : 0) + 63) / 64;
+    size_t w1 = (w0 + 63) / 64;
+    return w0 + w1 + (w1 + 63) / 64;
+}
+
+static inline size_t tasma_wolne_rozmiar(int dlugosc)
+{
+    return sizeof(uint64_t) * tasma_wolne_slowa(dlugosc);
+}
+
+static inline size_t tasma_zwykle_rozmiar(int dlugosc)
+{
+    return sizeof(uint64_t) * (((size_t)(dlugosc > 0 ? dlugosc : 0) + 63) / 64);
+}
+
+// Słowo na 64 stoliki plus poziom wyżej: bit na niepuste słowo.
+static inline size_t tasma_czekajace_rozmiar(int stoliki)
+{
+    size_t w = ((size_t)(stoliki > 0 ? stoliki : 0) + 63) / 64;
+    return sizeof(uint64_t) * (w + (w + 63) / 64);
+}
+
+// Dania specjalne dla jednego stolika. Pozycje są fizyczne + 1 (0 = koniec
+// listy), więc wyzerowany segment to puste listy; najnowsze danie pierwsze.
+struct SpecjalneStolika
+{
+    int pierwsza;
+    int liczba;
+};
+
+// Podpina indeksy w bieżącym procesie; nie zmienia zawartości. `wolne` ma
+// tasma_wolne_rozmiar() bajtów, `specjalne` wpis na stolik, `nastepny`
+// ogniwo na pozycję taśmy, `zwykle` tasma_zwykle_rozmiar(), a `czekajace`
+// tasma_czekajace_rozmiar(). Taśma, jej długość, stoliki i budziki z
+// common_ctx.
+void tasma_przypisz(uint64_t *wolne, struct SpecjalneStolika *specjalne, int *nastepny,
+                    uint64_t *zwykle, uint64_t *czekajace);
+// Poniższe wołać pod mutexem taśmy.
+// Przelicza indeksy i licznik dań z zawartości common_ctx->tasma; nikt nie
+// śpi.
+void tasma_odbuduj(void);
+// Talerzyk na pozycji logicznej `p` (0..dlugosc_tasmy - 1).
+struct Talerzyk *tasma_pozycja(int p);
+// Obraca taśmę do najbliższej wolnej pozycji i kładzie na pozycji 0 danie
+// (`stolik_specjalny` = 0 dla zwykłego). Wymaga wolnej pozycji
+// (tasma_sync->count < dlugosc_tasmy).
+void tasma_poloz(int cena, int stolik_specjalny);
+// Zdejmuje danie z pozycji logicznej `p`.
+void tasma_zdejmij(int p);
+// Pozycja logiczna najnowszego dania specjalnego dla stolika `stolik`
+// (indeks od 0) albo -1; O(1).
+int tasma_specjalne_stolika(int stolik);
+// Liczba dań specjalnych dla stolika `stolik` na taśmie.
+int tasma_specjalne_liczba(int stolik);
+// Osoba przy stoliku `stolik` zasypia na jego budziku (zwiększa `czekajacy`).
+// Zmniejsza go sama po obudzeniu, już bez mutexa.
+void tasma_zapisz_czekajacego(int stolik);
+// Po tasma_poloz(cena, stolik_specjalny): budzi stoliki ze śpiącymi
+// osobami, przed którymi stoi teraz zwykłe danie, i stolik nowego dania
+// specjalnego.
+void tasma_powiadom_stoliki(int stolik_specjalny);
+
+#endif // TASMA_H
@@ -0,0 +1,103 @@
+#ifndef UKLAD_H
+#define UKLAD_H
+
+// ====== INKLUDY ======
+#include <stddef.h>
+#include <stdint.h>
+
+// Układ segmentu pamięci współdzielonej. Na początku segmentu leży nagłówek
+// z magią, wersją i tablicą przesunięć regionów; dołączający proces
+// sprawdza magię i wersję, a wskaźniki w CommonCtx wylicza z tablicy, nie
+// z własnej arytmetyki. Każdy region pisany niezależnie (inny proces, inny
+// mutex albo słowo futeksa) zaczyna się na granicy linii cache i jest
+// dopełniony do jej wielokrotności, żeby liczniki nie dzieliły linii z
+// gorącymi mutexami. `make uklad` wypisuje tabelę regionów.
+//
+// Wymiary sali (stoliki, taśma, grupy na stolik) są ustalane przy starcie
+// i zapisane w nagłówku; dzieci biorą je stamtąd, nie ze środowiska.
+
+#define UKLAD_MAGIA 0x52535431u // "RST1"
+#define UKLAD_WERSJA 13
+#define UKLAD_LINIA 64
+
+enum RegionShm
+{
+    REGION_NAGLOWEK = 0,
+    REGION_STOLIKI,
+    REGION_GRUPY_PRZY_STOLIKACH,
+    REGION_WOLNE_MIEJSCA,
+    REGION_TASMA,
+    REGION_TASMA_WOLNE,
+    REGION_TASMA_SPECJALNE,
+    REGION_TASMA_NASTEPNY,
+    REGION_TASMA_ZWYKLE,
+    REGION_OTWARTA,
+    REGION_GRUPY_W_LOKALU,
+    REGION_ZDARZENIA_SZATNI,
+    REGION_PIDY,
+    REGION_STOLIKI_SYNC,
+    REGION_TASMA_SYNC,
+    REGION_BUDZIKI,
+    REGION_STOLIKI_CZEKAJACE,
+    REGION_SEMAFORY,
+    REGION_STATYSTYKI,
+    REGION_PULA,
+    REGION_KOLEJKA,
+    REGION_HISTOGRAM,
+    REGION_HISTOGRAM_DANIA,
+    REGION_HISTOGRAM_WG_OSOB,
+    REGION_HISTOGRAM_WG_KLASY,
+    REGION_SKRZYNKI,
+    REGION_BUDZENIA_KORUTYN,
+    REGION_PRZYBYCIA,
+    REGION_LICZBA
+};
+
+struct RegionOpis
+{
+    uint32_t przesuniecie;
+    uint32_t rozmiar; // bez dopełnienia do linii
+};
+
+// Wymiary sali. Domyślne wartości to X1..X4, DLUGOSC_TASMY_DEFAULT i
+// GRUP_NA_STOLIKU_DEFAULT z common.h; zmienne środowiskowe:
+//   RESTAURACJA_STOLIKI="a,b,c,d"    — liczba stolików 1-, 2-, 3- i 4-osobowych,
+//   RESTAURACJA_TASMA=n              — liczba pozycji taśmy,
+//   RESTAURACJA_GRUP_NA_STOLIKU=n    — grupy dzielące jeden stolik (1..4),
+//   RESTAURACJA_SZATNIE=n            — procesy szatni (1..SZATNIE_MAX).
+// Szatnia s obsługuje stoliki [granice_szatni[s], granice_szatni[s + 1]):
+// klasa pojemności c (1..4) należy do szatni (c - 1) * szatnie / 4, a
+// stoliki leżą w tablicy posortowane wg pojemności.
+struct WymiaryLokalu
+{
+    int32_t stoliki[4]; // wg pojemności 1..4
+    int32_t liczba_stolikow;
+    int32_t dlugosc_tasmy;
+    int32_t grup_na_stoliku;
+    int32_t szatnie;
+    int32_t granice_szatni[5]; // SZATNIE_MAX + 1
+};
+
+struct NaglowekShm
+{
+    uint32_t magia;
+    uint32_t wersja;
+    uint32_t rozmiar_calkowity;
+    uint32_t liczba_regionow;
+    struct WymiaryLokalu wymiary;
+    struct RegionOpis regiony[REGION_LICZBA];
+};
+
+// Wymiary z env (błędne wartości: komunikat i domyślne). Wołać w rodzicu
+// przed uklad_oblicz().
+void uklad_wymiary_z_env(struct WymiaryLokalu *w);
+// Wypełnia nagłówek dla `liczba_grup` grup (tablica przybyć ma
+// liczba_grup + 1 wpisów) i sali `w`; zwraca rozmiar segmentu albo 0, gdy
+// segment nie zmieściłby się w 32-bitowych przesunięciach.
+size_t uklad_oblicz(struct NaglowekShm *n, int liczba_grup, const struct WymiaryLokalu *w);
+// 0, gdy magia i wersja się zgadzają, a regiony mieszczą się w segmencie.
+int uklad_sprawdz(const struct NaglowekShm *n);
+void *uklad_region(void *baza, enum RegionShm r);
+const char *uklad_nazwa_regionu(enum RegionShm r);
+
+#endif // UKLAD_H
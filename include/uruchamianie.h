@@ -0,0 +1,51 @@
+#ifndef URUCHAMIANIE_H
+#define URUCHAMIANIE_H
+
+// ====== INKLUDY ======
+#include "histogram.h"
+
+#include <sys/types.h>
+
+// Silnik uruchamiania procesów potomnych. Domyślnie używa posix_spawn()
+// (glibc realizuje go przez clone(CLONE_VM|CLONE_VFORK), więc nie kopiuje
+// tablic stron wielowątkowego rodzica), a odziedziczone deskryptory zamyka
+// jednym close_range() zamiast pętli close() po całym _SC_OPEN_MAX.
+// Metodę można zmienić zmienną RESTAURACJA_SPAWN=posix_spawn|vfork|fork.
+
+// Numer, pod którym dziecko dostaje deskryptor z uruchamianie_przekaz_fd().
+#define URUCHAMIANIE_FD_PRZEKAZANY 3
+
+enum MetodaUruchamiania
+{
+    URUCHAMIANIE_POSIX_SPAWN = 0,
+    URUCHAMIANIE_VFORK = 1,
+    URUCHAMIANIE_FORK = 2,
+};
+
+// Statystyki silnika (tylko w procesie rodzica).
+struct UruchamianieStat
+{
+    enum MetodaUruchamiania metoda;
+    long uruchomione;
+    long bledy;
+    long long pierwszy_ns; // CLOCK_MONOTONIC pierwszego uruchomienia
+    long long ostatni_ns;  // CLOCK_MONOTONIC ostatniego uruchomienia
+    struct Histogram opoznienie;
+};
+
+// Wczytuje metodę z env i oznacza odziedziczone FD (>= 3) jako CLOEXEC.
+void uruchamianie_inicjuj(void);
+// `fd` (>= 0) trafia do każdego kolejnego dziecka jako
+// URUCHAMIANIE_FD_PRZEKAZANY; pozostałe FD >= 3 są zamykane jak dotąd.
+void uruchamianie_przekaz_fd(int fd);
+// Uruchamia `plik` z `argv`. `pgid`: -1 = bez zmiany grupy, 0 = nowa grupa
+// (pgid = pid dziecka), > 0 = dołącz do grupy. Zwraca PID lub -1 (errno
+// ustawione).
+pid_t uruchamianie_spawn(const char *plik, char *const argv[], pid_t pgid);
+// Jak wyżej, ale `fd_stdin` (>= 0) staje się standardowym wejściem dziecka.
+pid_t uruchamianie_spawn_stdin(const char *plik, char *const argv[], pid_t pgid,
+                               int fd_stdin);
+const struct UruchamianieStat *uruchamianie_statystyki(void);
+const char *uruchamianie_nazwa_metody(enum MetodaUruchamiania m);
+
+#endif // URUCHAMIANIE_H
@@ -0,0 +1,64 @@
+#ifndef WOLNE_MIEJSCA_H
+#define WOLNE_MIEJSCA_H
+
+// ====== INKLUDY ======
+#include <stddef.h>
+#include <stdint.h>
+
+// Indeks wolnych miejsc przy stolikach. Stolik z `f` wolnymi miejscami
+// (1..4) i wolnym miejscem na grupę ma ustawiony bit w kubełku `f`. Każdy
+// kubełek to trzypoziomowa mapa bitowa: bit na wyższym poziomie mówi, że
+// odpowiadające mu słowo niżej nie jest puste, a poziom 2 ma najwyżej
+// WOLNE_MIEJSCA_SLOWA_L2_MAX słowa (64^3 stolików na słowo). Szukanie
+// stolika dla `osoby` to najniższy ustawiony bit w kubełkach osoby..4 —
+// stała liczba __builtin_ctzll niezależnie od wielkości sali, z tym samym
+// wynikiem co dawny skan first-fit.
+//
+// Indeks leży w segmencie (REGION_WOLNE_MIEJSCA), osobno dla części sali
+// każdej szatni: słowa map nie są wspólne dla dwóch części, a każda zaczyna
+// się na nowej linii cache, więc część chroni mutex stolików jej szatni.
+
+#define WOLNE_MIEJSCA_KUBELKI 4
+// Sala ma do 4 * STOLIKI_MAX stolików; 2 * 64^3 = 524288 wystarcza.
+#define WOLNE_MIEJSCA_SLOWA_L2_MAX 2
+
+// Liczba słów 64-bitowych na jeden kubełek dla `liczba_stolikow` stolików.
+static inline size_t wolne_miejsca_slowa_kubelka(int liczba_stolikow)
+{
+    size_t w0 = ((size_t)(liczba_stolikow > 0 ? liczba_stolikow : 0) + 63) / 64;
+    size_t w1 = (w0 + 63) / 64;
+    return w0 + w1 + (w1 + 63) / 64;
+}
+
+// Słowa części sali z `liczba_stolikow` stolikami, dopełnione do linii.
+static inline size_t wolne_miejsca_slowa_czesci(int liczba_stolikow)
+{
+    return (WOLNE_MIEJSCA_KUBELKI * wolne_miejsca_slowa_kubelka(liczba_stolikow) + 7) & ~(size_t)7;
+}
+
+// Rozmiar indeksu dla `czesci` części sali o granicach `granice[0..czesci]`.
+static inline size_t wolne_miejsca_rozmiar(int czesci, const int32_t *granice)
+{
+    size_t slowa = 0;
+    for (int c = 0; c < czesci; c++)
+        slowa += wolne_miejsca_slowa_czesci(granice[c + 1] - granice[c]);
+    return sizeof(uint64_t) * slowa;
+}
+
+// Podpina indeks pod `pamiec` (wolne_miejsca_rozmiar() bajtów) w bieżącym
+// procesie; nie zmienia zawartości. Część c to stoliki [granice[c],
+// granice[c + 1]).
+void wolne_miejsca_przypisz(uint64_t *pamiec, int czesci, const int32_t *granice);
+// Poniższe wołać pod mutexem stolików części, której dotyczą (wszystkich
+// części, gdy przedział je obejmuje).
+// Przelicza wszystkie stoliki z common_ctx->stoliki.
+void wolne_miejsca_odbuduj(void);
+// Przelicza stolik `stolik` po zmianie zajete_miejsca / liczba_grup.
+void wolne_miejsca_aktualizuj(int stolik);
+// Pierwszy stolik z co najmniej `osoby` wolnymi miejscami albo -1.
+int wolne_miejsca_znajdz(int osoby);
+// Pierwszy stolik w przedziale [od, do) z dokładnie `wolne` (1..4) wolnymi
+// miejscami albo -1; też O(1) — trzy poziomy map w każdej części.
+int wolne_miejsca_w_przedziale(int wolne, int od, int do_);
+
+#endif // WOLNE_MIEJSCA_H
@@ -0,0 +1,63 @@
+#ifndef ZBIERACZ_H
+#define ZBIERACZ_H
+
+// ====== INKLUDY ======
+#include "histogram.h"
+
+#include <sys/types.h>
+
+// Zbieracz procesów potomnych sterowany zdarzeniami: SIGCHLD jest
+// zablokowany w rodzicu i odbierany przez signalfd, a każde powiadomienie
+// od razu opróżnia zombie przez wait4(). Dla każdego zarejestrowanego PID
+// zapamiętujemy moment uruchomienia, więc przy zbieraniu mamy czas życia,
+// status wyjścia i zużycie CPU (rusage) w podziale na role.
+
+enum RolaProcesu
+{
+    ROLA_KLIENT = 0,
+    ROLA_OBSLUGA,
+    ROLA_SZATNIA,
+    ROLA_KUCHARZ,
+    ROLA_KIEROWNIK,
+    ROLA_LICZBA,
+};
+
+// Statystyki zbieracza (tylko w procesie rodzica).
+struct ZbieraczStat
+{
+    long zebrane;
+    long wyjscie_zero;
+    long wyjscie_blad;
+    long zabite_sygnalem;
+    long niezarejestrowane; // PID spoza tablicy (np. przepełnienie)
+    int klienci_aktywni;    // zarejestrowani, jeszcze niezebrani klienci
+    int klienci_szczyt;
+    long long cpu_user_ns[ROLA_LICZBA];
+    long long cpu_sys_ns[ROLA_LICZBA];
+    long procesy[ROLA_LICZBA];
+    struct Histogram czas_zycia_klienta; // od uruchomienia do zebrania
+    struct Histogram opoznienie;         // od powiadomienia SIGCHLD do wait4()
+};
+
+// Blokuje SIGCHLD w wywołującym wątku i tworzy signalfd. Wołać w wątku
+// głównym przed utworzeniem innych wątków (dziedziczą maskę). Zwraca 0 lub -1.
+int zbieracz_inicjuj(void);
+// Zapisuje moment uruchomienia i rolę PID-u; wołać zaraz po spawnie.
+void zbieracz_zarejestruj(pid_t pid, enum RolaProcesu rola);
+// Jak wyżej dla procesu jednej grupy (ROLA_KLIENT): przy zebraniu zwalnia
+// jej miejsce w limicie grup w lokalu (grupy_zwolnij()), jakkolwiek proces
+// się zakończył.
+void zbieracz_zarejestruj_grupe(pid_t pid);
+// Uruchamia / zatrzymuje (z join) wątek zbieracza.
+int zbieracz_start(void);
+void zbieracz_zatrzymaj(void);
+// Nieblokująco zbiera wszystkie zakończone dzieci (ścieżka zamykania).
+// Zwraca liczbę zebranych klientów; ostatni status zapisuje w *status.
+int zbieracz_zbierz(int *status);
+// Jak zbieracz_zbierz(), ale najpierw śpi na signalfd do `timeout_ms` ms
+// (lub do pierwszego SIGCHLD). Wołać po zbieracz_zatrzymaj().
+int zbieracz_czekaj(int *status, int timeout_ms);
+const struct ZbieraczStat *zbieracz_statystyki(void);
+const char *zbieracz_nazwa_roli(enum RolaProcesu rola);
+
+#endif // ZBIERACZ_H
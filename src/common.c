@@ -1,13 +1,21 @@
 #define _GNU_SOURCE
 #include "common.h"
+#include "histogram.h"
+#include "kolejka.h"
+#include "polityka.h"
+#include "segment.h"
+#include "semafor.h"
+#include "tasma.h"
+#include "uklad.h"
+#include "wolne_miejsca.h"
 
 #include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ipc.h>
-#include <sys/msg.h>
-#include <sys/sem.h>
-#include <sys/shm.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 // `struct CommonCtx` jest zdefiniowany w common.h; tutaj instancja pamięci.
 struct CommonCtx common_ctx_storage = {0};
@@ -39,33 +47,71 @@ static void inicjuj_cond_wspoldzielony(pthread_cond_t *cond, const char *err)
     (void)pthread_condattr_destroy(&cattr);
 }
 
+// Wskaźniki CommonCtx z tablicy przesunięć nagłówka (uklad.h).
 static void przypisz_uklad_wspoldzielony(void *base)
 {
-    common_ctx->stoliki = (struct Stolik *)base;
-    common_ctx->tasma = (struct Talerzyk *)(common_ctx->stoliki + MAX_STOLIKI);
-    common_ctx->kuchnia_dania_wydane = (int *)(common_ctx->tasma + MAX_TASMA);
-    common_ctx->kasa_dania_sprzedane = common_ctx->kuchnia_dania_wydane + 6;
-    common_ctx->restauracja_otwarta = common_ctx->kasa_dania_sprzedane + 6;
-    common_ctx->klienci_w_kolejce = common_ctx->restauracja_otwarta + 1;
-    common_ctx->klienci_przyjeci = common_ctx->klienci_w_kolejce + 1;
-    common_ctx->klienci_opuscili = common_ctx->klienci_przyjeci + 1;
+    const struct WymiaryLokalu *w = &((const struct NaglowekShm *)base)->wymiary;
+    common_ctx->liczba_stolikow = w->liczba_stolikow;
+    common_ctx->dlugosc_tasmy = w->dlugosc_tasmy;
+    common_ctx->grup_na_stoliku = w->grup_na_stoliku;
+    for (int i = 0; i < 4; i++)
+        common_ctx->stoliki_wg_pojemnosci[i] = w->stoliki[i];
+    common_ctx->liczba_szatni = w->szatnie;
+    for (int s = 0; s <= SZATNIE_MAX; s++)
+        common_ctx->granice_szatni[s] = w->granice_szatni[s];
+    // Grupa idzie do szatni swojej klasy, a gdy ta nie ma żadnego stolika, na
+    // który się zmieści — do następnej, która ma.
+    int poczatek_klasy = 0;
+    for (int osoby = 1; osoby <= 4; osoby++)
+    {
+        int s = (osoby - 1) * w->szatnie / 4;
+        int t = s;
+        while (t < w->szatnie && w->granice_szatni[t + 1] <= poczatek_klasy)
+            t++;
+        common_ctx->szatnia_wg_osob[osoby - 1] = t < w->szatnie ? t : s;
+        poczatek_klasy += w->stoliki[osoby - 1];
+    }
+
+#define REGION(r) uklad_region(base, (r))
+    common_ctx->stoliki = (struct Stolik *)REGION(REGION_STOLIKI);
+    common_ctx->grupy_przy_stolikach = (struct Grupa *)REGION(REGION_GRUPY_PRZY_STOLIKACH);
+    common_ctx->tasma = (struct Talerzyk *)REGION(REGION_TASMA);
+    common_ctx->restauracja_otwarta = (int *)REGION(REGION_OTWARTA);
 
-    common_ctx->pid_obsluga_shm = (pid_t *)(common_ctx->klienci_opuscili + 1);
+    common_ctx->grupy_w_lokalu = (int *)REGION(REGION_GRUPY_W_LOKALU);
+    common_ctx->zdarzenia_szatni = (struct ZdarzeniaSzatni *)REGION(REGION_ZDARZENIA_SZATNI);
+
+    common_ctx->pid_obsluga_shm = (pid_t *)REGION(REGION_PIDY);
     common_ctx->pid_kierownik_shm = common_ctx->pid_obsluga_shm + 1;
-    common_ctx->stoliki_sync = (struct StolikiSync *)(common_ctx->pid_kierownik_shm + 1);
-    common_ctx->tasma_sync = (struct TasmaSync *)(common_ctx->stoliki_sync + 1);
-    common_ctx->queue_sync = (struct QueueSync *)(common_ctx->tasma_sync + 1);
-    common_ctx->statystyki_sync = (struct StatystykiSync *)(common_ctx->queue_sync + 1);
+    common_ctx->stoliki_sync = (struct StolikiSync *)REGION(REGION_STOLIKI_SYNC);
+    common_ctx->tasma_sync = (struct TasmaSync *)REGION(REGION_TASMA_SYNC);
+    common_ctx->budziki = (struct BudzikStolika *)REGION(REGION_BUDZIKI);
+    common_ctx->semafory = (struct SemaforShm *)REGION(REGION_SEMAFORY);
+    common_ctx->statystyki = (struct Statystyki *)REGION(REGION_STATYSTYKI);
+    common_ctx->pula = (struct PulaKlientow *)REGION(REGION_PULA);
+    common_ctx->kolejka = (struct KolejkaGrup *)REGION(REGION_KOLEJKA);
+    common_ctx->opoznienie_usadzenia = (struct Histogram *)REGION(REGION_HISTOGRAM);
+    common_ctx->oczekiwanie_na_danie = (struct Histogram *)REGION(REGION_HISTOGRAM_DANIA);
+    common_ctx->usadzenie_wg_osob = (struct Histogram *)REGION(REGION_HISTOGRAM_WG_OSOB);
+    common_ctx->usadzenie_wg_klasy = (struct Histogram *)REGION(REGION_HISTOGRAM_WG_KLASY);
+    common_ctx->skrzynki = (int *)REGION(REGION_SKRZYNKI);
+    common_ctx->segment = (char *)base;
+    common_ctx->budzenia_korutyn = (struct BudzeniaKorutyn *)REGION(REGION_BUDZENIA_KORUTYN);
+    common_ctx->przybycia_ns = (long long *)REGION(REGION_PRZYBYCIA);
+    wolne_miejsca_przypisz((uint64_t *)REGION(REGION_WOLNE_MIEJSCA), w->szatnie,
+                           w->granice_szatni);
+    tasma_przypisz((uint64_t *)REGION(REGION_TASMA_WOLNE),
+                   (struct SpecjalneStolika *)REGION(REGION_TASMA_SPECJALNE),
+                   (int *)REGION(REGION_TASMA_NASTEPNY),
+                   (uint64_t *)REGION(REGION_TASMA_ZWYKLE),
+                   (uint64_t *)REGION(REGION_STOLIKI_CZEKAJACE));
+#undef REGION
 }
 
 static void inicjuj_semafory(void)
 {
-    common_ctx->sem_id = semget(IPC_PRIVATE, 7, IPC_CREAT | 0600);
-    int sem_idxs[] = {SEM_TURA, SEM_KIEROWNIK, SEM_TURA_TURN1,
-                      SEM_TURA_TURN2, SEM_TURA_TURN3, SEM_PARENT_NOTIFY2,
-                      SEM_PARENT_NOTIFY3};
-    for (size_t i = 0; i < sizeof(sem_idxs) / sizeof(sem_idxs[0]); i++)
-        semctl(common_ctx->sem_id, sem_idxs[i], SETVAL, 0);
+    for (int i = 0; i < SEM_LICZBA; i++)
+        semafor_inicjuj(&common_ctx->semafory[i], 0);
 }
 
 /* Domyślna liczba grup jest ustawiana w trakcie działania (RESTAURACJA_LICZBA_KLIENTOW).
@@ -75,7 +121,6 @@ int czas_pracy_domyslny = CZAS_PRACY;
 
 // ====== ZMIENNE GLOBALNE ======
 
-const int ILOSC_STOLIKOW[4] = {X1, X2, X3, X4};         // liczba stolików 1..4
 const int CENY_DAN[6] = {p10, p15, p20, p40, p50, p60}; // ceny dań
 
 // ====== INICJALIZACJA ======
@@ -175,36 +220,11 @@ void czekaj_na_ture(int turn,
     }
 }
 
-// Spróbuj zmniejszyć semafor bez blokowania. Zwraca 0 przy sukcesie,
-// -1 gdy blokowałby, kończy proces przy błędzie krytycznym.
-int sem_probuj(int sem_idx)
-{
-    struct sembuf sb = {sem_idx, -1, IPC_NOWAIT};
-    if (semop(common_ctx->sem_id, &sb, 1) == 0)
-        return 0;
-    if (errno == EAGAIN || errno == EINTR)
-        return -1;
-    if (errno == EIDRM || errno == EINVAL)
-        exit(0);
-    exit(1);
-}
-
 // Czekaj do `seconds` na semafor. Zwraca 0 przy sukcesie,
 // -1 przy przekroczeniu czasu.
 int sem_czekaj_sekund(int sem_idx, int seconds)
 {
-    struct timespec start, now;
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    for (;;)
-    {
-        if (sem_probuj(sem_idx) == 0)
-            return 0;
-        (void)usypiaj_ms(POLL_MS_MED);
-        clock_gettime(CLOCK_MONOTONIC, &now);
-        if ((now.tv_sec - start.tv_sec) >= seconds)
-            break;
-    }
-    return -1;
+    return semafor_opusc(&common_ctx->semafory[sem_idx], seconds * 1000, NULL);
 }
 
 /* Usunięto wrapper: używaj sygnalizuj_ture_na(turn). */
@@ -228,175 +248,445 @@ void sygnalizuj_ture_na(int turn)
     }
 }
 
-// ====== STOLIKI ======
-int znajdz_stolik_dla_grupy_zablokowanej(
-    const struct Grupa *g) // znajduje odpowiedni stolik dla grupy (zakłada, że
-                           // semafor stolików jest zablokowany)
+// ====== FUTEKSY ======
+/* Futeksy współdzielone (bez FUTEX_PRIVATE_FLAG), bo słowa leżą w shm.
+ * Zwraca 0 po przebudzeniu lub gdy *adres != oczekiwana, -1 po czasie. */
+int futex_czekaj(int *adres, int oczekiwana, int timeout_ms)
 {
-    for (int i = 0; i < MAX_STOLIKI; i++)
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * NSEC_PER_MSEC;
+    if (syscall(SYS_futex, adres, FUTEX_WAIT, oczekiwana,
+                timeout_ms >= 0 ? &ts : NULL, NULL, 0) == 0)
+        return 0;
+    return (errno == ETIMEDOUT) ? -1 : 0;
+}
+
+void futex_obudz(int *adres, int ile)
+{
+    (void)syscall(SYS_futex, adres, FUTEX_WAKE, ile, NULL, NULL, 0);
+}
+
+// ====== BUDZENIE KORUTYN ======
+/* Wołać po zmianie słowa `adres` w segmencie (i zwykłym futex_obudz). Para
+ * seq_cst z planista_czekaj(): albo widzimy zaparkowane zadanie, albo ono
+ * widzi nową wartość słowa i nie zasypia. */
+void korutyny_obudz(const int *adres)
+{
+    struct BudzeniaKorutyn *b = common_ctx->budzenia_korutyn;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!b || __atomic_load_n(&b->zaparkowane, __ATOMIC_SEQ_CST) == 0)
+        return;
+    unsigned int k = korutyny_kubelek((size_t)((const char *)adres - common_ctx->segment));
+    __atomic_fetch_or(&b->kubelki[k / 64], 1ULL << (k % 64), __ATOMIC_ACQ_REL);
+    __atomic_fetch_or(&b->podsumowanie, 1ULL << (k / 64), __ATOMIC_ACQ_REL);
+    __atomic_add_fetch(&b->licznik, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&b->uspieni, __ATOMIC_SEQ_CST) > 0)
+        futex_obudz(&b->licznik, 1);
+}
+
+// ====== PULA KLIENTÓW ======
+/* Wstawia numer grupy do kolejki puli; przy pełnej kolejce czeka na
+ * pracowników. Producentów (wątki generatora) szeregujemy lokalnym mutexem.
+ * Zwraca 0 przy sukcesie, -1 gdy ustawiono `stop`. */
+int pula_opublikuj(int numer_grupy, volatile sig_atomic_t *stop)
+{
+    static pthread_mutex_t producent = PTHREAD_MUTEX_INITIALIZER;
+    struct PulaKlientow *pula = common_ctx->pula;
+
+    pthread_mutex_lock(&producent);
+    int o = pula->opublikowane;
+    for (;;)
     {
-        if (common_ctx->stoliki[i].zajete_miejsca + g->osoby <= common_ctx->stoliki[i].pojemnosc &&
-            common_ctx->stoliki[i].liczba_grup < MAX_GRUP_NA_STOLIKU)
+        if (stop && *stop)
         {
-            return i;
+            pthread_mutex_unlock(&producent);
+            return -1;
         }
+        int p = __atomic_load_n(&pula->pobrane, __ATOMIC_ACQUIRE);
+        if (o - p < PULA_ZLECENIA_MAX)
+            break;
+        (void)futex_czekaj(&pula->pobrane, p, POLL_MS_MED);
     }
-    return -1;
+    pula->zlecenia[o % PULA_ZLECENIA_MAX] = numer_grupy;
+    __atomic_store_n(&pula->opublikowane, o + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&producent);
+
+    futex_obudz(&pula->opublikowane, 1);
+    return 0;
 }
 
-// ====== OPERACJE IPC ======
-void sem_operacja(int sem, int val) // wykonuje operację na semaforze
+/* Pobiera numer grupy dla pracownika puli. Slot czytamy przed CAS-em: jeśli
+ * CAS się powiedzie, producent nie mógł go jeszcze nadpisać. Zwraca -1, gdy
+ * restauracja jest zamknięta albo ustawiono `shutdown`. */
+int pula_pobierz(volatile sig_atomic_t *shutdown)
 {
-    struct sembuf sb = {sem, val, SEM_UNDO}; // SEM_UNDO aby uniknąć deadlocka
-                                             // przy nagłym zakończeniu procesu
+    struct PulaKlientow *pula = common_ctx->pula;
     for (;;)
     {
-        if (semop(common_ctx->sem_id, &sb, 1) == 0) // operacja zakończona sukcesem
-        {
-            return;
-        }
+        if ((shutdown && *shutdown) || !*common_ctx->restauracja_otwarta)
+            return -1;
 
-        if (errno == EINTR) // przerwane przez sygnał
+        int p = __atomic_load_n(&pula->pobrane, __ATOMIC_ACQUIRE);
+        int o = __atomic_load_n(&pula->opublikowane, __ATOMIC_ACQUIRE);
+        if (p == o)
         {
-            if (common_ctx->shutdown_flag_ptr && *common_ctx->shutdown_flag_ptr)
-            {
-                exit(0);
-            }
+            (void)futex_czekaj(&pula->opublikowane, o, POLL_MS_MED);
             continue;
         }
 
-        if (errno == EIDRM ||
-            errno == EINVAL) // zasób IPC usunięty lub nieprawidłowy
-            exit(0);
-
-        exit(1);
+        int numer = __atomic_load_n(&pula->zlecenia[p % PULA_ZLECENIA_MAX],
+                                    __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&pula->pobrane, &p, p + 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            if (o - p >= PULA_ZLECENIA_MAX)
+                futex_obudz(&pula->pobrane, 1);
+            return numer;
+        }
     }
 }
 
-int sem_operacja_bez_wyjscia(int sem, int val, volatile sig_atomic_t *shutdown)
+// ====== LIMIT GRUP W LOKALU ======
+/* Zajmuje miejsce dla nowej grupy; przy `limit` osiągniętym czeka, aż
+ * któraś grupa skończy obsługę (limit <= 0: bez limitu). Zwraca liczbę grup
+ * w lokalu po zajęciu albo -1, gdy ustawiono `stop`. */
+int grupy_zajmij(int limit, volatile sig_atomic_t *stop)
 {
-    struct sembuf sb = {sem, val, SEM_UNDO};
+    int *licznik = common_ctx->grupy_w_lokalu;
     for (;;)
     {
-        if (semop(common_ctx->sem_id, &sb, 1) == 0)
-            return 0;
-
-        if (errno == EINTR)
+        int v = __atomic_load_n(licznik, __ATOMIC_ACQUIRE);
+        if (limit <= 0 || v < limit)
         {
-            if (shutdown && *shutdown)
-                return -1;
+            if (__atomic_compare_exchange_n(licznik, &v, v + 1, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                return v + 1;
             continue;
         }
-
-        if (errno == EIDRM || errno == EINVAL)
+        if (stop && *stop)
             return -1;
+        (void)futex_czekaj(licznik, v, POLL_MS_MED);
+    }
+}
+
+void grupy_zwolnij(void)
+{
+    __atomic_sub_fetch(common_ctx->grupy_w_lokalu, 1, __ATOMIC_ACQ_REL);
+    futex_obudz(common_ctx->grupy_w_lokalu, 1);
+}
+
+/* Licznik zdarzeń szatni: klient dopisał grupę do jej kolejki albo zwolnił
+ * miejsce przy stoliku jej części sali. Szatnia, która przejrzała całą
+ * kolejkę bez usadzenia nikogo, śpi na nim zamiast kręcić się w pętli. */
+void szatnia_powiadom(int szatnia)
+{
+    int *licznik = &common_ctx->zdarzenia_szatni[szatnia].licznik;
+    __atomic_add_fetch(licznik, 1, __ATOMIC_RELEASE);
+    futex_obudz(licznik, 1);
+}
 
+static int ustawienie_szatni_z_env(const char *nazwa, int domyslna, int min, int max)
+{
+    const char *s = getenv(nazwa);
+    if (!s || !*s)
+        return domyslna;
+    errno = 0;
+    char *end = NULL;
+    long v = strtol(s, &end, 10);
+    if (errno == 0 && end != s && *end == '\0' && v >= min && v <= max)
+        return (int)v;
+    LOGE("Nieprawidłowe %s=%s (%d..%d), używam %d\n", nazwa, s, min, max, domyslna);
+    return domyslna;
+}
+
+int szatnia_partia_z_env(void)
+{
+    return ustawienie_szatni_z_env("RESTAURACJA_SZATNIA_PARTIA", SZATNIA_PARTIA_DEFAULT, 1,
+                                   MAX_KOLEJKA);
+}
+
+int szatnia_waga_vip_z_env(void)
+{
+    return ustawienie_szatni_z_env("RESTAURACJA_WAGA_VIP", SZATNIA_WAGA_VIP_DEFAULT, 0,
+                                   MAX_KOLEJKA);
+}
+
+int szatnia_starzenie_ms_z_env(void)
+{
+    return ustawienie_szatni_z_env("RESTAURACJA_STARZENIE_MS", SZATNIA_STARZENIE_MS_DEFAULT, 0,
+                                   600000);
+}
+
+int vip_procent_z_env(void)
+{
+    return ustawienie_szatni_z_env("RESTAURACJA_VIP_PROCENT", VIP_PROCENT_DEFAULT, 0, 100);
+}
+
+// ====== SKRZYNKI PRZYDZIAŁU ======
+#define SKRZYNKA_CZEKA 0
+#define SKRZYNKA_ODWOLANA (-1)
+
+/* Szatnia wpisuje stolik do skrzynki usadzonej grupy i budzi tylko ją —
+ * bez sygnału i bez przeszukiwania stolików pod globalnym mutexem. Zwraca
+ * -1, gdy grupa zdążyła zrezygnować (wtedy miejsce trzeba zwolnić). */
+int skrzynka_dostarcz(int numer_grupy, int stolik)
+{
+    int *s = &common_ctx->skrzynki[numer_grupy];
+    int oczekiwana = SKRZYNKA_CZEKA;
+    if (!__atomic_compare_exchange_n(s, &oczekiwana, stolik + 1, 0, __ATOMIC_RELEASE,
+                                     __ATOMIC_RELAXED))
         return -1;
+    futex_obudz(s, 1);
+    korutyny_obudz(s);
+    return 0;
+}
+
+/* Czeka przez `czekaj` najwyżej `timeout_ms` (0: tylko sprawdza) na
+ * przydział. Zwraca indeks stolika albo -1. Sygnał przerywa czekanie
+ * (EINTR). */
+int skrzynka_odbierz(int numer_grupy, int timeout_ms, FunkcjaCzekania czekaj)
+{
+    int *s = &common_ctx->skrzynki[numer_grupy];
+    int v = __atomic_load_n(s, __ATOMIC_ACQUIRE);
+    if (v == SKRZYNKA_CZEKA && timeout_ms > 0)
+    {
+        (void)czekaj(s, SKRZYNKA_CZEKA, timeout_ms);
+        v = __atomic_load_n(s, __ATOMIC_ACQUIRE);
+    }
+    return v > 0 ? v - 1 : -1;
+}
+
+/* Grupa rezygnuje z czekania. Jeśli szatnia ją w międzyczasie usadziła,
+ * zwraca indeks stolika, w przeciwnym razie -1. */
+int skrzynka_odwolaj(int numer_grupy)
+{
+    int *s = &common_ctx->skrzynki[numer_grupy];
+    int v = SKRZYNKA_CZEKA;
+    if (__atomic_compare_exchange_n(s, &v, SKRZYNKA_ODWOLANA, 0, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE))
+        return -1;
+    return v > 0 ? v - 1 : -1;
+}
+
+// ====== BUDZIKI STOLIKÓW ======
+/* Wołać z zablokowanym mutexem taśmy. Czekający zwiększają `czekajacy` pod
+ * tym samym mutexem, zanim go puszczą, więc zero oznacza, że nikt nie śpi
+ * i syscall można pominąć. */
+void tasma_obudz_stolik(int stolik, int ile)
+{
+    struct BudzikStolika *b = &common_ctx->budziki[stolik];
+    if (__atomic_load_n(&b->czekajacy, __ATOMIC_RELAXED) == 0)
+        return;
+    __atomic_add_fetch(&b->zdarzenia, 1, __ATOMIC_RELEASE);
+    futex_obudz(&b->zdarzenia, ile);
+    korutyny_obudz(&b->zdarzenia);
+}
+
+// Zamknięcie: budzi wszystkich przy wszystkich stolikach (bez mutexa).
+void tasma_obudz_wszystkie(void)
+{
+    for (int i = 0; i < common_ctx->liczba_stolikow; i++)
+    {
+        struct BudzikStolika *b = &common_ctx->budziki[i];
+        __atomic_add_fetch(&b->zdarzenia, 1, __ATOMIC_RELEASE);
+        futex_obudz(&b->zdarzenia, INT_MAX);
+        korutyny_obudz(&b->zdarzenia);
     }
 }
 
+// ====== STOLIKI ======
+int znajdz_stolik_dla_grupy_zablokowanej(
+    const struct Grupa *g) // znajduje odpowiedni stolik dla grupy (zakłada, że
+                           // mutex stolików szatni grupy jest zablokowany)
+{
+    // Wybór stolika wg RESTAURACJA_POLITYKA (polityka.h) w części sali
+    // szatnia_grupy(); każda polityka korzysta z indeksu wolnych miejsc, więc
+    // koszt nie rośnie z salą.
+    return polityka_znajdz_stolik(g);
+}
+
+static long long zegar_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void stoliki_rozlicz_miejsca(int szatnia, int zmiana)
+{
+    struct StolikiSync *s = &common_ctx->stoliki_sync[szatnia];
+    long long teraz = zegar_ns();
+    if (s->ostatnia_zmiana_ns > 0)
+        s->miejsca_ns += (long long)s->zajete_miejsca * (teraz - s->ostatnia_zmiana_ns);
+    s->ostatnia_zmiana_ns = teraz;
+    s->zajete_miejsca += zmiana;
+}
+
+int stolik_usun_grupe(int stolik, const struct Grupa *g)
+{
+    struct Stolik *st = &common_ctx->stoliki[stolik];
+    struct Grupa *grupy = stolik_grupy(stolik);
+    for (int j = 0; j < st->liczba_grup; j++)
+    {
+        if (grupy[j].numer_grupy != g->numer_grupy)
+            continue;
+        for (int k = j; k < st->liczba_grup - 1; k++)
+            grupy[k] = grupy[k + 1];
+        memset(&grupy[st->liczba_grup - 1], 0, sizeof(struct Grupa));
+        st->liczba_grup--;
+        st->zajete_miejsca -= g->osoby;
+        stoliki_rozlicz_miejsca(szatnia_stolika(stolik), -g->osoby);
+        wolne_miejsca_aktualizuj(stolik);
+        return 0;
+    }
+    return -1;
+}
+
+long long stoliki_miejsca_ns(void)
+{
+    long long wynik = 0;
+    for (int s = 0; s < common_ctx->liczba_szatni; s++)
+    {
+        pthread_mutex_lock(stoliki_mutex(s));
+        stoliki_rozlicz_miejsca(s, 0);
+        wynik += common_ctx->stoliki_sync[s].miejsca_ns;
+        pthread_mutex_unlock(stoliki_mutex(s));
+    }
+    return wynik;
+}
+
+void stoliki_zablokuj_wszystkie(void)
+{
+    for (int s = 0; s < common_ctx->liczba_szatni; s++)
+        pthread_mutex_lock(stoliki_mutex(s));
+}
+
+void stoliki_odblokuj_pozostale(void)
+{
+    for (int s = common_ctx->liczba_szatni - 1; s > 0; s--)
+        pthread_mutex_unlock(stoliki_mutex(s));
+}
+
+// ====== OPERACJE IPC ======
+/* Semafory leżą w shm (semafor.h). `val` > 0 podnosi, `val` < 0 czeka na
+ * tyle żetonów; ustawiona flaga zamknięcia kończy proces jak dawniej EINTR
+ * z semop(). */
+void sem_operacja(int sem, int val) // wykonuje operację na semaforze
+{
+    if (sem_operacja_bez_wyjscia(sem, val, common_ctx->shutdown_flag_ptr) != 0)
+        exit(0);
+}
+
+int sem_operacja_bez_wyjscia(int sem, int val, volatile sig_atomic_t *shutdown)
+{
+    struct SemaforShm *s = &common_ctx->semafory[sem];
+    if (val > 0)
+    {
+        semafor_podnies(s, val);
+        return 0;
+    }
+    for (; val < 0; val++)
+        if (semafor_opusc(s, -1, shutdown) != 0)
+            return -1;
+    return 0;
+}
+
 void stworz_ipc(void) // tworzy zasoby IPC (pamięć współdzieloną i semafory)
 {
-    int bufor_size =
-        sizeof(struct Stolik) * MAX_STOLIKI + // pamięć na stoliki
-        sizeof(struct Talerzyk) * MAX_TASMA + // pamięć na taśmę
-        sizeof(int) *
-            (6 * 2 + 2 + 3 + 3) +      // pamięć na liczniki dań, flagi i statystyki
-        sizeof(pid_t) * 2 +            // pamięć na PID-y procesów
-        sizeof(struct StolikiSync) +   // synchronizacja stolików
-        sizeof(struct TasmaSync) +     // synchronizacja taśmy
-        sizeof(struct QueueSync) +     // synchronizacja kolejki
-        sizeof(struct StatystykiSync); // synchronizacja statystyk
-
-    common_ctx->shm_id = shmget(IPC_PRIVATE, bufor_size,
-                                IPC_CREAT | 0600); // utwórz pamięć współdzieloną
-    void *pamiec_wspoldzielona =
-        shmat(common_ctx->shm_id, NULL, 0); // dołącz pamięć współdzieloną
-    if (pamiec_wspoldzielona == (void *)-1)
+    struct WymiaryLokalu wymiary;
+    uklad_wymiary_z_env(&wymiary);
+    struct NaglowekShm naglowek;
+    size_t bufor_size = uklad_oblicz(&naglowek, liczba_klientow, &wymiary);
+    if (bufor_size == 0)
     {
-        LOGE_ERRNO("shmat");
+        LOGE("Segment dla %d stolików, taśmy %d i %d grup przekracza 4 GiB\n",
+             wymiary.liczba_stolikow, wymiary.dlugosc_tasmy, liczba_klientow);
         exit(1);
     }
-    memset(pamiec_wspoldzielona, 0, bufor_size); // wyczyść pamięć współdzieloną
+
+    // Jądro zeruje nowy segment w każdym zapleczu (segment.h), więc nie
+    // dotykamy wszystkich stron memsetem.
+    void *pamiec_wspoldzielona = segment_utworz(bufor_size);
+    memcpy(pamiec_wspoldzielona, &naglowek, sizeof(naglowek));
     przypisz_uklad_wspoldzielony(pamiec_wspoldzielona);
 
-    common_ctx->tasma_sync->count = 0;
+    common_ctx->tasma_sync->glowa = 0;
+    tasma_odbuduj();
     inicjuj_mutex_wspoldzielony(&common_ctx->tasma_sync->mutex,
                                 "Nie udało się zainicjalizować mutexa taśmy\n");
     inicjuj_cond_wspoldzielony(&common_ctx->tasma_sync->not_full,
                                "Nie udało się zainicjalizować cond taśmy\n");
-    inicjuj_cond_wspoldzielony(&common_ctx->tasma_sync->not_empty,
-                               "Nie udało się zainicjalizować cond taśmy\n");
 
-    /* Zainicjalizuj mutex/cond stolików (współdzielone między procesami) */
-    inicjuj_mutex_wspoldzielony(&common_ctx->stoliki_sync->mutex,
-                                "Nie udało się zainicjalizować mutexa stolików\n");
-    inicjuj_cond_wspoldzielony(&common_ctx->stoliki_sync->cond,
-                               "Nie udało się zainicjalizować cond stolików\n");
-
-    /* Zainicjalizuj synchronizację kolejki (współdzielona między procesami) */
-    common_ctx->queue_sync->count = 0;
-    common_ctx->queue_sync->max = MAX_KOLEJKA_MSG - KOLEJKA_REZERWA;
-    inicjuj_mutex_wspoldzielony(&common_ctx->queue_sync->mutex,
-                                "Nie udało się zainicjalizować mutexa kolejki\n");
-    inicjuj_cond_wspoldzielony(&common_ctx->queue_sync->not_full,
-                               "Nie udało się zainicjalizować cond kolejki\n");
-    inicjuj_cond_wspoldzielony(&common_ctx->queue_sync->not_empty,
-                               "Nie udało się zainicjalizować cond kolejki\n");
-
-    /* Zainicjalizuj synchronizację statystyk (współdzielona między procesami) */
-    inicjuj_mutex_wspoldzielony(&common_ctx->statystyki_sync->mutex,
-                                "Nie udało się zainicjalizować mutexa statystyk\n");
+    /* Zainicjalizuj mutexy/cond stolików (współdzielone między procesami) */
+    for (int s = 0; s < common_ctx->liczba_szatni; s++)
+    {
+        inicjuj_mutex_wspoldzielony(stoliki_mutex(s),
+                                    "Nie udało się zainicjalizować mutexa stolików\n");
+        inicjuj_cond_wspoldzielony(&common_ctx->stoliki_sync[s].cond,
+                                   "Nie udało się zainicjalizować cond stolików\n");
+    }
+
+    /* Kolejki wejściowe grup (pierścienie MPMC, kolejka.h) */
+    kolejka_inicjuj();
 
     /* Semafory (otwarcie, kierownik, tury, powiadomienia) */
     inicjuj_semafory();
+}
 
-    common_ctx->msgq_id = msgget(IPC_PRIVATE, IPC_CREAT | 0600); // utwórz kolejkę komunikatów
-    if (common_ctx->msgq_id < 0)
+static void przypisz_dolaczony_segment(void *pamiec_wspoldzielona)
+{
+    if (!pamiec_wspoldzielona)
+        exit(1);
+    // Binarka z innym układem (np. po przebudowie w trakcie działania) nie
+    // może pisać po cudzych przesunięciach.
+    const struct NaglowekShm *n = (const struct NaglowekShm *)pamiec_wspoldzielona;
+    if (uklad_sprawdz(n) != 0)
     {
-        LOGE_ERRNO("msgget");
+        LOGE("Niezgodny układ pamięci współdzielonej (magia %#x, wersja %u, "
+             "oczekiwano %#x/%u)\n",
+             n->magia, n->wersja, UKLAD_MAGIA, UKLAD_WERSJA);
         exit(1);
     }
+    przypisz_uklad_wspoldzielony(pamiec_wspoldzielona);
 }
 
-void dolacz_ipc(
-    int shm_id_existing,
-    int sem_id_existing) // dołącza do istniejących zasobów IPC po exec()
+void dolacz_ipc(int shm_id_existing) // dołącza do istniejącej pamięci po exec()
 {
-    common_ctx->shm_id = shm_id_existing; // dołącz istniejącą pamięć współdzieloną
-    common_ctx->sem_id = sem_id_existing; // dołącz istniejące semafory
+    common_ctx->shm_id = shm_id_existing;
+    przypisz_dolaczony_segment(segment_dolacz_sysv(shm_id_existing));
+}
 
-    void *pamiec_wspoldzielona =
-        shmat(common_ctx->shm_id, NULL, 0); // dołącz pamięć współdzieloną
-    if (pamiec_wspoldzielona == (void *)-1)
-    {
-        LOGE_ERRNO("shmat");
-        exit(1);
-    }
-    przypisz_uklad_wspoldzielony(pamiec_wspoldzielona);
+// Jak dolacz_ipc(), ale segment przyszedł jako deskryptor (memfd/posix).
+void dolacz_ipc_fd(int shm_fd)
+{
+    common_ctx->shm_id = -1;
+    przypisz_dolaczony_segment(segment_dolacz_fd(shm_fd));
 }
 
 int dolacz_ipc_z_argv(int argc, char **argv, int potrzebuje_grupy,
                       int *out_numer_grupy)
 {
-    int oczekiwane = potrzebuje_grupy ? 5 : 4;
+    int oczekiwane = potrzebuje_grupy ? 3 : 2;
     if (argc != oczekiwane)
     {
         if (potrzebuje_grupy)
-            LOGE("Użycie: %s <shm_id> <sem_id> <msgq_id> <numer_grupy>\n",
-                 argv[0]);
+            LOGE("Użycie: %s <shm_id> <numer_grupy>\n", argv[0]);
         else
-            LOGE("Użycie: %s <shm_id> <sem_id> <msgq_id>\n", argv[0]);
+            LOGE("Użycie: %s <shm_id>\n", argv[0]);
         return 1;
     }
 
-    int shm = parsuj_int_lub_zakoncz("shm_id", argv[1]);
-    int sem = parsuj_int_lub_zakoncz("sem_id", argv[2]);
-    common_ctx->msgq_id = parsuj_int_lub_zakoncz("msgq_id", argv[3]);
+    // <shm_id> to numer segmentu SysV albo "fd:N" (segment.h).
+    int przez_fd = strncmp(argv[1], "fd:", 3) == 0;
+    int shm = parsuj_int_lub_zakoncz("shm_id", przez_fd ? argv[1] + 3 : argv[1]);
     if (potrzebuje_grupy && out_numer_grupy)
-        *out_numer_grupy = parsuj_int_lub_zakoncz("numer_grupy", argv[4]);
+        *out_numer_grupy = parsuj_int_lub_zakoncz("numer_grupy", argv[2]);
 
-    dolacz_ipc(shm, sem);
+    if (przez_fd)
+        dolacz_ipc_fd(shm);
+    else
+        dolacz_ipc(shm);
     return 0;
 }
 
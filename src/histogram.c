@@ -0,0 +1,80 @@
+#include "histogram.h"
+
+#include <stdio.h>
+
+static int indeks_kubelka(unsigned long long v)
+{
+    if (v < 8)
+        return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    int m = (int)((v >> (e - 3)) & 7);
+    return (e - 2) * 8 + m;
+}
+
+static unsigned long long gorna_granica_kubelka(int i)
+{
+    if (i < 8)
+        return (unsigned long long)i;
+    int e = i / 8 + 2;
+    unsigned long long m = (unsigned long long)(i % 8);
+    return ((9 + m) << (e - 3)) - 1;
+}
+
+void histogram_dodaj(struct Histogram *h, unsigned long long wartosc_ns)
+{
+    if (!h)
+        return;
+    __atomic_fetch_add(&h->kubelki[indeks_kubelka(wartosc_ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->suma, wartosc_ns, __ATOMIC_RELAXED);
+
+    unsigned long long max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (wartosc_ns > max &&
+           !__atomic_compare_exchange_n(&h->max, &max, wartosc_ns, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    // min == 0 oznacza "brak próbek", więc przechowujemy wartość + 1.
+    unsigned long long min = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+    while ((min == 0 || wartosc_ns + 1 < min) &&
+           !__atomic_compare_exchange_n(&h->min, &min, wartosc_ns + 1, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    __atomic_fetch_add(&h->liczba, 1, __ATOMIC_RELEASE);
+}
+
+unsigned long long histogram_percentyl(const struct Histogram *h, double p)
+{
+    unsigned long long n = __atomic_load_n(&h->liczba, __ATOMIC_ACQUIRE);
+    if (n == 0)
+        return 0;
+    unsigned long long cel = (unsigned long long)((double)n * p / 100.0);
+    if (cel >= n)
+        cel = n - 1;
+
+    unsigned long long narastajaco = 0;
+    for (int i = 0; i < HISTOGRAM_KUBELKI; i++)
+    {
+        narastajaco += __atomic_load_n(&h->kubelki[i], __ATOMIC_RELAXED);
+        if (narastajaco > cel)
+        {
+            unsigned long long g = gorna_granica_kubelka(i);
+            return g < h->max ? g : h->max;
+        }
+    }
+    return h->max;
+}
+
+void histogram_opisz(const struct Histogram *h, char *buf, size_t rozmiar)
+{
+    unsigned long long n = __atomic_load_n(&h->liczba, __ATOMIC_ACQUIRE);
+    if (n == 0)
+    {
+        snprintf(buf, rozmiar, "n=0");
+        return;
+    }
+    snprintf(buf, rozmiar,
+             "n=%llu śr=%.3f ms p50=%.3f ms p90=%.3f ms p99=%.3f ms max=%.3f ms",
+             n, (double)h->suma / (double)n / 1e6,
+             (double)histogram_percentyl(h, 50) / 1e6,
+             (double)histogram_percentyl(h, 90) / 1e6,
+             (double)histogram_percentyl(h, 99) / 1e6, (double)h->max / 1e6);
+}
@@ -88,6 +88,8 @@ void kierownik(void)
         LOGD("kierownik: pid=%d czeka na SEM_KIEROWNIK\n", (int)getpid());
         sem_operacja(SEM_KIEROWNIK, -1);
         LOGD("kierownik: pid=%d wybudzony SEM_KIEROWNIK\n", (int)getpid());
+        if (!*common_ctx->restauracja_otwarta)
+            break; // budzenie przy zamknięciu, nie takt
         kierownik_wyslij_sygnal();
         if (kier_ctx->shutdown_requested)
             break;
@@ -1,12 +1,19 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "klient.h"
+#include "histogram.h"
+#include "kolejka.h"
+#include "planista.h"
+#include "statystyki.h"
+#include "tasma.h"
 
 #include <errno.h>
-#include <sched.h>
+#include <limits.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/msg.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 // ====== TYPY ======
@@ -35,10 +42,10 @@ typedef struct
 struct KlientCtx
 {
     volatile sig_atomic_t prosba_zamkniecia;
-    pthread_mutex_t klient_dania_mutex;
+    int vip_procent; // RESTAURACJA_VIP_PROCENT; -1 = jeszcze nie wczytano
 };
 
-static struct KlientCtx klient_ctx_storage = {.prosba_zamkniecia = 0, .klient_dania_mutex = PTHREAD_MUTEX_INITIALIZER};
+static struct KlientCtx klient_ctx_storage = {.prosba_zamkniecia = 0, .vip_procent = -1};
 static struct KlientCtx *klient_ctx = &klient_ctx_storage;
 
 static void kolejka_dodaj_local(struct Grupa g);
@@ -46,9 +53,7 @@ static void kolejka_dodaj_local(struct Grupa g);
 // ====== DEKLARACJE WSTĘPNE ======
 
 static void klient_obsluz_sigterm(int signo);
-static void klient_obsluz_sigusr1(int signo);
 static struct Grupa inicjalizuj_grupe(int numer_grupy);
-static void usadz_grupe_vip(struct Grupa *g);
 static int czekaj_na_przydzial_stolika(struct Grupa *g);
 static void zamow_specjalne_jesli_trzeba(struct Grupa *g,
                                          int *dania_do_pobrania,
@@ -56,7 +61,7 @@ static void zamow_specjalne_jesli_trzeba(struct Grupa *g,
                                          int timeout_dania_ms);
 static WynikPobraniaDania
 sprobuj_pobrac_danie(struct Grupa *g, int *dania_pobrane, int dania_do_pobrania,
-                     struct timespec *czas_start_dania);
+                     struct timespec *czas_start_dania, int czekaj_ms);
 static void zaplac_za_dania(const struct Grupa *g);
 static void opusc_stolik(const struct Grupa *g);
 static void petla_czekania_na_dania(struct Grupa *g);
@@ -69,9 +74,6 @@ static void klient_obsluz_sigterm(int signo)
     klient_ctx->prosba_zamkniecia = 1;
 }
 
-// Obsługa sygnału SIGUSR1
-static void klient_obsluz_sigusr1(int signo) { (void)signo; }
-
 static long roznica_ms(const struct timespec *start, const struct timespec *end)
 {
     long sec = end->tv_sec - start->tv_sec;
@@ -84,186 +86,66 @@ static struct Grupa inicjalizuj_grupe(int numer_grupy)
 {
     struct Grupa g;
     g.numer_grupy = numer_grupy;
-    g.proces_id = getpid();
+    // W trybie korutyn wszystkie grupy dzielą PID rodzica — szatnia nie może
+    // wysyłać im sygnałów, więc PID pozostaje pusty.
+    g.proces_id = planista_w_zadaniu() ? 0 : getpid();
     g.osoby = rand() % 4 + 1;
     g.dorosli = rand() % g.osoby + 1;
     g.dzieci = g.osoby - g.dorosli;
     g.stolik_przydzielony = -1;
-    g.vip = (rand() % 100 < 2);
+    // Korutyny mogą wczytać jednocześnie — zapisują tę samą wartość.
+    int vip_procent = __atomic_load_n(&klient_ctx->vip_procent, __ATOMIC_RELAXED);
+    if (vip_procent < 0)
+    {
+        vip_procent = vip_procent_z_env();
+        __atomic_store_n(&klient_ctx->vip_procent, vip_procent, __ATOMIC_RELAXED);
+    }
+    g.vip = (rand() % 100 < vip_procent);
     g.wejscie = time(NULL);
     memset(g.pobrane_dania, 0, sizeof(g.pobrane_dania));
     g.danie_specjalne = 0;
     return g;
 }
 
-// Usadź grupę VIP
-static void usadz_grupe_vip(struct Grupa *g)
-{
-    int log_usadzono = 0;
-    int log_numer_stolika = 0;
-    int log_zajete = 0;
-    int log_pojemnosc = 0;
-
-    pthread_mutex_lock(&common_ctx->stoliki_sync->mutex);
-    int i = znajdz_stolik_dla_grupy_zablokowanej(g);
-    if (i >= 0)
-    {
-        common_ctx->stoliki[i].grupy[common_ctx->stoliki[i].liczba_grup] = *g;
-        common_ctx->stoliki[i].zajete_miejsca += g->osoby;
-        common_ctx->stoliki[i].liczba_grup++;
-        log_usadzono = 1;
-        log_numer_stolika = common_ctx->stoliki[i].numer_stolika;
-        log_zajete = common_ctx->stoliki[i].zajete_miejsca;
-        log_pojemnosc = common_ctx->stoliki[i].pojemnosc;
-        g->stolik_przydzielony = i;
-    }
-    pthread_mutex_unlock(&common_ctx->stoliki_sync->mutex);
-
-    if (log_usadzono)
-    {
-        if (common_ctx->statystyki_sync &&
-            pthread_mutex_lock(&common_ctx->statystyki_sync->mutex) == 0)
-        {
-            (*common_ctx->klienci_przyjeci) += g->osoby;
-            pthread_mutex_unlock(&common_ctx->statystyki_sync->mutex);
-        }
-        LOGI("Grupa VIP %d usadzona: %d osób (dorosłych: %d, dzieci: %d) przy "
-             "stoliku: %d (miejsc zajete: %d/%d)\n",
-             g->numer_grupy, g->osoby, g->dorosli, g->dzieci, log_numer_stolika,
-             log_zajete, log_pojemnosc);
-    }
-}
+// Szatnia wpisuje przydzielony stolik do skrzynki grupy (indeks = numer
+// grupy) i budzi ją futeksem. Oczekiwanie ma limit, żeby zauważyć
+// zamknięcie bez jawnego budzenia; SIGTERM przerywa je od razu (EINTR).
+#define SKRZYNKA_CZEKAJ_MS 1000
 
 // Czekaj na przydział stolika
 static int czekaj_na_przydzial_stolika(struct Grupa *g)
 {
-    pid_t moj_proces_id = g->proces_id;
-    sigset_t block_set, old_set;
-    sigemptyset(&block_set);
-    sigaddset(&block_set, SIGUSR1);
-    // Zablokuj SIGUSR1 przed dodaniem do kolejki, aby uniknąć wyścigu, gdzie
-    // manager/obsluga wysyła SIGUSR1 między enqueue a blokowaniem,
-    // co mogłoby spowodować, że klient przegapi przebudzenie.
-    sigprocmask(SIG_BLOCK, &block_set, &old_set);
-
     kolejka_dodaj_local(*g);
-    /* LOGD("Grupa %d dodana do kolejki: %d osób (dorosłych: %d, dzieci: %d)%s\n",
-         g->numer_grupy,
-         g->osoby,
-         g->dorosli,
-         g->dzieci,
-         g->vip ? " [VIP]" : "");
-  */
-    while (g->stolik_przydzielony == -1 && *common_ctx->restauracja_otwarta &&
-           !klient_ctx->prosba_zamkniecia)
+    int stolik = -1;
+    while (*common_ctx->restauracja_otwarta && !klient_ctx->prosba_zamkniecia)
     {
-        int log_znaleziono = 0;
-        int log_numer_stolika = 0;
-        pthread_mutex_lock(&common_ctx->stoliki_sync->mutex);
-        for (int i = 0; i < MAX_STOLIKI; i++)
-        {
-            for (int j = 0; j < common_ctx->stoliki[i].liczba_grup; j++)
-            {
-                if (common_ctx->stoliki[i].grupy[j].proces_id == moj_proces_id)
-                {
-                    g->stolik_przydzielony = i;
-                    log_znaleziono = 1;
-                    log_numer_stolika = common_ctx->stoliki[i].numer_stolika;
-                    break;
-                }
-            }
-            if (g->stolik_przydzielony != -1)
-                break;
-        }
-        pthread_mutex_unlock(&common_ctx->stoliki_sync->mutex);
-
-        if (log_znaleziono)
-            LOGD("Grupa %d znalazała swój stolik: %d\n", g->numer_grupy,
-                 log_numer_stolika);
-
-        if (g->stolik_przydzielony == -1 && *common_ctx->restauracja_otwarta &&
-            !klient_ctx->prosba_zamkniecia)
-        {
-            sigsuspend(&old_set);
-        }
+        // Korutyna parkuje się w planiście zamiast zawieszać wątek na
+        // futeksie; skrzynka_dostarcz() budzi ją tak samo jak proces.
+        stolik = skrzynka_odbierz(g->numer_grupy, SKRZYNKA_CZEKAJ_MS, planista_czekaj);
+        if (stolik >= 0)
+            break;
     }
-
-    sigprocmask(SIG_SETMASK, &old_set, NULL);
+    // Zamknięcie: rezygnujemy, chyba że szatnia zdążyła nas usadzić.
+    if (stolik < 0)
+        stolik = skrzynka_odwolaj(g->numer_grupy);
+    g->stolik_przydzielony = stolik;
 
     if (g->stolik_przydzielony == -1)
     {
         LOGI("Grupa %d opuszcza kolejkę - restauracja zamknięta\n", g->numer_grupy);
         return -1;
     }
+    LOGD("Grupa %d dostała stolik: %d\n", g->numer_grupy,
+         common_ctx->stoliki[stolik].numer_stolika);
     return 0;
 }
 
 static void kolejka_dodaj_local(struct Grupa g)
 {
-    QueueMsg msg;
-    msg.mtype = 1;
-    msg.grupa = g;
-    for (;;)
-    {
-        if (!*common_ctx->restauracja_otwarta)
-            return;
-
-        struct timespec now, abstime;
-        clock_gettime(CLOCK_REALTIME, &now);
-        abstime = now;
-        abstime.tv_sec += 1;
-
-        if (pthread_mutex_lock(&common_ctx->queue_sync->mutex) != 0)
-            continue;
-        while (common_ctx->queue_sync->count >= common_ctx->queue_sync->max)
-        {
-            int rc = pthread_cond_timedwait(
-                &common_ctx->queue_sync->not_full, &common_ctx->queue_sync->mutex,
-                &abstime);
-            if (rc == ETIMEDOUT)
-            {
-                if (!*common_ctx->restauracja_otwarta)
-                {
-                    pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-                    return;
-                }
-                clock_gettime(CLOCK_REALTIME, &now);
-                abstime = now;
-                abstime.tv_sec += 1;
-                continue;
-            }
-            if (rc != 0)
-            {
-                if (common_ctx->shutdown_flag_ptr &&
-                    *common_ctx->shutdown_flag_ptr)
-                {
-                    pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-                    exit(0);
-                }
-                continue;
-            }
-        }
-
-        if (msgsnd(common_ctx->msgq_id, &msg, sizeof(msg.grupa), IPC_NOWAIT) == 0)
-        {
-            common_ctx->queue_sync->count++;
-            (*common_ctx->klienci_w_kolejce) += msg.grupa.osoby;
-            pthread_cond_signal(&common_ctx->queue_sync->not_empty);
-            pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-            return;
-        }
-
-        pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-
-        if (errno == EINTR)
-            continue;
-        if (errno == EAGAIN)
-            continue;
-        if (errno == EIDRM || errno == EINVAL)
-            exit(0);
-
+    // Pełna kolejka: proces śpi na futeksie, korutyna parkuje się w planiście.
+    if (kolejka_wstaw(&g, &klient_ctx->prosba_zamkniecia, planista_czekaj) != 0)
         return;
-    }
+    szatnia_powiadom(szatnia_grupy(g.osoby));
 }
 
 // Zamów specjalne jeśli trzeba
@@ -282,59 +164,74 @@ static void zamow_specjalne_jesli_trzeba(struct Grupa *g,
     int ceny[] = {p40, p50, p60};
     int c = ceny[rand() % 3];
     g->danie_specjalne = c;
-    (*dania_do_pobrania)++;
+    __atomic_add_fetch(dania_do_pobrania, 1, __ATOMIC_RELAXED);
 
-    pthread_mutex_lock(&common_ctx->stoliki_sync->mutex);
+    pthread_mutex_t *mutex = stoliki_mutex(szatnia_stolika(g->stolik_przydzielony));
+    pthread_mutex_lock(mutex);
+    struct Grupa *grupy = stolik_grupy(g->stolik_przydzielony);
     for (int j = 0; j < common_ctx->stoliki[g->stolik_przydzielony].liczba_grup; j++)
     {
-        if (common_ctx->stoliki[g->stolik_przydzielony].grupy[j].numer_grupy ==
-            g->numer_grupy)
+        if (grupy[j].numer_grupy == g->numer_grupy)
         {
-            common_ctx->stoliki[g->stolik_przydzielony].grupy[j].danie_specjalne = c;
+            grupy[j].danie_specjalne = c;
             break;
         }
     }
-    pthread_mutex_unlock(&common_ctx->stoliki_sync->mutex);
-    /* Powiadom obsługę, że zamówiono danie specjalne (unikamy aktywnego odpytywania) */
+    pthread_mutex_unlock(mutex);
+    /* Powiadom obsługę, że zamówiono danie specjalne (unikamy aktywnego
+     * odpytywania). Przy kilku szatniach obsługa czeka na cond z mutexem
+     * pierwszej, a nasz wpis mógł pójść pod innym — sygnał pod jej mutexem
+     * nie przepadnie między jej przeglądem a zaśnięciem. */
+    if (mutex != stoliki_mutex(0))
+        pthread_mutex_lock(stoliki_mutex(0));
     (void)pthread_cond_signal(&common_ctx->stoliki_sync->cond);
+    if (mutex != stoliki_mutex(0))
+        pthread_mutex_unlock(stoliki_mutex(0));
 
     LOGI("Grupa %d zamawia danie specjalne za: %d zł. \n", g->numer_grupy,
          g->danie_specjalne);
     clock_gettime(CLOCK_MONOTONIC, czas_start_dania);
 }
 
-// Wątek osoby
-static void *person_thread(void *arg)
+// Jeden krok osoby: lider zamawia danie specjalne, każdy próbuje pobrać danie.
+// Zwraca -1, gdy osoba skończyła, w przeciwnym razie wynik pobrania.
+static int krok_osoby(PersonArg *pa)
 {
-    PersonArg *pa = (PersonArg *)arg;
-    struct Grupa *g = pa->g;
-    int local_is_lead = pa->is_lead;
-    int timeout = pa->timeout_dania_ms;
+    int done = __atomic_load_n(pa->shared_dania_pobrane, __ATOMIC_RELAXED);
+    int target = __atomic_load_n(pa->dania_do_pobrania_ptr, __ATOMIC_RELAXED);
 
-    for (;;)
-    {
-        pthread_mutex_lock(&klient_ctx->klient_dania_mutex);
-        int done = *pa->shared_dania_pobrane;
-        int target = *pa->dania_do_pobrania_ptr;
-        pthread_mutex_unlock(&klient_ctx->klient_dania_mutex);
+    if (done >= target || !*common_ctx->restauracja_otwarta || klient_ctx->prosba_zamkniecia)
+        return -1;
 
-        if (done >= target || !*common_ctx->restauracja_otwarta || klient_ctx->prosba_zamkniecia)
-            break;
+    if (pa->is_lead)
+        zamow_specjalne_jesli_trzeba(pa->g, pa->dania_do_pobrania_ptr,
+                                     pa->czas_start_dania_ptr, pa->timeout_dania_ms);
 
-        if (local_is_lead)
-            zamow_specjalne_jesli_trzeba(g, pa->dania_do_pobrania_ptr,
-                                         pa->czas_start_dania_ptr, timeout);
+    // Lider bez zamówionego specjalnego śpi najwyżej do chwili, w której ma
+    // je zamówić; pozostałych budzi obsługa (budzik stolika) albo zamknięcie.
+    int czekaj_ms = POLL_MS_MED;
+    if (pa->is_lead && pa->g->danie_specjalne == 0)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long zostalo = pa->timeout_dania_ms - roznica_ms(pa->czas_start_dania_ptr, &now) + 1;
+        if (zostalo < czekaj_ms)
+            czekaj_ms = zostalo > 1 ? (int)zostalo : 1;
+    }
 
-        WynikPobraniaDania wynik = sprobuj_pobrac_danie(
-            g, pa->shared_dania_pobrane, target, pa->czas_start_dania_ptr);
-        if (wynik == POBRANIE_POMINIETO_INNY_STOLIK)
-        {
-            sched_yield();
-            continue;
-        }
+    return (int)sprobuj_pobrac_danie(pa->g, pa->shared_dania_pobrane, target,
+                                     pa->czas_start_dania_ptr, czekaj_ms);
+}
 
-        sched_yield();
-    }
+// Wątek osoby
+static void *person_thread(void *arg)
+{
+    PersonArg *pa = (PersonArg *)arg;
+
+    // Brak dania czeka w sprobuj_pobrac_danie() na budziku stolika, więc
+    // pętla nie kręci się na pusto.
+    while (krok_osoby(pa) >= 0)
+        ;
 
     free(pa);
     return NULL;
@@ -343,7 +240,7 @@ static void *person_thread(void *arg)
 // Spróbuj pobrać danie
 static WynikPobraniaDania
 sprobuj_pobrac_danie(struct Grupa *g, int *dania_pobrane, int dania_do_pobrania,
-                     struct timespec *czas_start_dania)
+                     struct timespec *czas_start_dania, int czekaj_ms)
 {
     int log_pobrano = 0;
     int log_cena = 0;
@@ -356,78 +253,80 @@ sprobuj_pobrac_danie(struct Grupa *g, int *dania_pobrane, int dania_do_pobrania,
     int numer_stolika = g->stolik_przydzielony + 1;
     int idx_tasma = -1;
     int cena = 0;
+    WynikPobraniaDania wynik = POBRANIE_BRAK;
 
-    // Najpierw spróbuj znaleźć danie specjalne dla tego stolika gdziekolwiek na
-    // taśmie.
-    for (int i = 0; i < MAX_TASMA; i++)
-    {
-        if (common_ctx->tasma[i].cena != 0 && common_ctx->tasma[i].stolik_specjalny == numer_stolika)
-        {
-            idx_tasma = i;
-            cena = common_ctx->tasma[i].cena;
-            break;
-        }
-    }
+    // Najpierw danie specjalne dla tego stolika gdziekolwiek na taśmie —
+    // lista dań specjalnych stolika (tasma.h) mówi od razu, czy jest i gdzie.
+    idx_tasma = tasma_specjalne_stolika(g->stolik_przydzielony);
+    if (idx_tasma != -1)
+        cena = tasma_pozycja(idx_tasma)->cena;
 
     // Jeśli nie znaleziono specjalnego, sprawdź standardowe danie na pozycji
     // stolika.
-    if (idx_tasma == -1 && common_ctx->tasma[g->stolik_przydzielony].cena != 0)
+    const struct Talerzyk *przed_stolikiem =
+        g->stolik_przydzielony < common_ctx->dlugosc_tasmy ? tasma_pozycja(g->stolik_przydzielony)
+                                                           : NULL;
+    if (idx_tasma == -1 && przed_stolikiem && przed_stolikiem->cena != 0)
     {
-        if (common_ctx->tasma[g->stolik_przydzielony].stolik_specjalny != 0 &&
-            common_ctx->tasma[g->stolik_przydzielony].stolik_specjalny != numer_stolika)
+        if (przed_stolikiem->stolik_specjalny != 0 &&
+            przed_stolikiem->stolik_specjalny != numer_stolika)
+            wynik = POBRANIE_POMINIETO_INNY_STOLIK;
+        else
         {
-            pthread_mutex_unlock(&common_ctx->tasma_sync->mutex);
-            return POBRANIE_POMINIETO_INNY_STOLIK;
+            idx_tasma = g->stolik_przydzielony;
+            cena = przed_stolikiem->cena;
         }
-        idx_tasma = g->stolik_przydzielony;
-        cena = common_ctx->tasma[g->stolik_przydzielony].cena;
     }
 
     if (idx_tasma != -1)
     {
+        // Liczniki grupy zmieniamy pod mutexem taśmy; krok_osoby() czyta
+        // je bez niego, stąd atomowy zapis.
         int idx = cena_na_indeks(cena);
-        pthread_mutex_lock(&klient_ctx->klient_dania_mutex);
         if (idx >= 0)
             g->pobrane_dania[idx]++;
 
-        (*dania_pobrane)++;
         log_pobrano = 1;
         log_cena = cena;
-        log_pobrane = *dania_pobrane;
-        pthread_mutex_unlock(&klient_ctx->klient_dania_mutex);
+        log_pobrane = __atomic_add_fetch(dania_pobrane, 1, __ATOMIC_RELAXED);
 
-        common_ctx->tasma[idx_tasma].cena = 0;
-        common_ctx->tasma[idx_tasma].stolik_specjalny = 0;
-        if (common_ctx->tasma_sync->count > 0)
-            common_ctx->tasma_sync->count--;
+        tasma_zdejmij(idx_tasma);
         pthread_cond_signal(&common_ctx->tasma_sync->not_full);
+        // Ostatnie danie grupy: pozostałe osoby śpią na budziku, a nowy talerz
+        // może już nie przyjść — budzimy stolik, żeby zauważyły koniec.
+        if (log_pobrane >= dania_do_pobrania)
+            tasma_obudz_stolik(g->stolik_przydzielony, INT_MAX);
         LOGD("sprobuj_pobrac_danie: grupa %d pobrała danie za %d zł z pozycji %d "
              "(count=%d)\n",
              log_pid, log_cena, idx_tasma, common_ctx->tasma_sync->count);
-        clock_gettime(CLOCK_MONOTONIC, czas_start_dania);
+        struct timespec teraz;
+        clock_gettime(CLOCK_MONOTONIC, &teraz);
+        long long czekano_ns = (long long)(teraz.tv_sec - czas_start_dania->tv_sec) * 1000000000LL +
+                               (teraz.tv_nsec - czas_start_dania->tv_nsec);
+        *czas_start_dania = teraz;
         pthread_mutex_unlock(&common_ctx->tasma_sync->mutex);
 
+        histogram_dodaj(common_ctx->oczekiwanie_na_danie,
+                        czekano_ns > 0 ? (unsigned long long)czekano_ns : 0);
         if (log_pobrano)
             LOGI("Grupa %d przy stoliku %d pobrała danie za %d zł (pobrane: %d/%d)\n",
                  log_pid, log_numer_stolika, log_cena, log_pobrane, log_do_pobrania);
         return POBRANIE_POBRANO;
     }
 
-    struct timespec ts;
-    if (clock_gettime(CLOCK_REALTIME, &ts) == 0)
-    {
-        ts.tv_nsec += 10 * 1000 * 1000; // 10ms
-        if (ts.tv_nsec >= 1000000000L)
-        {
-            ts.tv_sec += 1;
-            ts.tv_nsec -= 1000000000L;
-        }
-        (void)pthread_cond_timedwait(&common_ctx->tasma_sync->not_empty,
-                                     &common_ctx->tasma_sync->mutex, &ts);
-    }
-
+    // Cudze danie specjalne na naszej pozycji zejdzie dopiero przy obrocie
+    // taśmy, czyli po dodaniu dania — czekamy na to samo co przy pustej.
+    // Wartość budzika i zapis na czekających robimy pod mutexem taśmy, więc
+    // obsługa, która zmieni taśmę po jego zwolnieniu, na pewno nas obudzi.
+    // Korutyna parkuje się na tym samym słowie (planista_czekaj).
+    struct BudzikStolika *b =
+        &common_ctx->budziki[g->stolik_przydzielony];
+    int zdarzenia = __atomic_load_n(&b->zdarzenia, __ATOMIC_ACQUIRE);
+    tasma_zapisz_czekajacego(g->stolik_przydzielony);
     pthread_mutex_unlock(&common_ctx->tasma_sync->mutex);
-    return POBRANIE_BRAK;
+    (void)planista_czekaj(&b->zdarzenia, zdarzenia, czekaj_ms);
+    __atomic_sub_fetch(&b->czekajacy, 1, __ATOMIC_RELAXED);
+    return wynik;
 }
 
 // Zapłać za dania
@@ -440,21 +339,18 @@ static void zaplac_za_dania(const struct Grupa *g)
     int log_cena[6] = {0};
     int log_kwota[6] = {0};
 
-    pthread_mutex_lock(&common_ctx->tasma_sync->mutex);
-    pthread_mutex_lock(&klient_ctx->klient_dania_mutex);
+    // Osoby grupy już skończyły (wątki dołączone), liczniki się nie zmienią.
     for (int i = 0; i < 6; i++)
     {
         if (g->pobrane_dania[i] == 0)
             continue;
         int kwota = g->pobrane_dania[i] * CENY_DAN[i];
-        common_ctx->kasa_dania_sprzedane[i] += g->pobrane_dania[i];
+        statystyki_dodaj(STAT_DANIA_SPRZEDANE + i, g->pobrane_dania[i]);
 
         log_ilosc[i] = g->pobrane_dania[i];
         log_cena[i] = CENY_DAN[i];
         log_kwota[i] = kwota;
     }
-    pthread_mutex_unlock(&klient_ctx->klient_dania_mutex);
-    pthread_mutex_unlock(&common_ctx->tasma_sync->mutex);
 
     for (int i = 0; i < 6; i++)
     {
@@ -470,38 +366,46 @@ static void opusc_stolik(const struct Grupa *g)
 {
     pid_t log_pid = g->numer_grupy;
     int log_numer_stolika = g->stolik_przydzielony + 1;
+    int szatnia = szatnia_stolika(g->stolik_przydzielony);
 
-    pthread_mutex_lock(&common_ctx->stoliki_sync->mutex);
-    for (int j = 0; j < common_ctx->stoliki[g->stolik_przydzielony].liczba_grup; j++)
+    pthread_mutex_lock(stoliki_mutex(szatnia));
+    (void)stolik_usun_grupe(g->stolik_przydzielony, g);
+    pthread_mutex_unlock(stoliki_mutex(szatnia));
+    szatnia_powiadom(szatnia);
+
+    /* Zliczamy opuszczających klientów (osoby), nie tylko grupy. */
+    statystyki_dodaj(STAT_KLIENCI_OPUSCILI, g->osoby);
+    LOGP("Grupa %d przy stoliku %d opuszcza restaurację.\n", log_pid,
+         log_numer_stolika);
+}
+
+// Osoby grupy w trybie korutyn: zamiast wątku na osobę wykonujemy kroki
+// wszystkich osób po kolei i oddajemy wątek planisty między rundami.
+static void petla_osob_w_zadaniu(PersonArg *osoby, int persons)
+{
+    int aktywne = persons;
+    while (aktywne > 0)
     {
-        if (common_ctx->stoliki[g->stolik_przydzielony].grupy[j].numer_grupy ==
-            g->numer_grupy)
+        int pobrano = 0;
+        aktywne = 0;
+        for (int i = 0; i < persons; i++)
         {
-            for (int k = j; k < common_ctx->stoliki[g->stolik_przydzielony].liczba_grup - 1;
-                 k++)
+            if (!osoby[i].g)
+                continue;
+            int wynik = krok_osoby(&osoby[i]);
+            if (wynik < 0)
             {
-                common_ctx->stoliki[g->stolik_przydzielony].grupy[k] =
-                    common_ctx->stoliki[g->stolik_przydzielony].grupy[k + 1];
+                osoby[i].g = NULL;
+                continue;
             }
-            memset(&common_ctx->stoliki[g->stolik_przydzielony]
-                        .grupy[common_ctx->stoliki[g->stolik_przydzielony].liczba_grup - 1],
-                   0, sizeof(struct Grupa));
-            common_ctx->stoliki[g->stolik_przydzielony].liczba_grup--;
-            common_ctx->stoliki[g->stolik_przydzielony].zajete_miejsca -= g->osoby;
-            break;
+            aktywne++;
+            if (wynik == POBRANIE_POBRANO)
+                pobrano = 1;
         }
+        // Bez dania osoba już przeczekała na budziku stolika.
+        if (aktywne > 0 && pobrano)
+            planista_ustap();
     }
-    pthread_mutex_unlock(&common_ctx->stoliki_sync->mutex);
-
-    /* Zliczamy opuszczających klientów (osoby), nie tylko grupy. */
-    if (common_ctx->statystyki_sync &&
-        pthread_mutex_lock(&common_ctx->statystyki_sync->mutex) == 0)
-    {
-        (*common_ctx->klienci_opuscili) += g->osoby;
-        pthread_mutex_unlock(&common_ctx->statystyki_sync->mutex);
-    }
-    LOGP("Grupa %d przy stoliku %d opuszcza restaurację.\n", log_pid,
-         log_numer_stolika);
 }
 
 // Pętla czekania na dania
@@ -510,7 +414,8 @@ static void petla_czekania_na_dania(struct Grupa *g)
     // Wielowątkowa: uruchom jeden wątek na osobę (dorosły/dziecko). Główny wątek
     // będzie czekać na ich zakończenie. Jeden wyznaczony wątek lider będzie
     // obsługiwał zamówienia specjalne, aby uniknąć wyścigów. Wspólne liczniki są
-    // chronione przez `klient_dania_mutex` (zakres pliku).
+    // lokalne dla grupy: pobrane zmieniają się pod mutexem taśmy, a oba czyta
+    // się atomowo.
 
     int dania_do_pobrania = rand() % 8 + 3;
     int shared_dania_pobrane = 0;
@@ -519,6 +424,25 @@ static void petla_czekania_na_dania(struct Grupa *g)
     int timeout_dania_ms = 10;
 
     int persons = g->osoby;
+    if (planista_w_zadaniu())
+    {
+        PersonArg osoby[4];
+        for (int i = 0; i < persons && i < 4; i++)
+        {
+            osoby[i] = (PersonArg){
+                .g = g,
+                .is_lead = (i == 0),
+                .is_adult = (i < g->dorosli),
+                .shared_dania_pobrane = &shared_dania_pobrane,
+                .dania_do_pobrania_ptr = &dania_do_pobrania,
+                .czas_start_dania_ptr = &czas_start_dania,
+                .timeout_dania_ms = timeout_dania_ms,
+            };
+        }
+        petla_osob_w_zadaniu(osoby, persons < 4 ? persons : 4);
+        return;
+    }
+
     pthread_t *threads = calloc(persons, sizeof(pthread_t));
     if (!threads)
     {
@@ -561,38 +485,41 @@ static void petla_czekania_na_dania(struct Grupa *g)
     free(threads);
 }
 
-// Główna funkcja klienta
-void klient(int numer_grupy)
+// Zapisuje czas od planowanego przybycia do usadzenia. Wyzerowany wpis mówi
+// rodzicowi, że grupa siedzi (nieusadzone dolicza przy podsumowaniu).
+static void zapisz_usadzenie(const struct Grupa *g)
 {
-    if (signal(SIGTERM, klient_obsluz_sigterm) == SIG_ERR)
-        LOGE_ERRNO("signal(SIGTERM)");
-    ustaw_shutdown_flag(&klient_ctx->prosba_zamkniecia);
-    if (signal(SIGUSR1, klient_obsluz_sigusr1) == SIG_ERR)
-        LOGE_ERRNO("signal(SIGUSR1)");
+    long long plan = __atomic_exchange_n(&common_ctx->przybycia_ns[g->numer_grupy],
+                                         0, __ATOMIC_RELAXED);
+    if (plan <= 0)
+        return;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    long long teraz = (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    unsigned long long czekanie = teraz > plan ? (unsigned long long)(teraz - plan) : 0;
+    histogram_dodaj(common_ctx->opoznienie_usadzenia, czekanie);
+    if (g->osoby >= 1 && g->osoby <= 4)
+        histogram_dodaj(&common_ctx->usadzenie_wg_osob[g->osoby - 1], czekanie);
+    histogram_dodaj(&common_ctx->usadzenie_wg_klasy[klasa_grupy(g)], czekanie);
+}
 
+// Obsługa jednej grupy od wejścia do wyjścia. Nie kończy procesu, więc może
+// działać zarówno w procesie `klient`, jak i w korutynie rodzica.
+void klient_obsluz_grupe(int numer_grupy)
+{
     struct Grupa g = inicjalizuj_grupe(numer_grupy);
 
-    if (g.vip)
-    {
-        usadz_grupe_vip(&g);
-        if (g.stolik_przydzielony == -1)
-        {
-            // Miejsce VIP niedostępne; powrót do normalnej obsługi kolejki.
-            if (czekaj_na_przydzial_stolika(&g) != 0)
-                exit(0);
-        }
-    }
-    else
-    {
-        if (czekaj_na_przydzial_stolika(&g) != 0)
-            exit(0);
-    }
+    // Grupa VIP idzie pasem VIP kolejki (kolejka.h), a o kolejności usadzania
+    // decyduje szatnia.
+    if (czekaj_na_przydzial_stolika(&g) != 0)
+        return;
+    zapisz_usadzenie(&g);
 
     if (klient_ctx->prosba_zamkniecia || !*common_ctx->restauracja_otwarta)
     {
         if (g.stolik_przydzielony != -1)
             opusc_stolik(&g);
-        exit(0);
+        return;
     }
 
     petla_czekania_na_dania(&g);
@@ -600,15 +527,144 @@ void klient(int numer_grupy)
     if (klient_ctx->prosba_zamkniecia || !*common_ctx->restauracja_otwarta)
     {
         opusc_stolik(&g);
-        exit(0);
+        return;
     }
 
     zaplac_za_dania(&g);
     opusc_stolik(&g);
+    statystyki_dodaj(STAT_GRUPY_OBSLUZONE, 1);
+}
+
+// sigaction zamiast signal(): przy _POSIX_C_SOURCE glibc daje semantykę SysV
+// (handler resetowany po pierwszym sygnale). Bez SA_RESTART, żeby SIGTERM
+// przerywał czekanie na skrzynce i na budziku stolika.
+static void ustaw_sygnaly_klienta(void)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = klient_obsluz_sigterm;
+    if (sigaction(SIGTERM, &sa, NULL) != 0)
+        LOGE_ERRNO("sigaction(SIGTERM)");
+    ustaw_shutdown_flag(&klient_ctx->prosba_zamkniecia);
+}
+
+// Pracownik puli: obsługuje kolejne grupy w jednym procesie, więc exec,
+// dolacz_ipc i inicjalizację logera płacimy raz na pracownika, nie na grupę.
+static void klient_pula(void)
+{
+    ustaw_sygnaly_klienta();
+    while (!klient_ctx->prosba_zamkniecia)
+    {
+        int numer_grupy = pula_pobierz(&klient_ctx->prosba_zamkniecia);
+        if (numer_grupy < 0)
+            break;
+        klient_obsluz_grupe(numer_grupy);
+        grupy_zwolnij();
+    }
+    exit(0);
+}
+
+// Zbiera zakończone dzieci zygoty. Każde to jedna grupa, więc oddajemy jej
+// miejsce w limicie grup — także gdy proces zginął od sygnału.
+static void zbierz_dzieci_zygoty(int sfd)
+{
+    struct signalfd_siginfo si[16];
+    if (sfd >= 0)
+        while (read(sfd, si, sizeof(si)) > 0)
+            ;
+    while (waitpid(-1, NULL, WNOHANG) > 0)
+        grupy_zwolnij();
+}
+
+// Zygota: ma już dołączone shm/semafory/kolejkę i zainicjowany loger, więc
+// grupa kosztuje jeden fork() (bez exec i shmat). Dzieci zbiera sama: SIGCHLD
+// jest zablokowany i odbierany przez signalfd obok stdin. Kończy się po EOF
+// na stdin albo po SIGTERM.
+static void klient_zygota(void)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    // Bez SA_RESTART: SIGTERM ma przerwać blokujący poll().
+    sa.sa_handler = klient_obsluz_sigterm;
+    if (sigaction(SIGTERM, &sa, NULL) != 0)
+        LOGE_ERRNO("sigaction(SIGTERM)");
+
+    sigset_t maska;
+    sigemptyset(&maska);
+    sigaddset(&maska, SIGCHLD);
+    (void)sigprocmask(SIG_BLOCK, &maska, NULL);
+    int sfd = signalfd(-1, &maska, SFD_NONBLOCK | SFD_CLOEXEC);
+    // Bez signalfd zbieramy co POLL_MS_MED.
+    if (sfd < 0)
+        LOGE_ERRNO("signalfd(zygota)");
+    struct pollfd pfd[2] = {{.fd = STDIN_FILENO, .events = POLLIN},
+                            {.fd = sfd, .events = POLLIN}};
+
+    while (!klient_ctx->prosba_zamkniecia)
+    {
+        zbierz_dzieci_zygoty(sfd);
+        if (poll(pfd, 2, sfd >= 0 ? -1 : POLL_MS_MED) <= 0 || pfd[0].revents == 0)
+            continue;
+        int numer_grupy;
+        ssize_t r = read(STDIN_FILENO, &numer_grupy, sizeof(numer_grupy));
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r != (ssize_t)sizeof(numer_grupy))
+            break;
+        // Generator zajął już miejsce dla tej grupy.
+        if (!*common_ctx->restauracja_otwarta)
+        {
+            grupy_zwolnij();
+            continue;
+        }
 
+        // Przy EAGAIN (limit procesów/pamięci) ponawiamy z rosnącą przerwą
+        // zamiast gubić grupę.
+        unsigned przerwa_ms = 1;
+        pid_t pid;
+        while ((pid = fork()) < 0 && (errno == EAGAIN || errno == ENOMEM) &&
+               !klient_ctx->prosba_zamkniecia)
+        {
+            (void)usypiaj_ms(przerwa_ms);
+            if (przerwa_ms < 1000)
+                przerwa_ms *= 2;
+        }
+        if (pid == 0)
+        {
+            if (sfd >= 0)
+                (void)close(sfd);
+            (void)sigprocmask(SIG_UNBLOCK, &maska, NULL);
+            (void)close(STDIN_FILENO);
+            zainicjuj_losowosc();
+            klient(numer_grupy);
+        }
+        if (pid < 0)
+        {
+            LOGE_ERRNO("fork(zygota)");
+            grupy_zwolnij();
+        }
+    }
+    exit(0);
+}
+
+// Główna funkcja klienta
+void klient(int numer_grupy)
+{
+    if (numer_grupy == KLIENT_TRYB_PULA)
+        klient_pula();
+    if (numer_grupy == KLIENT_TRYB_ZYGOTA)
+        klient_zygota();
+
+    // Miejsce grupy w limicie zwalnia rodzic przy zebraniu procesu
+    // (zbieracz_zarejestruj_grupe()) albo zygota (zbierz_dzieci_zygoty()).
+    ustaw_sygnaly_klienta();
+    klient_obsluz_grupe(numer_grupy);
     exit(0);
 }
 
+#ifndef KLIENT_BEZ_MAIN
 // Główny punkt wejścia
 int main(int argc, char **argv)
 {
@@ -619,3 +675,4 @@ int main(int argc, char **argv)
     klient(numer_grupy);
     return 0;
 }
+#endif
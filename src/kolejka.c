@@ -0,0 +1,181 @@
+#include "kolejka.h"
+#include "statystyki.h"
+
+#include <limits.h>
+
+#define MASKA (KOLEJKA_POJEMNOSC - 1)
+
+_Static_assert((KOLEJKA_POJEMNOSC & MASKA) == 0, "KOLEJKA_POJEMNOSC musi być potęgą dwójki");
+
+// Oczekiwanie na futeksie ma limit, żeby zamknięcie zauważyć nawet bez
+// jawnego budzenia (np. gdy rodzic zginął od SIGKILL).
+#define KOLEJKA_CZEKAJ_MS 1000
+
+static int czy_koniec(volatile sig_atomic_t *stop)
+{
+    return !*common_ctx->restauracja_otwarta || (stop && *stop);
+}
+
+static struct KolejkaGrup *kolejka_szatni(int szatnia, int klasa)
+{
+    return &common_ctx->kolejka[szatnia * KLASY_KOLEJKI + klasa];
+}
+
+// Pierścień, do którego trafia grupa: szatnia wg liczby osób, klasa wg VIP.
+static struct KolejkaGrup *kolejka_grupy(const struct Grupa *g)
+{
+    return kolejka_szatni(szatnia_grupy(g->osoby), klasa_grupy(g));
+}
+
+void kolejka_inicjuj(void)
+{
+    for (int i = 0; i < common_ctx->liczba_szatni * KLASY_KOLEJKI; i++)
+    {
+        struct KolejkaGrup *k = &common_ctx->kolejka[i];
+        k->glowa = 0;
+        k->ogon = 0;
+        k->wolne = KOLEJKA_POJEMNOSC;
+        for (unsigned int poz = 0; poz < KOLEJKA_POJEMNOSC; poz++)
+            k->komorki[poz].sekwencja = poz;
+    }
+}
+
+// ====== PIERŚCIEŃ ======
+
+static int pierscien_wstaw(struct KolejkaGrup *k, const struct Grupa *g)
+{
+    unsigned int poz = __atomic_load_n(&k->glowa, __ATOMIC_RELAXED);
+    struct KomorkaKolejki *c;
+    for (;;)
+    {
+        c = &k->komorki[poz & MASKA];
+        unsigned int sek = __atomic_load_n(&c->sekwencja, __ATOMIC_ACQUIRE);
+        int roznica = (int)(sek - poz);
+        if (roznica == 0)
+        {
+            if (__atomic_compare_exchange_n(&k->glowa, &poz, poz + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (roznica < 0)
+            return -1; // pełny (przy żetonach nie powinno się zdarzyć)
+        else
+            poz = __atomic_load_n(&k->glowa, __ATOMIC_RELAXED);
+    }
+    c->grupa = *g;
+    __atomic_store_n(&c->sekwencja, poz + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static int pierscien_pobierz(struct KolejkaGrup *k, struct Grupa *g)
+{
+    unsigned int poz = __atomic_load_n(&k->ogon, __ATOMIC_RELAXED);
+    struct KomorkaKolejki *c;
+    for (;;)
+    {
+        c = &k->komorki[poz & MASKA];
+        unsigned int sek = __atomic_load_n(&c->sekwencja, __ATOMIC_ACQUIRE);
+        int roznica = (int)(sek - (poz + 1));
+        if (roznica == 0)
+        {
+            if (__atomic_compare_exchange_n(&k->ogon, &poz, poz + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (roznica < 0)
+            return -1; // pusty
+        else
+            poz = __atomic_load_n(&k->ogon, __ATOMIC_RELAXED);
+    }
+    *g = c->grupa;
+    __atomic_store_n(&c->sekwencja, poz + KOLEJKA_POJEMNOSC, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Wstawia do pierścienia (żeton już wzięty). Szatnię budzi klient przez
+// szatnia_powiadom().
+static void wstaw_z_zetonem(struct KolejkaGrup *k, const struct Grupa *g)
+{
+    // Licznik osób najpierw, żeby suma nie zeszła chwilowo poniżej zera.
+    statystyki_dodaj(STAT_KLIENCI_W_KOLEJCE, g->osoby);
+    if (pierscien_wstaw(k, g) != 0)
+    {
+        statystyki_dodaj(STAT_KLIENCI_W_KOLEJCE, -g->osoby);
+        LOGE("kolejka: pierścień pełny mimo żetonu (grupa %d)\n", g->numer_grupy);
+    }
+}
+
+// ====== ŻETONY ======
+
+static int wez_zeton(struct KolejkaGrup *k)
+{
+    int *wolne = &k->wolne;
+    int v = __atomic_load_n(wolne, __ATOMIC_RELAXED);
+    while (v > 0)
+    {
+        if (__atomic_compare_exchange_n(wolne, &v, v - 1, 1, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED))
+            return 0;
+    }
+    return -1;
+}
+
+void kolejka_zwolnij_miejsce(int szatnia, int klasa) { kolejka_zwolnij_miejsca(szatnia, klasa, 1); }
+
+void kolejka_zwolnij_miejsca(int szatnia, int klasa, int ile)
+{
+    struct KolejkaGrup *k = kolejka_szatni(szatnia, klasa);
+    __atomic_add_fetch(&k->wolne, ile, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&k->czekajacy_na_miejsce, __ATOMIC_SEQ_CST) > 0)
+    {
+        futex_obudz(&k->wolne, ile);
+        korutyny_obudz(&k->wolne);
+    }
+}
+
+// ====== API ======
+
+int kolejka_wstaw(const struct Grupa *g, volatile sig_atomic_t *stop, FunkcjaCzekania czekaj)
+{
+    struct KolejkaGrup *k = kolejka_grupy(g);
+    while (wez_zeton(k) != 0)
+    {
+        if (czy_koniec(stop))
+            return -1;
+        __atomic_add_fetch(&k->czekajacy_na_miejsce, 1, __ATOMIC_SEQ_CST);
+        (void)czekaj(&k->wolne, 0, KOLEJKA_CZEKAJ_MS);
+        __atomic_sub_fetch(&k->czekajacy_na_miejsce, 1, __ATOMIC_RELAXED);
+    }
+    wstaw_z_zetonem(k, g);
+    return 0;
+}
+
+int kolejka_sprobuj_pobierz(int szatnia, int klasa, struct Grupa *g)
+{
+    // STAT_KLIENCI_W_KOLEJCE zmniejsza szatnia przy usadzeniu: na jej
+    // listach grupa nadal czeka.
+    return pierscien_pobierz(kolejka_szatni(szatnia, klasa), g);
+}
+
+int kolejka_dlugosc(void)
+{
+    int suma = 0;
+    for (int i = 0; i < common_ctx->liczba_szatni * KLASY_KOLEJKI; i++)
+    {
+        struct KolejkaGrup *k = &common_ctx->kolejka[i];
+        unsigned int glowa = __atomic_load_n(&k->glowa, __ATOMIC_RELAXED);
+        unsigned int ogon = __atomic_load_n(&k->ogon, __ATOMIC_RELAXED);
+        int n = (int)(glowa - ogon);
+        suma += n < 0 ? 0 : n;
+    }
+    return suma;
+}
+
+void kolejka_obudz_wszystkich(void)
+{
+    for (int i = 0; i < common_ctx->liczba_szatni * KLASY_KOLEJKI; i++)
+    {
+        futex_obudz(&common_ctx->kolejka[i].wolne, INT_MAX);
+        korutyny_obudz(&common_ctx->kolejka[i].wolne);
+    }
+}
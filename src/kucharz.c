@@ -1,4 +1,5 @@
 #include "kucharz.h"
+#include "statystyki.h"
 
 #include <stdarg.h>
 #include <stdio.h>
@@ -27,15 +28,16 @@ static void drukuj_podsumowanie_kuchni(void)
     size_t offset = 0;
 
     dopisz_do_bufora(buf, sizeof(buf), &offset, "\n\n========== PODSUMOWANIE KUCHNI =================\n");
-    int kuchnia_suma = 0;
+    long long kuchnia_suma = 0;
     for (int i = 0; i < 6; i++)
     {
+        long long wydane = statystyki_suma(STAT_DANIA_WYDANE + i);
         dopisz_do_bufora(buf, sizeof(buf), &offset,
-                         "Kuchnia - liczba wydanych dań za %d zł: %d\n",
-                         CENY_DAN[i], common_ctx->kuchnia_dania_wydane[i]);
-        kuchnia_suma += common_ctx->kuchnia_dania_wydane[i] * CENY_DAN[i];
+                         "Kuchnia - liczba wydanych dań za %d zł: %lld\n",
+                         CENY_DAN[i], wydane);
+        kuchnia_suma += wydane * CENY_DAN[i];
     }
-    dopisz_do_bufora(buf, sizeof(buf), &offset, "================================================\nSuma: %d zł\n\n", kuchnia_suma);
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "================================================\nSuma: %lld zł\n\n", kuchnia_suma);
     dopisz_do_bufora(buf, sizeof(buf), &offset, "Kucharz kończy pracę.\n");
     dopisz_do_bufora(buf, sizeof(buf), &offset, "================================================\n");
 
@@ -1,5 +1,6 @@
 #include "obsluga.h"
-#include <sched.h>
+#include "statystyki.h"
+#include "tasma.h"
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,7 +33,7 @@ static void wypisz_podsumowanie(void);
 static int zbierz_zamowienia_specjalne(struct SpecOrder *orders, int max);
 static void wyczysc_rezerwacje_specjalne(const struct SpecOrder *orders,
                                          int count);
-static void dodaj_danie(struct Talerzyk *tasma_local, int cena);
+static int dodaj_danie(int cena, int stolik_specjalny);
 static void dopisz_do_bufora(char *buf, size_t rozmiar, size_t *offset,
                              const char *fmt, ...);
 
@@ -56,51 +57,52 @@ static void *watek_podawania(void *arg)
             ostatnia_wydajnosc = biezaca_wydajnosc;
         }
 
+        // Przy pełnej taśmie wątek śpi w dodaj_danie() na not_full.
         double wydajnosc = (double)biezaca_wydajnosc;
         obsluga_podaj_dania_normalne(wydajnosc);
-        sched_yield();
     }
 
     return NULL;
 }
 
-static void dodaj_danie(struct Talerzyk *tasma_local, int cena)
+// Wołać z zablokowanym mutexem taśmy. Zwraca 0 po dodaniu, -1 gdy taśma
+// jest pełna, a restauracja się zamyka (rodzic budzi not_full przy zamknięciu).
+// `stolik_specjalny` = 0 dla dania zwykłego. Obrót i położenie dania to
+// tasma_poloz() — stały koszt. Po obrocie budzi tylko stoliki ze śpiącymi
+// osobami, które mają co zdjąć (tasma_powiadom_stoliki()).
+static int dodaj_danie(int cena, int stolik_specjalny)
 {
-    while (common_ctx->tasma_sync->count >= MAX_TASMA)
+    int dlugosc = common_ctx->dlugosc_tasmy;
+    while (common_ctx->tasma_sync->count >= dlugosc)
     {
+        if (!*common_ctx->restauracja_otwarta || obsl_ctx->shutdown_requested)
+            return -1;
         (void)pthread_cond_wait(&common_ctx->tasma_sync->not_full,
                                 &common_ctx->tasma_sync->mutex);
     }
 
-    do
-    {
-        struct Talerzyk ostatni = tasma_local[MAX_TASMA - 1];
-
-        for (int i = MAX_TASMA - 1; i > 0; i--)
-        {
-            tasma_local[i] = tasma_local[i - 1];
-        }
-
-        tasma_local[0] = ostatni; // WRACA NA POCZĄTEK
-    } while (tasma_local[0].cena != 0);
-
-    tasma_local[0].cena = cena;
-    tasma_local[0].stolik_specjalny = 0;
-    common_ctx->tasma_sync->count++;
-    pthread_cond_signal(&common_ctx->tasma_sync->not_empty);
+    tasma_poloz(cena, stolik_specjalny);
+    tasma_powiadom_stoliki(stolik_specjalny);
     LOGD("dodaj_danie: wydano danie za %d zł na taśmę (count=%d)\n", cena,
          common_ctx->tasma_sync->count);
+    return 0;
 }
 
 // Wątek obsługi zamówień specjalnych
 static void *watek_specjalne(void *arg)
 {
     (void)arg;
+    // Najwyżej jedno zamówienie na grupę przy stoliku.
+    int max_zamowien = common_ctx->liczba_stolikow * common_ctx->grup_na_stoliku;
+    struct SpecOrder *orders = calloc((size_t)max_zamowien, sizeof(*orders));
+    if (!orders)
+    {
+        LOGE("Brak pamięci na zamówienia specjalne\n");
+        return NULL;
+    }
     while (*common_ctx->restauracja_otwarta && !obsl_ctx->shutdown_requested)
     {
-        struct SpecOrder orders[MAX_STOLIKI * MAX_GRUP_NA_STOLIKU];
-        int count = zbierz_zamowienia_specjalne(orders,
-                                                MAX_STOLIKI * MAX_GRUP_NA_STOLIKU);
+        int count = zbierz_zamowienia_specjalne(orders, max_zamowien);
 
         if (count == 0)
             continue;
@@ -108,12 +110,15 @@ static void *watek_specjalne(void *arg)
         for (int i = 0; i < count; i++)
         {
             pthread_mutex_lock(&common_ctx->tasma_sync->mutex);
-            dodaj_danie(common_ctx->tasma, orders[i].cena);
-            common_ctx->tasma[0].stolik_specjalny = orders[i].numer_stolika;
+            if (dodaj_danie(orders[i].cena, orders[i].numer_stolika) != 0)
+            {
+                pthread_mutex_unlock(&common_ctx->tasma_sync->mutex);
+                break;
+            }
+            pthread_mutex_unlock(&common_ctx->tasma_sync->mutex);
             int idx = cena_na_indeks(orders[i].cena);
             if (idx >= 0)
-                common_ctx->kuchnia_dania_wydane[idx]++;
-            pthread_mutex_unlock(&common_ctx->tasma_sync->mutex);
+                statystyki_dodaj(STAT_DANIA_WYDANE + idx, 1);
 
             LOGP("Obsługa dodała danie specjalne za %d zł dla stolika %d\n",
                  orders[i].cena, orders[i].numer_stolika);
@@ -122,23 +127,24 @@ static void *watek_specjalne(void *arg)
         wyczysc_rezerwacje_specjalne(orders, count);
     }
 
+    free(orders);
     return NULL;
 }
 
 static int zbierz_zamowienia_specjalne(struct SpecOrder *orders, int max)
 {
     int count = 0;
-    if (pthread_mutex_lock(&common_ctx->stoliki_sync->mutex) != 0)
-        return 0;
+    stoliki_zablokuj_wszystkie();
 
-    for (int stolik = 0; stolik < MAX_STOLIKI; stolik++)
+    for (int stolik = 0; stolik < common_ctx->liczba_stolikow; stolik++)
     {
+        struct Grupa *grupy = stolik_grupy(stolik);
         for (int grupa = 0; grupa < common_ctx->stoliki[stolik].liczba_grup; grupa++)
         {
-            int cena_specjalna = common_ctx->stoliki[stolik].grupy[grupa].danie_specjalne;
+            int cena_specjalna = grupy[grupa].danie_specjalne;
             if (cena_specjalna > 0 && count < max)
             {
-                common_ctx->stoliki[stolik].grupy[grupa].danie_specjalne =
+                grupy[grupa].danie_specjalne =
                     -cena_specjalna; // reserve
                 orders[count].cena = cena_specjalna;
                 orders[count].numer_stolika = common_ctx->stoliki[stolik].numer_stolika;
@@ -149,6 +155,8 @@ static int zbierz_zamowienia_specjalne(struct SpecOrder *orders, int max)
         }
     }
 
+    /* Zostaje mutex pierwszej szatni — z nim czekamy na cond. */
+    stoliki_odblokuj_pozostale();
     if (count == 0 && *common_ctx->restauracja_otwarta && !obsl_ctx->shutdown_requested)
         (void)pthread_cond_wait(&common_ctx->stoliki_sync->cond,
                                 &common_ctx->stoliki_sync->mutex);
@@ -163,15 +171,14 @@ static void wyczysc_rezerwacje_specjalne(const struct SpecOrder *orders,
     if (count <= 0)
         return;
 
-    pthread_mutex_lock(&common_ctx->stoliki_sync->mutex);
+    stoliki_zablokuj_wszystkie();
     for (int i = 0; i < count; i++)
     {
-        int *slot = &common_ctx->stoliki[orders[i].stolik_idx]
-                         .grupy[orders[i].grupa_idx]
-                         .danie_specjalne;
+        int *slot = &stolik_grupy(orders[i].stolik_idx)[orders[i].grupa_idx].danie_specjalne;
         if (*slot == -orders[i].cena)
             *slot = 0;
     }
+    stoliki_odblokuj_pozostale();
     pthread_mutex_unlock(&common_ctx->stoliki_sync->mutex);
 }
 
@@ -257,11 +264,13 @@ static void obsluga_podaj_dania_normalne(double wydajnosc)
         int c = ceny[rand() % 3];
 
         pthread_mutex_lock(&common_ctx->tasma_sync->mutex);
-        dodaj_danie(common_ctx->tasma, c);
-        int idx = cena_na_indeks(c);
-        if (idx >= 0)
-            common_ctx->kuchnia_dania_wydane[idx]++;
+        int dodano = (dodaj_danie(c, 0) == 0);
         pthread_mutex_unlock(&common_ctx->tasma_sync->mutex);
+        int idx = cena_na_indeks(c);
+        if (dodano && idx >= 0)
+            statystyki_dodaj(STAT_DANIA_WYDANE + idx, 1);
+        if (!dodano)
+            return;
     }
 }
 
@@ -272,21 +281,22 @@ static void wypisz_podsumowanie(void)
     size_t offset = 0;
 
     dopisz_do_bufora(buf, sizeof(buf), &offset, "\n\n\n=========== PODSUMOWANIE KASY ==================\n");
-    int kasa_suma = 0;
+    long long kasa_suma = 0;
     for (int i = 0; i < 6; i++)
     {
+        long long sprzedane = statystyki_suma(STAT_DANIA_SPRZEDANE + i);
         dopisz_do_bufora(buf, sizeof(buf), &offset,
-                         "Kasa - liczba sprzedanych dań za %d zł: %d\n",
-                         CENY_DAN[i], common_ctx->kasa_dania_sprzedane[i]);
-        kasa_suma += common_ctx->kasa_dania_sprzedane[i] * CENY_DAN[i];
+                         "Kasa - liczba sprzedanych dań za %d zł: %lld\n",
+                         CENY_DAN[i], sprzedane);
+        kasa_suma += sprzedane * CENY_DAN[i];
     }
-    dopisz_do_bufora(buf, sizeof(buf), &offset, "================================================\nSuma: %d zł\n", kasa_suma);
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "================================================\nSuma: %lld zł\n", kasa_suma);
 
     dopisz_do_bufora(buf, sizeof(buf), &offset,
                      "\n=========== PODSUMOWANIE OBSŁUGI ===============\n");
     int tasma_dania_niesprzedane[6] = {0};
     pthread_mutex_lock(&common_ctx->tasma_sync->mutex);
-    for (int i = 0; i < MAX_TASMA; i++)
+    for (int i = 0; i < common_ctx->dlugosc_tasmy; i++)
     {
         if (common_ctx->tasma[i].cena != 0)
         {
@@ -308,8 +318,8 @@ static void wypisz_podsumowanie(void)
                      tasma_suma);
     dopisz_do_bufora(buf, sizeof(buf), &offset,
                      "\n================================================\nObsługa kończy pracę.\n");
-    dopisz_do_bufora(buf, sizeof(buf), &offset, "Nieobsłużeni klienci czekający w kolejce: %d\n",
-                     *common_ctx->klienci_w_kolejce);
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Nieobsłużeni klienci czekający w kolejce: %lld\n",
+                     statystyki_suma(STAT_KLIENCI_W_KOLEJCE));
     dopisz_do_bufora(buf, sizeof(buf), &offset, "================================================\n");
 
     loguj_blokiem('I', buf);
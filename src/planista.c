@@ -0,0 +1,754 @@
+#define _GNU_SOURCE
+#include "planista.h"
+
+#include "common.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+// Czekające zadanie nie krąży po kolejce: leży w kubełku swojego słowa
+// futeksa (planista_czekaj) i/lub w kopcu terminów wątku, na którym
+// zasnęło. Budzi je pierwsze z dwojga — zaznaczenie kubełka w
+// BudzeniaKorutyn albo termin; rozstrzyga CAS na `stan_czekania`. Kubełki
+// dzielą między siebie ZAMKI_KUBELKOW mutexów, więc parkowanie i budzenie na
+// różnych słowach nie czekają na siebie.
+#define ZAMKI_KUBELKOW 256
+
+enum StanZadania
+{
+    ZADANIE_BIEGNIE = 0,
+    ZADANIE_PARKUJE,    // zaraz odda wątek i zaśnie
+    ZADANIE_ZAPARKOWANE,
+    ZADANIE_OBUDZONE,   // obudzone, zanim oddało wątek
+};
+
+enum StanCzekania
+{
+    CZEKANIE_TRWA = 0,
+    CZEKANIE_OBUDZONE,
+    CZEKANIE_MINELO,
+};
+
+struct Robotnik;
+
+// ====== TYPY ======
+
+struct Zadanie
+{
+    ucontext_t kontekst;
+    void *stos;
+    PlanistaFunkcja fn;
+    void *arg;
+    int zakonczone;
+    int stan; // StanZadania
+    struct Zadanie *nast;
+    struct Zadanie *poprz;
+    // Bieżące czekanie (najwyżej jedno na zadanie).
+    int stan_czekania;
+    const int *adres;         // NULL = tylko termin (planista_uspij_ms)
+    unsigned int kubelek;
+    long long termin_ns;      // 0 = bez terminu
+    struct Robotnik *kopiec;  // wątek, w którego kopcu leży termin
+    int indeks_w_kopcu;       // -1 = poza kopcem
+    struct Zadanie *nast_w_kubelku;
+    struct Zadanie *poprz_w_kubelku;
+    struct Zadanie *nast_do_obudzenia;
+};
+
+// Wątek roboczy z własną kolejką: właściciel zdejmuje z głowy, złodzieje z
+// ogona. Kopiec terminów jego śpiących zadań zmienia tylko on, oprócz
+// wyjęcia zadania obudzonego wcześniej przez kogoś innego.
+struct Robotnik
+{
+    pthread_t watek;
+    int indeks;
+    pthread_mutex_t mutex;
+    struct Zadanie *glowa;
+    struct Zadanie *ogon;
+    int dlugosc;
+    ucontext_t kontekst_planisty;
+    struct Zadanie *biezace;
+    unsigned los;
+    pthread_mutex_t mutex_kopca;
+    struct Zadanie **kopiec;
+    int w_kopcu;
+    int pojemnosc_kopca;
+};
+
+struct ZamekKubelkow
+{
+    pthread_mutex_t mutex;
+} __attribute__((aligned(64)));
+
+// Kontekst modułu planisty
+struct PlanistaCtx
+{
+    struct Robotnik *robotnicy;
+    int liczba;
+    // Słowo futeksa bezczynnych wątków i zaznaczone kubełki: w segmencie,
+    // gdy jest (budzenia z innych procesów), inaczej lokalne.
+    struct BudzeniaKorutyn *budzenia;
+    struct BudzeniaKorutyn budzenia_lokalne;
+    struct ZamekKubelkow zamki[ZAMKI_KUBELKOW];
+    struct Zadanie *kubelki[KORUTYNY_KUBELKI];
+    int stop;
+    int zywe; // słowo futeksa planista_zatrzymaj()
+    long utworzone;
+    long szczyt;
+    long kradziezy;
+    unsigned nastepny;
+};
+
+static struct PlanistaCtx planista_ctx_storage;
+static struct PlanistaCtx *pl_ctx = &planista_ctx_storage;
+
+static __thread struct Robotnik *tls_robotnik = NULL;
+
+// ====== POMOCNIKI ======
+
+static long long teraz_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Zadanie może zostać wznowione na innym wątku niż został wstrzymany, więc
+ * odczyt zmiennej __thread nie może zostać zbuforowany przez kompilator
+ * w ramach funkcji wołającej. */
+static __attribute__((noinline)) struct Robotnik *biezacy_robotnik(void)
+{
+    struct Robotnik *w = tls_robotnik;
+    __asm__ __volatile__("" ::: "memory");
+    return w;
+}
+
+static void wstaw_zablokowany(struct Robotnik *w, struct Zadanie *z)
+{
+    z->nast = NULL;
+    z->poprz = w->ogon;
+    if (w->ogon)
+        w->ogon->nast = z;
+    else
+        w->glowa = z;
+    w->ogon = z;
+    w->dlugosc++;
+}
+
+static void sygnalizuj_prace(void);
+
+// Śpiący wątek budzimy też przy zwykłym wstawieniu: bez tego nie ukradłby
+// zadań z tej kolejki.
+static void wstaw(struct Robotnik *w, struct Zadanie *z)
+{
+    pthread_mutex_lock(&w->mutex);
+    wstaw_zablokowany(w, z);
+    pthread_mutex_unlock(&w->mutex);
+    if (__atomic_load_n(&pl_ctx->budzenia->uspieni, __ATOMIC_SEQ_CST) > 0)
+        sygnalizuj_prace();
+}
+
+static struct Zadanie *zdejmij_z_glowy(struct Robotnik *w)
+{
+    pthread_mutex_lock(&w->mutex);
+    struct Zadanie *z = w->glowa;
+    if (z)
+    {
+        w->glowa = z->nast;
+        if (w->glowa)
+            w->glowa->poprz = NULL;
+        else
+            w->ogon = NULL;
+        w->dlugosc--;
+    }
+    pthread_mutex_unlock(&w->mutex);
+    return z;
+}
+
+static struct Zadanie *zdejmij_z_ogona(struct Robotnik *w)
+{
+    if (pthread_mutex_trylock(&w->mutex) != 0)
+        return NULL;
+    struct Zadanie *z = w->ogon;
+    if (z)
+    {
+        w->ogon = z->poprz;
+        if (w->ogon)
+            w->ogon->nast = NULL;
+        else
+            w->glowa = NULL;
+        w->dlugosc--;
+    }
+    pthread_mutex_unlock(&w->mutex);
+    return z;
+}
+
+static struct Zadanie *ukradnij(struct Robotnik *w)
+{
+    int n = pl_ctx->liczba;
+    if (n <= 1)
+        return NULL;
+    unsigned start = rand_r(&w->los);
+    for (int i = 0; i < n; i++)
+    {
+        struct Robotnik *ofiara = &pl_ctx->robotnicy[(start + i) % n];
+        if (ofiara == w)
+            continue;
+        struct Zadanie *z = zdejmij_z_ogona(ofiara);
+        if (z)
+        {
+            __atomic_add_fetch(&pl_ctx->kradziezy, 1, __ATOMIC_RELAXED);
+            return z;
+        }
+    }
+    return NULL;
+}
+
+// Budzi jeden bezczynny wątek, jeśli jakiś śpi.
+static void sygnalizuj_prace(void)
+{
+    struct BudzeniaKorutyn *b = pl_ctx->budzenia;
+    __atomic_add_fetch(&b->licznik, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&b->uspieni, __ATOMIC_SEQ_CST) > 0)
+        futex_obudz(&b->licznik, 1);
+}
+
+// ====== KOPIEC TERMINÓW ======
+
+static void kopiec_zamien(struct Robotnik *w, int i, int j)
+{
+    struct Zadanie *t = w->kopiec[i];
+    w->kopiec[i] = w->kopiec[j];
+    w->kopiec[j] = t;
+    w->kopiec[i]->indeks_w_kopcu = i;
+    w->kopiec[j]->indeks_w_kopcu = j;
+}
+
+static void kopiec_w_gore(struct Robotnik *w, int i)
+{
+    while (i > 0 && w->kopiec[(i - 1) / 2]->termin_ns > w->kopiec[i]->termin_ns)
+    {
+        kopiec_zamien(w, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void kopiec_w_dol(struct Robotnik *w, int i)
+{
+    for (;;)
+    {
+        int m = i, l = 2 * i + 1, p = 2 * i + 2;
+        if (l < w->w_kopcu && w->kopiec[l]->termin_ns < w->kopiec[m]->termin_ns)
+            m = l;
+        if (p < w->w_kopcu && w->kopiec[p]->termin_ns < w->kopiec[m]->termin_ns)
+            m = p;
+        if (m == i)
+            return;
+        kopiec_zamien(w, i, m);
+        i = m;
+    }
+}
+
+// Wołać z mutex_kopca. -1 przy braku pamięci.
+static int kopiec_dodaj(struct Robotnik *w, struct Zadanie *z)
+{
+    if (w->w_kopcu == w->pojemnosc_kopca)
+    {
+        int nowa = w->pojemnosc_kopca ? 2 * w->pojemnosc_kopca : 64;
+        struct Zadanie **k = realloc(w->kopiec, sizeof(*k) * (size_t)nowa);
+        if (!k)
+            return -1;
+        w->kopiec = k;
+        w->pojemnosc_kopca = nowa;
+    }
+    z->kopiec = w;
+    z->indeks_w_kopcu = w->w_kopcu;
+    w->kopiec[w->w_kopcu++] = z;
+    kopiec_w_gore(w, z->indeks_w_kopcu);
+    return 0;
+}
+
+// Wołać z mutex_kopca.
+static void kopiec_usun(struct Robotnik *w, struct Zadanie *z)
+{
+    int i = z->indeks_w_kopcu;
+    if (i < 0)
+        return;
+    z->indeks_w_kopcu = -1;
+    if (--w->w_kopcu == i)
+        return;
+    w->kopiec[i] = w->kopiec[w->w_kopcu];
+    w->kopiec[i]->indeks_w_kopcu = i;
+    kopiec_w_gore(w, i);
+    kopiec_w_dol(w, w->kopiec[i]->indeks_w_kopcu);
+}
+
+// ====== PARKOWANIE ======
+
+// Kubełek słowa jak w korutyny_obudz(): po przesunięciu w segmencie.
+static unsigned int kubelek_adresu(const int *adres)
+{
+    if (common_ctx && common_ctx->segment)
+        return korutyny_kubelek((size_t)((const char *)adres - common_ctx->segment));
+    return korutyny_kubelek((size_t)adres);
+}
+
+static pthread_mutex_t *zamek_kubelka(unsigned int k)
+{
+    return &pl_ctx->zamki[k % ZAMKI_KUBELKOW].mutex;
+}
+
+// Wołać z zamkiem kubełka.
+static void kubelek_usun(struct Zadanie *z)
+{
+    if (z->poprz_w_kubelku)
+        z->poprz_w_kubelku->nast_w_kubelku = z->nast_w_kubelku;
+    else
+        pl_ctx->kubelki[z->kubelek] = z->nast_w_kubelku;
+    if (z->nast_w_kubelku)
+        z->nast_w_kubelku->poprz_w_kubelku = z->poprz_w_kubelku;
+    z->nast_w_kubelku = z->poprz_w_kubelku = NULL;
+}
+
+// Wznawia zaparkowane zadanie; jeśli jeszcze nie oddało wątku, zrobi to
+// wątek, na którym biegnie, zaraz po swapcontext.
+static void wznow(struct Zadanie *z)
+{
+    int stan = ZADANIE_PARKUJE;
+    if (__atomic_compare_exchange_n(&z->stan, &stan, ZADANIE_OBUDZONE, 0, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE))
+        return;
+    __atomic_store_n(&z->stan, ZADANIE_BIEGNIE, __ATOMIC_RELAXED);
+    struct Robotnik *w = biezacy_robotnik();
+    if (!w)
+        w = &pl_ctx->robotnicy[__atomic_fetch_add(&pl_ctx->nastepny, 1, __ATOMIC_RELAXED) %
+                               (unsigned)pl_ctx->liczba];
+    wstaw(w, z);
+}
+
+// Zadanie wygrało CAS na stan_czekania: wyjmuje je z kopca i wznawia.
+static void zakoncz_czekanie(struct Zadanie *z)
+{
+    // Właściciel kopca mógł już zdjąć zadanie (przegrał CAS) — wtedy
+    // indeks_w_kopcu = -1 i kopiec_usun() nic nie robi.
+    struct Robotnik *k = __atomic_load_n(&z->kopiec, __ATOMIC_ACQUIRE);
+    if (k)
+    {
+        pthread_mutex_lock(&k->mutex_kopca);
+        kopiec_usun(k, z);
+        pthread_mutex_unlock(&k->mutex_kopca);
+    }
+    wznow(z);
+}
+
+// Budzi zadania z kubełka `k` czekające na `adres` (NULL: wszystkie w
+// kubełku — zaznaczenie nie mówi, które słowo się zmieniło).
+static void obudz_kubelek(unsigned int k, const int *adres)
+{
+    struct Zadanie *do_obudzenia = NULL;
+    pthread_mutex_lock(zamek_kubelka(k));
+    struct Zadanie *z = pl_ctx->kubelki[k];
+    while (z)
+    {
+        struct Zadanie *nast = z->nast_w_kubelku;
+        int stan = CZEKANIE_TRWA;
+        if ((!adres || z->adres == adres) &&
+            __atomic_compare_exchange_n(&z->stan_czekania, &stan, CZEKANIE_OBUDZONE, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            kubelek_usun(z);
+            z->nast_do_obudzenia = do_obudzenia;
+            do_obudzenia = z;
+        }
+        z = nast;
+    }
+    pthread_mutex_unlock(zamek_kubelka(k));
+
+    while (do_obudzenia)
+    {
+        z = do_obudzenia;
+        do_obudzenia = z->nast_do_obudzenia;
+        zakoncz_czekanie(z);
+    }
+}
+
+// Zdejmuje kubełki zaznaczone przez korutyny_obudz() (także z innych
+// procesów). Może to robić kilka wątków naraz: każdy dostaje inne bity.
+static void odbierz_budzenia(void)
+{
+    struct BudzeniaKorutyn *b = pl_ctx->budzenia;
+    if (!__atomic_load_n(&b->podsumowanie, __ATOMIC_RELAXED))
+        return;
+    unsigned long long slowa = __atomic_exchange_n(&b->podsumowanie, 0, __ATOMIC_ACQ_REL);
+    while (slowa)
+    {
+        int i = __builtin_ctzll(slowa);
+        slowa &= slowa - 1;
+        unsigned long long bity = __atomic_exchange_n(&b->kubelki[i], 0, __ATOMIC_ACQ_REL);
+        while (bity)
+        {
+            int j = __builtin_ctzll(bity);
+            bity &= bity - 1;
+            obudz_kubelek((unsigned int)(i * 64 + j), NULL);
+        }
+    }
+}
+
+// Wznawia zadania tego wątku, którym minął termin.
+static void uplyw_terminow(struct Robotnik *w)
+{
+    long long teraz = 0;
+    for (;;)
+    {
+        pthread_mutex_lock(&w->mutex_kopca);
+        struct Zadanie *z = w->w_kopcu > 0 ? w->kopiec[0] : NULL;
+        if (z && !teraz)
+            teraz = teraz_ns();
+        if (!z || z->termin_ns > teraz)
+        {
+            pthread_mutex_unlock(&w->mutex_kopca);
+            return;
+        }
+        kopiec_usun(w, z);
+        int stan = CZEKANIE_TRWA;
+        int minelo = __atomic_compare_exchange_n(&z->stan_czekania, &stan, CZEKANIE_MINELO, 0,
+                                                 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+        pthread_mutex_unlock(&w->mutex_kopca);
+        if (!minelo)
+            continue;
+        if (z->adres)
+        {
+            pthread_mutex_lock(zamek_kubelka(z->kubelek));
+            kubelek_usun(z);
+            pthread_mutex_unlock(zamek_kubelka(z->kubelek));
+        }
+        wznow(z);
+    }
+}
+
+// Bezczynny wątek śpi na słowie `licznik` odczytanym przed szukaniem pracy
+// — do nowego zadania, zaznaczenia kubełka albo najbliższego terminu ze
+// swojego kopca.
+static void czekaj_na_prace(struct Robotnik *w, int licznik)
+{
+    struct BudzeniaKorutyn *b = pl_ctx->budzenia;
+    int ms = -1;
+    pthread_mutex_lock(&w->mutex_kopca);
+    if (w->w_kopcu > 0)
+    {
+        long long zostalo = w->kopiec[0]->termin_ns - teraz_ns();
+        long long z_ms = zostalo <= 0 ? 0 : (zostalo + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC;
+        ms = z_ms < INT_MAX ? (int)z_ms : INT_MAX;
+    }
+    pthread_mutex_unlock(&w->mutex_kopca);
+    if (ms == 0)
+        return;
+    __atomic_add_fetch(&b->uspieni, 1, __ATOMIC_SEQ_CST);
+    (void)futex_czekaj(&b->licznik, licznik, ms);
+    __atomic_sub_fetch(&b->uspieni, 1, __ATOMIC_SEQ_CST);
+}
+
+// Budzi wszystkie wątki, np. po zatrzymaniu.
+static void obudz_robotnikow(void)
+{
+    __atomic_add_fetch(&pl_ctx->budzenia->licznik, 1, __ATOMIC_SEQ_CST);
+    futex_obudz(&pl_ctx->budzenia->licznik, INT_MAX);
+}
+
+static void trampolina(void)
+{
+    struct Robotnik *w = biezacy_robotnik();
+    struct Zadanie *z = w->biezace;
+    z->fn(z->arg);
+    z->zakonczone = 1;
+    // Wracamy do planisty bieżącego wątku (mógł się zmienić po ustąpieniu).
+    w = biezacy_robotnik();
+    setcontext(&w->kontekst_planisty);
+}
+
+static void zwolnij_zadanie(struct Zadanie *z)
+{
+    free(z->stos);
+    free(z);
+}
+
+// ====== WĄTEK ROBOCZY ======
+
+static void *petla_robotnika(void *arg)
+{
+    struct Robotnik *w = (struct Robotnik *)arg;
+    tls_robotnik = w;
+
+    for (;;)
+    {
+        int licznik = __atomic_load_n(&pl_ctx->budzenia->licznik, __ATOMIC_SEQ_CST);
+        odbierz_budzenia();
+        uplyw_terminow(w);
+        struct Zadanie *z = zdejmij_z_glowy(w);
+        if (!z)
+            z = ukradnij(w);
+        if (!z)
+        {
+            if (__atomic_load_n(&pl_ctx->stop, __ATOMIC_SEQ_CST) &&
+                __atomic_load_n(&pl_ctx->zywe, __ATOMIC_ACQUIRE) == 0)
+                break;
+            czekaj_na_prace(w, licznik);
+            continue;
+        }
+
+        w->biezace = z;
+        swapcontext(&w->kontekst_planisty, &z->kontekst);
+        w->biezace = NULL;
+
+        if (z->zakonczone)
+        {
+            zwolnij_zadanie(z);
+            if (__atomic_sub_fetch(&pl_ctx->zywe, 1, __ATOMIC_SEQ_CST) == 0)
+            {
+                futex_obudz(&pl_ctx->zywe, INT_MAX);
+                if (__atomic_load_n(&pl_ctx->stop, __ATOMIC_SEQ_CST))
+                    obudz_robotnikow();
+            }
+            continue;
+        }
+        // Zaparkowane zadanie czeka poza kolejką; obudzone, zanim oddało
+        // wątek, wraca od razu.
+        int stan = ZADANIE_PARKUJE;
+        if (__atomic_compare_exchange_n(&z->stan, &stan, ZADANIE_ZAPARKOWANE, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            continue;
+        __atomic_store_n(&z->stan, ZADANIE_BIEGNIE, __ATOMIC_RELAXED);
+        wstaw(w, z);
+    }
+    return NULL;
+}
+
+// ====== API ======
+
+int planista_start(int watki)
+{
+    if (watki <= 0)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        watki = (n > 0) ? (int)n : 1;
+    }
+
+    pl_ctx->robotnicy = calloc((size_t)watki, sizeof(struct Robotnik));
+    if (!pl_ctx->robotnicy)
+    {
+        LOGE("planista: brak pamięci na wątki robocze\n");
+        return -1;
+    }
+    pl_ctx->liczba = watki;
+    pl_ctx->stop = 0;
+    for (int i = 0; i < ZAMKI_KUBELKOW; i++)
+        pthread_mutex_init(&pl_ctx->zamki[i].mutex, NULL);
+    pl_ctx->budzenia = common_ctx && common_ctx->budzenia_korutyn ? common_ctx->budzenia_korutyn
+                                                                : &pl_ctx->budzenia_lokalne;
+
+    for (int i = 0; i < watki; i++)
+    {
+        struct Robotnik *w = &pl_ctx->robotnicy[i];
+        w->indeks = i;
+        w->los = (unsigned)(i + 1) * 2654435761u;
+        pthread_mutex_init(&w->mutex, NULL);
+        pthread_mutex_init(&w->mutex_kopca, NULL);
+    }
+    for (int i = 0; i < watki; i++)
+    {
+        struct Robotnik *w = &pl_ctx->robotnicy[i];
+        if (pthread_create(&w->watek, NULL, petla_robotnika, w) != 0)
+        {
+            LOGE_ERRNO("pthread_create(planista)");
+            pl_ctx->liczba = i;
+            break;
+        }
+    }
+    return pl_ctx->liczba > 0 ? 0 : -1;
+}
+
+int planista_dodaj(PlanistaFunkcja fn, void *arg)
+{
+    if (pl_ctx->liczba <= 0)
+        return -1;
+
+    struct Zadanie *z = calloc(1, sizeof(*z));
+    if (!z)
+        return -1;
+    z->stos = malloc(PLANISTA_STOS_ROZMIAR);
+    if (!z->stos)
+    {
+        free(z);
+        return -1;
+    }
+    z->fn = fn;
+    z->arg = arg;
+    z->indeks_w_kopcu = -1;
+    getcontext(&z->kontekst);
+    z->kontekst.uc_stack.ss_sp = z->stos;
+    z->kontekst.uc_stack.ss_size = PLANISTA_STOS_ROZMIAR;
+    z->kontekst.uc_link = NULL;
+    makecontext(&z->kontekst, trampolina, 0);
+
+    long zywe = __atomic_add_fetch(&pl_ctx->zywe, 1, __ATOMIC_ACQ_REL);
+    __atomic_add_fetch(&pl_ctx->utworzone, 1, __ATOMIC_RELAXED);
+    long szczyt = __atomic_load_n(&pl_ctx->szczyt, __ATOMIC_RELAXED);
+    while (zywe > szczyt &&
+           !__atomic_compare_exchange_n(&pl_ctx->szczyt, &szczyt, zywe, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    struct Robotnik *w = biezacy_robotnik();
+    if (!w)
+    {
+        unsigned i = __atomic_fetch_add(&pl_ctx->nastepny, 1, __ATOMIC_RELAXED);
+        w = &pl_ctx->robotnicy[i % (unsigned)pl_ctx->liczba];
+    }
+    wstaw(w, z);
+    sygnalizuj_prace();
+    return 0;
+}
+
+int planista_w_zadaniu(void)
+{
+    struct Robotnik *w = biezacy_robotnik();
+    return w && w->biezace;
+}
+
+void planista_ustap(void)
+{
+    struct Robotnik *w = biezacy_robotnik();
+    if (!w || !w->biezace)
+    {
+        sched_yield();
+        return;
+    }
+    struct Zadanie *z = w->biezace;
+    swapcontext(&z->kontekst, &w->kontekst_planisty);
+    // Tu zadanie może już działać na innym wątku — nie używaj `w`.
+}
+
+// Parkuje bieżące zadanie `z` wątku `w`: z terminem trafia do kopca tego
+// wątku, z adresem — do kubełka; oddaje wątek, chyba że już je obudzono.
+// Zwraca 0 po obudzeniu, -1 po upływie terminu.
+static int zaparkuj(struct Robotnik *w, struct Zadanie *z, int *adres, int oczekiwana,
+                    long long termin_ns)
+{
+    z->adres = adres;
+    z->termin_ns = termin_ns;
+    z->kopiec = NULL;
+    __atomic_store_n(&z->stan_czekania, CZEKANIE_TRWA, __ATOMIC_RELAXED);
+    __atomic_store_n(&z->stan, ZADANIE_PARKUJE, __ATOMIC_RELEASE);
+    if (termin_ns > 0)
+    {
+        pthread_mutex_lock(&w->mutex_kopca);
+        int blad = kopiec_dodaj(w, z);
+        pthread_mutex_unlock(&w->mutex_kopca);
+        if (blad)
+        {
+            // Bez miejsca na termin: zwykłe ustąpienie.
+            __atomic_store_n(&z->stan, ZADANIE_BIEGNIE, __ATOMIC_RELAXED);
+            planista_ustap();
+            return 0;
+        }
+    }
+    if (adres)
+    {
+        unsigned int k = kubelek_adresu(adres);
+        z->kubelek = k;
+        pthread_mutex_lock(zamek_kubelka(k));
+        z->poprz_w_kubelku = NULL;
+        z->nast_w_kubelku = pl_ctx->kubelki[k];
+        if (z->nast_w_kubelku)
+            z->nast_w_kubelku->poprz_w_kubelku = z;
+        pl_ctx->kubelki[k] = z;
+        pthread_mutex_unlock(zamek_kubelka(k));
+        // Para seq_cst z korutyny_obudz(): albo budzący zobaczy nas, albo my
+        // nową wartość słowa.
+        __atomic_add_fetch(&pl_ctx->budzenia->zaparkowane, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(adres, __ATOMIC_SEQ_CST) != oczekiwana)
+            obudz_kubelek(k, adres);
+    }
+
+    if (__atomic_load_n(&z->stan, __ATOMIC_ACQUIRE) == ZADANIE_PARKUJE)
+        swapcontext(&z->kontekst, &w->kontekst_planisty);
+    // Tu zadanie może już działać na innym wątku — nie używaj `w`.
+    __atomic_store_n(&z->stan, ZADANIE_BIEGNIE, __ATOMIC_RELAXED);
+    if (adres)
+        __atomic_sub_fetch(&pl_ctx->budzenia->zaparkowane, 1, __ATOMIC_RELAXED);
+    return __atomic_load_n(&z->stan_czekania, __ATOMIC_ACQUIRE) == CZEKANIE_MINELO ? -1 : 0;
+}
+
+void planista_uspij_ms(unsigned ms)
+{
+    struct Robotnik *w = biezacy_robotnik();
+    if (!w || !w->biezace)
+    {
+        (void)usypiaj_ms(ms);
+        return;
+    }
+    (void)zaparkuj(w, w->biezace, NULL, 0, teraz_ns() + (long long)ms * NSEC_PER_MSEC);
+}
+
+int planista_czekaj(int *adres, int oczekiwana, int timeout_ms)
+{
+    struct Robotnik *w = biezacy_robotnik();
+    if (!w || !w->biezace)
+        return futex_czekaj(adres, oczekiwana, timeout_ms);
+    long long termin = timeout_ms >= 0 ? teraz_ns() + (long long)timeout_ms * NSEC_PER_MSEC : 0;
+    return zaparkuj(w, w->biezace, adres, oczekiwana, termin);
+}
+
+int planista_zatrzymaj(int sekundy)
+{
+    if (pl_ctx->liczba <= 0)
+        return 0;
+
+    __atomic_store_n(&pl_ctx->stop, 1, __ATOMIC_SEQ_CST);
+    obudz_robotnikow();
+
+    // Ostatnie kończące się zadanie budzi nas na `zywe`.
+    long long koniec = teraz_ns() + (long long)sekundy * 1000000000LL;
+    for (;;)
+    {
+        int zywe = __atomic_load_n(&pl_ctx->zywe, __ATOMIC_ACQUIRE);
+        if (zywe == 0)
+            break;
+        long long zostalo = koniec - teraz_ns();
+        if (zostalo <= 0)
+        {
+            // Wątki zostają odłączone; proces i tak zaraz się kończy.
+            for (int i = 0; i < pl_ctx->liczba; i++)
+                (void)pthread_detach(pl_ctx->robotnicy[i].watek);
+            return zywe;
+        }
+        (void)futex_czekaj(&pl_ctx->zywe, zywe,
+                           (int)((zostalo + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC));
+    }
+
+    for (int i = 0; i < pl_ctx->liczba; i++)
+        (void)pthread_join(pl_ctx->robotnicy[i].watek, NULL);
+    return 0;
+}
+
+int planista_liczba_watkow(void) { return pl_ctx->liczba; }
+
+long planista_zadania_utworzone(void)
+{
+    return __atomic_load_n(&pl_ctx->utworzone, __ATOMIC_RELAXED);
+}
+
+long planista_zadania_szczyt(void)
+{
+    return __atomic_load_n(&pl_ctx->szczyt, __ATOMIC_RELAXED);
+}
+
+long planista_kradziezy(void)
+{
+    return __atomic_load_n(&pl_ctx->kradziezy, __ATOMIC_RELAXED);
+}
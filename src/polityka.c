@@ -0,0 +1,143 @@
+#include "polityka.h"
+
+#include "wolne_miejsca.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Szuka w stolikach [od, do_) — części sali jednej szatni albo całej sali.
+typedef int (*ZnajdzStolik)(int osoby, int od, int do_);
+
+struct PolitykaCtx
+{
+    int wczytano;
+    enum PolitykaUsadzania polityka;
+};
+
+static struct PolitykaCtx pol_storage = {0};
+static struct PolitykaCtx *pol = &pol_storage;
+
+static const char *const nazwy[POLITYKA_LICZBA] = {
+    [POLITYKA_PIERWSZY] = "pierwszy",
+    [POLITYKA_NAJLEPSZY] = "najlepszy",
+    [POLITYKA_KLASA] = "klasa",
+    [POLITYKA_BEZ_DZIELENIA] = "bez_dzielenia",
+};
+
+// Stoliki leżą w tablicy posortowane wg pojemności (generator_stolikow),
+// więc klasa to ciągły przedział indeksów; przycinamy go do [od, do_).
+static void przedzial_klasy(int pojemnosc, int od, int do_, int *klasa_od, int *klasa_do)
+{
+    int start = 0;
+    for (int c = 1; c < pojemnosc; c++)
+        start += common_ctx->stoliki_wg_pojemnosci[c - 1];
+    int koniec = start + common_ctx->stoliki_wg_pojemnosci[pojemnosc - 1];
+    *klasa_od = start > od ? start : od;
+    *klasa_do = koniec < do_ ? koniec : do_;
+}
+
+static int znajdz_pierwszy(int osoby, int od, int do_)
+{
+    int najnizszy = -1;
+    for (int wolne = osoby; wolne <= 4; wolne++)
+    {
+        int i = wolne_miejsca_w_przedziale(wolne, od, do_);
+        if (i >= 0 && (najnizszy < 0 || i < najnizszy))
+            najnizszy = i;
+    }
+    return najnizszy;
+}
+
+static int znajdz_najlepszy(int osoby, int od, int do_)
+{
+    for (int wolne = osoby; wolne <= 4; wolne++)
+    {
+        int i = wolne_miejsca_w_przedziale(wolne, od, do_);
+        if (i >= 0)
+            return i;
+    }
+    return -1;
+}
+
+static int znajdz_klasa(int osoby, int od, int do_)
+{
+    for (int c = osoby; c <= 4; c++)
+    {
+        int klasa_od, klasa_do;
+        przedzial_klasy(c, od, do_, &klasa_od, &klasa_do);
+        int najnizszy = -1;
+        for (int wolne = osoby; wolne <= c; wolne++)
+        {
+            int i = wolne_miejsca_w_przedziale(wolne, klasa_od, klasa_do);
+            if (i >= 0 && (najnizszy < 0 || i < najnizszy))
+                najnizszy = i;
+        }
+        if (najnizszy >= 0)
+            return najnizszy;
+    }
+    return -1;
+}
+
+static int znajdz_bez_dzielenia(int osoby, int od, int do_)
+{
+    // Pusty stolik klasy c ma dokładnie c wolnych miejsc.
+    for (int c = osoby; c <= 4; c++)
+    {
+        int klasa_od, klasa_do;
+        przedzial_klasy(c, od, do_, &klasa_od, &klasa_do);
+        int i = wolne_miejsca_w_przedziale(c, klasa_od, klasa_do);
+        if (i >= 0)
+            return i;
+    }
+    return znajdz_najlepszy(osoby, od, do_);
+}
+
+static const ZnajdzStolik polityki[POLITYKA_LICZBA] = {
+    [POLITYKA_PIERWSZY] = znajdz_pierwszy,
+    [POLITYKA_NAJLEPSZY] = znajdz_najlepszy,
+    [POLITYKA_KLASA] = znajdz_klasa,
+    [POLITYKA_BEZ_DZIELENIA] = znajdz_bez_dzielenia,
+};
+
+enum PolitykaUsadzania polityka_biezaca(void)
+{
+    if (pol->wczytano)
+        return pol->polityka;
+    pol->wczytano = 1;
+    pol->polityka = POLITYKA_PIERWSZY;
+
+    const char *s = getenv("RESTAURACJA_POLITYKA");
+    if (!s || !*s)
+        return pol->polityka;
+    for (int p = 0; p < POLITYKA_LICZBA; p++)
+    {
+        if (strcmp(s, nazwy[p]) == 0)
+        {
+            pol->polityka = (enum PolitykaUsadzania)p;
+            return pol->polityka;
+        }
+    }
+    LOGE("Nieznana RESTAURACJA_POLITYKA=%s, używam %s\n", s, nazwy[POLITYKA_PIERWSZY]);
+    return pol->polityka;
+}
+
+const char *polityka_nazwa(enum PolitykaUsadzania p)
+{
+    return (p >= 0 && p < POLITYKA_LICZBA) ? nazwy[p] : "?";
+}
+
+int polityka_znajdz_wg(enum PolitykaUsadzania p, int osoby)
+{
+    if (osoby < 1 || osoby > 4 || p < 0 || p >= POLITYKA_LICZBA)
+        return -1;
+    return polityki[p](osoby, 0, common_ctx->liczba_stolikow);
+}
+
+int polityka_znajdz_stolik(const struct Grupa *g)
+{
+    if (g->osoby < 1 || g->osoby > 4)
+        return -1;
+    int s = szatnia_grupy(g->osoby);
+    return polityki[polityka_biezaca()](g->osoby, common_ctx->granice_szatni[s],
+                                        common_ctx->granice_szatni[s + 1]);
+}
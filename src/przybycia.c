@@ -0,0 +1,176 @@
+#define _GNU_SOURCE
+#include "przybycia.h"
+
+#include "common.h"
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEMPO_DOMYSLNE 10.0
+
+struct PrzybyciaCtx
+{
+    pthread_mutex_t mutex;
+    long long start_ns;
+    long long nastepny_ns;
+    long long czas_pracy_ns;
+    unsigned short los[3]; // stan erand48 dla profilu Poissona
+    struct PrzybyciaStat stat;
+};
+
+static struct PrzybyciaCtx przybycia_storage = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+static struct PrzybyciaCtx *prz = &przybycia_storage;
+
+long long przybycia_teraz_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+const char *przybycia_nazwa_profilu(enum ProfilPrzybyc p)
+{
+    switch (p)
+    {
+    case PRZYBYCIA_STALY:
+        return "staly";
+    case PRZYBYCIA_POISSON:
+        return "poisson";
+    case PRZYBYCIA_SCHODEK:
+        return "schodek";
+    case PRZYBYCIA_RAMPA:
+        return "rampa";
+    default:
+        return "brak";
+    }
+}
+
+static double parsuj_env_tempo(const char *name, double domyslna)
+{
+    const char *s = getenv(name);
+    if (!s || !*s)
+        return domyslna;
+    errno = 0;
+    char *end = NULL;
+    double v = strtod(s, &end);
+    if (errno == 0 && end && *end == '\0' && v > 0.0)
+        return v;
+    LOGE("Nieprawidłowe %s=%s, używam %.1f\n", name, s, domyslna);
+    return domyslna;
+}
+
+void przybycia_inicjuj(int czas_pracy_s)
+{
+    const char *s = getenv("RESTAURACJA_PRZYBYCIA");
+    enum ProfilPrzybyc profil = PRZYBYCIA_BRAK;
+    if (s && *s)
+    {
+        for (int p = PRZYBYCIA_BRAK; p <= PRZYBYCIA_RAMPA; p++)
+        {
+            if (strcmp(s, przybycia_nazwa_profilu((enum ProfilPrzybyc)p)) == 0)
+            {
+                profil = (enum ProfilPrzybyc)p;
+                break;
+            }
+        }
+        if (profil == PRZYBYCIA_BRAK && strcmp(s, "brak") != 0)
+            LOGE("Nieznany RESTAURACJA_PRZYBYCIA=%s, używam \"brak\"\n", s);
+    }
+
+    prz->stat.profil = profil;
+    prz->stat.tempo = parsuj_env_tempo("RESTAURACJA_TEMPO", TEMPO_DOMYSLNE);
+    prz->stat.tempo_max = parsuj_env_tempo("RESTAURACJA_TEMPO_MAX", 2.0 * prz->stat.tempo);
+    prz->czas_pracy_ns = (long long)czas_pracy_s * 1000000000LL;
+
+    unsigned long ziarno = (unsigned long)time(NULL) ^ (unsigned long)getpid();
+    const char *seed_env = getenv("RESTAURACJA_SEED");
+    if (seed_env && *seed_env)
+        ziarno = strtoul(seed_env, NULL, 10);
+    prz->los[0] = 0x330E;
+    prz->los[1] = (unsigned short)ziarno;
+    prz->los[2] = (unsigned short)(ziarno >> 16);
+}
+
+void przybycia_start(void)
+{
+    prz->start_ns = przybycia_teraz_ns();
+    prz->nastepny_ns = prz->start_ns;
+}
+
+// Chwilowe tempo (grupy/s) w chwili `t_ns` od startu harmonogramu.
+static double tempo_w_chwili(long long t_ns)
+{
+    const struct PrzybyciaStat *s = &prz->stat;
+    switch (s->profil)
+    {
+    case PRZYBYCIA_SCHODEK:
+        return (t_ns < prz->czas_pracy_ns / 2) ? s->tempo : s->tempo_max;
+    case PRZYBYCIA_RAMPA:
+    {
+        if (prz->czas_pracy_ns <= 0 || t_ns >= prz->czas_pracy_ns)
+            return s->tempo_max;
+        double x = (double)t_ns / (double)prz->czas_pracy_ns;
+        return s->tempo + (s->tempo_max - s->tempo) * x;
+    }
+    default:
+        return s->tempo;
+    }
+}
+
+long long przybycia_nastepny(void)
+{
+    if (prz->stat.profil == PRZYBYCIA_BRAK)
+        return przybycia_teraz_ns();
+
+    pthread_mutex_lock(&prz->mutex);
+    long long t = prz->nastepny_ns;
+    double tempo = tempo_w_chwili(t - prz->start_ns);
+    double odstep_s = 1.0 / tempo;
+    if (prz->stat.profil == PRZYBYCIA_POISSON)
+        odstep_s = -log(1.0 - erand48(prz->los)) / tempo;
+    prz->nastepny_ns = t + (long long)(odstep_s * 1e9);
+    pthread_mutex_unlock(&prz->mutex);
+    return t;
+}
+
+int przybycia_czekaj_do(long long planowany_ns, volatile sig_atomic_t *stop)
+{
+    for (;;)
+    {
+        if (stop && *stop)
+            return -1;
+        long long teraz = przybycia_teraz_ns();
+        if (teraz >= planowany_ns)
+            return 0;
+        long long cel = planowany_ns;
+        if (cel - teraz > POLL_MS_MED * NSEC_PER_MSEC)
+            cel = teraz + POLL_MS_MED * NSEC_PER_MSEC;
+        struct timespec ts = {.tv_sec = cel / 1000000000LL,
+                              .tv_nsec = cel % 1000000000LL};
+        (void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+}
+
+void przybycia_zapisz_wyslanie(long long planowany_ns)
+{
+    long long teraz = przybycia_teraz_ns();
+    long long spoznienie = teraz - planowany_ns;
+    histogram_dodaj(&prz->stat.opoznienie_generatora,
+                    spoznienie > 0 ? (unsigned long long)spoznienie : 0);
+    __atomic_add_fetch(&prz->stat.wyslane, 1, __ATOMIC_RELAXED);
+    long long zero = 0;
+    (void)__atomic_compare_exchange_n(&prz->stat.pierwszy_ns, &zero, teraz, 0,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    long long ostatni = __atomic_load_n(&prz->stat.ostatni_ns, __ATOMIC_RELAXED);
+    while (teraz > ostatni &&
+           !__atomic_compare_exchange_n(&prz->stat.ostatni_ns, &ostatni, teraz, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+const struct PrzybyciaStat *przybycia_statystyki(void) { return &prz->stat; }
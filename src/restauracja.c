@@ -1,20 +1,35 @@
-#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
 
 #include "restauracja.h" /* includes common.h */
+#include "klient.h"
+#include "kolejka.h"
+#include "planista.h"
+#include "polityka.h"
+#include "przybycia.h"
+#include "rozmieszczenie.h"
+#include "segment.h"
+#include "statystyki.h"
+#include "uruchamianie.h"
+#include "wolne_miejsca.h"
+#include "zbieracz.h"
 
 #include <stdio.h>
 /* Dodatkowe nagłówki systemowe spoza common.h */
 #include <errno.h>
-#include <sched.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
 #include <sys/ipc.h>
-#include <sys/msg.h>
-#include <sys/sem.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
 #include <sys/shm.h>
+#include <sys/timerfd.h>
 #include <sys/wait.h>
 
 #ifndef BIN_DIR
@@ -84,24 +99,49 @@ static int parsuj_env_int_zakres(const char *name, int domyslna, int min, int ma
 
 // ====== ZMIENNE GLOBALNE ======
 
+/* Sposób uruchamiania grup klientów (RESTAURACJA_TRYB_KLIENTOW). */
+enum TrybKlientow
+{
+    TRYB_PROCESY = 0,  // proces `klient` na grupę (domyślnie)
+    TRYB_KORUTYNY = 1, // korutyny na puli wątków w procesie `restauracja`
+    TRYB_PULA = 2,     // stała pula procesów `klient` pobierających grupy z shm
+    TRYB_ZYGOTA = 3,   // proces-zygota robi fork() na grupę (bez exec)
+};
+
 /* Kontekst uruchomienia, aby ograniczyć globalne pola. */
 struct KontekstRestauracji
 {
+    enum TrybKlientow tryb_klientow;
+    int watki_klientow;
+    int watki_spawnu;
+    int pula_procesow;
+    int max_aktywnych_grup;
+    int szczyt_grup_w_lokalu;
+    long ponowienia_spawnu;
+    int zygota_fd;
+    long zygota_zlecone;
+    int budzik_fd; // eventfd: handler sygnału budzi nim pętlę główną
+    long long start_ns;
+    double czas_symulacji_s;
+    long long koniec_symulacji_ns;
+    long long miejsca_ns_symulacji; // całka zajętych miejsc w oknie symulacji
     char arg_shm[32];
-    char arg_sem[32];
-    char arg_msgq[32];
     pid_t pgid_dzieci;
     volatile sig_atomic_t zamkniecie_zadane;
     volatile sig_atomic_t sygnal_zamkniecia;
     volatile sig_atomic_t stop_generatora;
-    volatile sig_atomic_t stop_zbieracza;
 };
 
-static struct KontekstRestauracji kontekst_bufor = {.pgid_dzieci = -1,
+static struct KontekstRestauracji kontekst_bufor = {.tryb_klientow = TRYB_PROCESY,
+                                                    .watki_klientow = 0,
+                                                    .watki_spawnu = 1,
+                                                    .pula_procesow = 0,
+                                                    .zygota_fd = -1,
+                                                    .budzik_fd = -1,
+                                                    .pgid_dzieci = -1,
                                                     .zamkniecie_zadane = 0,
                                                     .sygnal_zamkniecia = 0,
-                                                    .stop_generatora = 0,
-                                                    .stop_zbieracza = 0};
+                                                    .stop_generatora = 0};
 static struct KontekstRestauracji *kontekst = &kontekst_bufor;
 
 // Wszystkie procesy potomne (obsluga/kucharz/kierownik/klienci) wrzucamy do
@@ -110,18 +150,6 @@ static struct KontekstRestauracji *kontekst = &kontekst_bufor;
 
 // ====== HANDLERY SYGNAŁÓW ======
 
-static void zamknij_odziedziczone_fd_przed_exec(void)
-{
-    // Po uruchomieniu proces może dziedziczyć dodatkowe FD
-    // zamykamy wszystko poza stdin/stdout/stderr.
-    long max_fd = sysconf(_SC_OPEN_MAX);
-    if (max_fd <= 0)
-        max_fd = 1024;
-
-    for (int fd = 3; fd < (int)max_fd; fd++)
-        (void)close(fd);
-}
-
 /* Obsługa sygnału jest bezpieczna asynchronicznie: ustawia tylko flagi numeryczne. */
 
 /* Jedna obsługa łącząca SIGINT/SIGQUIT/SIGTERM oraz SIGTSTP/SIGCONT.
@@ -135,6 +163,14 @@ static void obsluz_sygnal_restauracji(int signo)
         kontekst->sygnal_zamkniecia = signo;
         if (kontekst->pgid_dzieci > 0)
             (void)kill(-kontekst->pgid_dzieci, SIGTERM);
+        if (kontekst->budzik_fd >= 0)
+        {
+            /* Sygnał mógł trafić do innego wątku niż główny, więc poll()
+             * pętli głównej budzimy jawnie (write() jest async-signal-safe). */
+            uint64_t jeden = 1;
+            ssize_t w = write(kontekst->budzik_fd, &jeden, sizeof(jeden));
+            (void)w;
+        }
     }
     else if (signo == SIGTSTP)
     {
@@ -155,137 +191,118 @@ static void obsluz_sygnal_restauracji(int signo)
 
 // ====== ZARZĄDZANIE PROCESAMI ======
 
-/* Ujednolicony „zbieracz zombie”: pętla waitpid bez blokowania.
- * Gdy `count_clients` != 0, zwraca liczbę zebranych PID klientów
- * (pomija obsluga/kucharz/kierownik/szatnia). */
-static int zbierz_zombie_nieblokujaco(int *status, int count_clients)
-{
-    int reaped = 0;
-    for (;;)
-    {
-        pid_t p = waitpid(-1, status, WNOHANG); // nieblokująco
-        if (p <= 0)
-            break;
-        if (count_clients)
-        {
-            LOGD("restauracja: zbierz_zombie_nieblokujaco: pid=%d reaped=%d\n",
-                 (int)getpid(), (int)p);
-            if (p != common_ctx->pid_obsluga && p != common_ctx->pid_kucharz &&
-                p != common_ctx->pid_kierownik && p != common_ctx->pid_szatnia)
-                reaped++;
-        }
-        else
-        {
-            LOGD(
-                "restauracja: zbierz_zombie_nieblokujaco: pid=%d reaped=%d status=%d\n",
-                (int)getpid(), (int)p, (status ? *status : -1));
-        }
-    }
-    return reaped;
-}
-
 static pid_t generator_utworz_jedna_grupe(int numer_grupy);
 
+/* Stan generatora współdzielony przez wątki uruchamiające
+ * (RESTAURACJA_WATKI_SPAWNU). Każdy wątek pobiera kolejny numer grupy
+ * atomowo; ostatni kończący wątek zwalnia strukturę. */
 struct GeneratorGrupCtx
 {
     int liczba_utworzonych_grup;
     int numer_grupy;
+    int nastepny;
+    int utworzone;
+    int aktywne_watki;
 };
 
 static void *watek_generatora_grup(void *arg)
 {
     struct GeneratorGrupCtx *gctx = (struct GeneratorGrupCtx *)arg;
+    int ostatni_numer = gctx->numer_grupy + gctx->liczba_utworzonych_grup - 1;
+
+    /* Martwa zygota ma dać EPIPE przy write(), a nie zabić rodzica. */
+    sigset_t sigpipe;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    (void)pthread_sigmask(SIG_BLOCK, &sigpipe, NULL);
 
-    while (gctx->liczba_utworzonych_grup-- && !kontekst->zamkniecie_zadane &&
-           !kontekst->stop_generatora)
+    while (!kontekst->zamkniecie_zadane && !kontekst->stop_generatora)
     {
-        pid_t pid = generator_utworz_jedna_grupe(gctx->numer_grupy++);
-        if (pid > 0)
+        int numer = __atomic_fetch_add(&gctx->nastepny, 1, __ATOMIC_RELAXED);
+        if (numer > ostatni_numer)
+            break;
+        /* Pętla otwarta: czekamy do planowanego momentu, ale spóźnienia nie
+         * przesuwają harmonogramu — grupa „przyszła” w chwili `plan`. */
+        long long plan = przybycia_nastepny();
+        if (przybycia_czekaj_do(plan, &kontekst->stop_generatora) != 0)
+            break;
+        /* Przy pełnym lokalu grupa czeka „pod drzwiami” — ten czas wlicza
+         * się do opóźnienia od planowanego przybycia. */
+        int w_lokalu = grupy_zajmij(kontekst->max_aktywnych_grup,
+                                    &kontekst->stop_generatora);
+        if (w_lokalu < 0)
+            break;
+        int szczyt = __atomic_load_n(&kontekst->szczyt_grup_w_lokalu, __ATOMIC_RELAXED);
+        while (w_lokalu > szczyt &&
+               !__atomic_compare_exchange_n(&kontekst->szczyt_grup_w_lokalu, &szczyt,
+                                            w_lokalu, 1, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+            ;
+        common_ctx->przybycia_ns[numer] = plan;
+        if (generator_utworz_jedna_grupe(numer) < 0)
         {
-            /* brak dodatkowych działań */
+            common_ctx->przybycia_ns[numer] = 0;
+            grupy_zwolnij();
         }
-        if (gctx->liczba_utworzonych_grup == 0)
+        else
+            przybycia_zapisz_wyslanie(plan);
+        if (__atomic_add_fetch(&gctx->utworzone, 1, __ATOMIC_RELAXED) ==
+            gctx->liczba_utworzonych_grup)
         {
             printf("Utworzono wszystkie grupy klientów.\n");
         }
     }
-    free(gctx);
-    return NULL;
-}
-
-static void *watek_zbieracza_zombie(void *arg)
-{
-    (void)arg;
-    int status;
-
-    while (!kontekst->zamkniecie_zadane && !kontekst->stop_zbieracza)
-    {
-        (void)zbierz_zombie_nieblokujaco(&status, 0);
-        (void)usypiaj_ms(POLL_MS_MED);
-    }
-
-    while (waitpid(-1, NULL, WNOHANG) > 0)
-        ;
+    if (__atomic_sub_fetch(&gctx->aktywne_watki, 1, __ATOMIC_ACQ_REL) == 0)
+        free(gctx);
     return NULL;
 }
 
 static pid_t uruchom_potomka_exec(
-    const char *file, const char *argv0, int numer_grupy,
-    int czy_klient) // uruchamia proces potomny przez fork()+exec()
+    const char *file, const char *argv0, int numer_grupy, int czy_klient,
+    pid_t pgid) // uruchamia proces potomny przez silnik uruchamiania
 {
-    pid_t pid = fork();
-    if (pid == 0)
+    char arg_grupa[32];
+    char *argv[] = {(char *)argv0, kontekst->arg_shm, NULL, NULL};
+    if (czy_klient)
     {
-        zamknij_odziedziczone_fd_przed_exec();
-        if (czy_klient)
-        {
-            char arg_grupa[32];
-            snprintf(arg_grupa, sizeof(arg_grupa), "%d", numer_grupy);
-            execl(file, argv0, kontekst->arg_shm, kontekst->arg_sem,
-                  kontekst->arg_msgq, arg_grupa,
-                  (char *)NULL);
-        }
-        else
-        {
-            execl(file, argv0, kontekst->arg_shm, kontekst->arg_sem,
-                  kontekst->arg_msgq,
-                  (char *)NULL);
-        }
-        /* ścieżka awaryjna; brak dodatkowego execl */
-        LOGE_ERRNO("execl");
-        _exit(127);
+        snprintf(arg_grupa, sizeof(arg_grupa), "%d", numer_grupy);
+        argv[2] = arg_grupa;
     }
+
+    pid_t pid = uruchamianie_spawn(file, argv, pgid);
     if (pid < 0)
     {
-        LOGE_ERRNO("fork");
+        int e = errno;
+        /* EAGAIN/ENOMEM obsługuje wołający (ponawianie), bez zalewania logu. */
+        if (e != EAGAIN && e != ENOMEM)
+            LOGE_ERRNO(uruchamianie_nazwa_metody(uruchamianie_statystyki()->metoda));
+        errno = e;
         return -1;
     }
     return pid;
 }
 
 /* Pomocnik: uruchamia potomka przez uruchom_potomka_exec(), opcjonalnie
- * zapisuje PID do shm i dołącza do grupy procesów. */
+ * zapisuje PID do shm i dołącza do grupy procesów (grupę ustawia już
+ * silnik uruchamiania, bez wyścigu z setpgid() po stronie rodzica). */
 static pid_t uruchom_potomka_i_ustaw_grupe(const char *file, const char *argv0,
                                            int numer_grupy, int czy_klient,
                                            pid_t *pid_shm_wyj,
                                            int utworz_grupe_jesli_brak)
 {
-    pid_t pid = uruchom_potomka_exec(file, argv0, numer_grupy, czy_klient);
+    pid_t pgid = kontekst->pgid_dzieci;
+    if (pgid <= 0)
+        pgid = utworz_grupe_jesli_brak ? 0 : -1;
+
+    pid_t pid = uruchom_potomka_exec(file, argv0, numer_grupy, czy_klient, pgid);
     if (pid < 0)
         return -1;
 
     if (pid_shm_wyj)
         *pid_shm_wyj = pid;
 
-    if (utworz_grupe_jesli_brak && kontekst->pgid_dzieci <= 0)
-    {
+    if (pgid == 0)
         kontekst->pgid_dzieci = pid;
-        (void)setpgid(pid, kontekst->pgid_dzieci);
-    }
-    else if (kontekst->pgid_dzieci > 0)
-    {
-        (void)setpgid(pid, kontekst->pgid_dzieci);
-    }
     return pid;
 }
 
@@ -302,7 +319,9 @@ static int czy_grupa_procesow_pusta(
 static void zakoncz_wszystkie_dzieci(
     int *status) // kończy wszystkie procesy potomne w grupie
 {
-    /* Utrzymaj łączny czas oczekiwania poniżej typowego limitu testów (10 s). */
+    /* Utrzymaj łączny czas oczekiwania poniżej typowego limitu testów (10 s).
+     * Między sprawdzeniami śpimy na signalfd zbieracza; limit POLL_MS_MED
+     * dotyczy wnuków (dzieci zygoty), których SIGCHLD do nas nie trafia. */
     const int timeout_term = SHUTDOWN_TERM_TIMEOUT;
     const int timeout_kill = SHUTDOWN_KILL_TIMEOUT;
 
@@ -322,8 +341,7 @@ static void zakoncz_wszystkie_dzieci(
     {
         LOGD("zakoncz_wszystkie_dzieci: pid=%d czekam na dzieci, uplynelo=%ld\n",
              (int)getpid(), (long)sekundy_od(&start));
-        (void)zbierz_zombie_nieblokujaco(status, 0);
-        sched_yield();
+        (void)zbieracz_czekaj(status, POLL_MS_MED);
     }
 
     if (!czy_grupa_procesow_pusta(kontekst->pgid_dzieci))
@@ -342,25 +360,101 @@ static void zakoncz_wszystkie_dzieci(
             LOGD("zakoncz_wszystkie_dzieci: pid=%d czekam po SIGKILL, "
                  "uplynelo=%ld\n",
                  (int)getpid(), (long)sekundy_od(&start));
-            (void)zbierz_zombie_nieblokujaco(status, 0);
-            sched_yield();
+            (void)zbieracz_czekaj(status, POLL_MS_MED);
         }
     }
 
-    while (waitpid(-1, NULL, WNOHANG) > 0)
-    {
-        LOGD("zakoncz_wszystkie_dzieci: pid=%d zbieram pozostale dzieci\n",
-             (int)getpid());
-    }
+    (void)zbieracz_zbierz(status);
     LOGD("zakoncz_wszystkie_dzieci: pid=%d zakonczono\n", (int)getpid());
 }
 
 // ====== GENERATOR KLIENTÓW ======
 
+/* Wczytuje tryb klientów z env: "procesy" (domyślnie), "korutyny" lub "pula". */
+static void wczytaj_tryb_klientow(void)
+{
+    const char *s = getenv("RESTAURACJA_TRYB_KLIENTOW");
+    if (s && strcmp(s, "korutyny") == 0)
+        kontekst->tryb_klientow = TRYB_KORUTYNY;
+    else if (s && strcmp(s, "pula") == 0)
+        kontekst->tryb_klientow = TRYB_PULA;
+    else if (s && strcmp(s, "zygota") == 0)
+        kontekst->tryb_klientow = TRYB_ZYGOTA;
+    else
+    {
+        if (s && *s && strcmp(s, "procesy") != 0)
+            LOGE("Nieznany RESTAURACJA_TRYB_KLIENTOW=%s, używam \"procesy\"\n", s);
+        kontekst->tryb_klientow = TRYB_PROCESY;
+    }
+    kontekst->watki_klientow =
+        parsuj_env_int_zakres("RESTAURACJA_WATKI_KLIENTOW", 0, 1, -1);
+    kontekst->watki_spawnu =
+        parsuj_env_int_zakres("RESTAURACJA_WATKI_SPAWNU", 1, 1, 64);
+    kontekst->pula_procesow =
+        parsuj_env_int_zakres("RESTAURACJA_PULA_KLIENTOW", 64, 1, 1024);
+}
+
+/* Domyślny limit grup w lokalu naraz (RESTAURACJA_MAX_AKTYWNYCH_KLIENTOW):
+ * więcej nie zmieści się ani przy stolikach, ani w kolejce wejściowej.
+ * Zależy od wymiarów sali, więc czytamy go po stworz_ipc(). */
+static void wczytaj_limit_grup(void)
+{
+    int miejsca = common_ctx->liczba_stolikow * common_ctx->grup_na_stoliku;
+    kontekst->max_aktywnych_grup = parsuj_env_int_zakres(
+        "RESTAURACJA_MAX_AKTYWNYCH_KLIENTOW", MAX_KOLEJKA + miejsca, 0, -1);
+}
+
+static void zadanie_klienta(void *arg)
+{
+    klient_obsluz_grupe((int)(intptr_t)arg);
+    grupy_zwolnij();
+}
+
 static pid_t
 generator_utworz_jedna_grupe(int numer_grupy) // tworzy jedną grupę klientów
 {
-    pid_t pid = uruchom_potomka_exec(BIN_DIR "/klient", "klient", numer_grupy, 1);
+    if (kontekst->tryb_klientow == TRYB_KORUTYNY)
+    {
+        if (planista_dodaj(zadanie_klienta, (void *)(intptr_t)numer_grupy) == 0)
+            return 0;
+        LOGE("Nie udało się utworzyć zadania dla grupy %d\n", numer_grupy);
+        return -1;
+    }
+    if (kontekst->tryb_klientow == TRYB_PULA)
+        return pula_opublikuj(numer_grupy, &kontekst->stop_generatora);
+    if (kontekst->tryb_klientow == TRYB_ZYGOTA)
+    {
+        /* Zapis <= PIPE_BUF jest atomowy, więc wątki generatora nie
+         * potrzebują wspólnej blokady. */
+        ssize_t w;
+        do
+            w = write(kontekst->zygota_fd, &numer_grupy, sizeof(numer_grupy));
+        while (w < 0 && errno == EINTR);
+        if (w != (ssize_t)sizeof(numer_grupy))
+        {
+            LOGE_ERRNO("write(zygota)");
+            return -1;
+        }
+        __atomic_add_fetch(&kontekst->zygota_zlecone, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    /* Brak procesów/pamięci (EAGAIN/ENOMEM) to chwilowy stan przy dużych
+     * przebiegach: czekamy z wykładniczo rosnącą przerwą zamiast zamykać
+     * restaurację. */
+    unsigned przerwa_ms = 1;
+    pid_t pid;
+    while ((pid = uruchom_potomka_exec(BIN_DIR "/klient", "klient", numer_grupy, 1,
+                                       kontekst->pgid_dzieci > 0 ? kontekst->pgid_dzieci : -1)) < 0 &&
+           (errno == EAGAIN || errno == ENOMEM) && !kontekst->stop_generatora)
+    {
+        __atomic_add_fetch(&kontekst->ponowienia_spawnu, 1, __ATOMIC_RELAXED);
+        (void)usypiaj_ms(przerwa_ms);
+        if (przerwa_ms < 1000)
+            przerwa_ms *= 2;
+    }
+    if (pid < 0 && kontekst->stop_generatora)
+        return -1;
     if (pid < 0)
     {
         if (common_ctx->restauracja_otwarta)
@@ -371,11 +465,59 @@ generator_utworz_jedna_grupe(int numer_grupy) // tworzy jedną grupę klientów
         }
         return -1;
     }
-    if (kontekst->pgid_dzieci > 0)
-        (void)setpgid(pid, kontekst->pgid_dzieci);
+    zbieracz_zarejestruj_grupe(pid);
+    rozmieszczenie_przypnij_klienta(pid, numer_grupy);
     return pid;
 }
 
+/* Uruchamia stałą pulę procesów `klient` (TRYB_PULA). Zwraca liczbę
+ * uruchomionych pracowników. */
+static int uruchom_pule_klientow(void)
+{
+    int uruchomione = 0;
+    for (int i = 0; i < kontekst->pula_procesow; i++)
+    {
+        pid_t pid = uruchom_potomka_exec(BIN_DIR "/klient", "klient",
+                                         KLIENT_TRYB_PULA, 1,
+                                         kontekst->pgid_dzieci > 0 ? kontekst->pgid_dzieci : -1);
+        if (pid < 0)
+            break;
+        zbieracz_zarejestruj(pid, ROLA_KLIENT);
+        rozmieszczenie_przypnij_klienta(pid, i);
+        uruchomione++;
+    }
+    return uruchomione;
+}
+
+/* Uruchamia zygotę (TRYB_ZYGOTA) z końcem potoku do odczytu jako stdin.
+ * Zwraca 0 przy sukcesie, -1 przy błędzie. */
+static int uruchom_zygote(void)
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0)
+    {
+        LOGE_ERRNO("pipe2(zygota)");
+        return -1;
+    }
+
+    char arg_grupa[32];
+    snprintf(arg_grupa, sizeof(arg_grupa), "%d", KLIENT_TRYB_ZYGOTA);
+    char *argv[] = {"klient", kontekst->arg_shm, arg_grupa, NULL};
+    pid_t pid = uruchamianie_spawn_stdin(BIN_DIR "/klient", argv,
+                                         kontekst->pgid_dzieci > 0 ? kontekst->pgid_dzieci : -1,
+                                         fds[0]);
+    (void)close(fds[0]);
+    if (pid < 0)
+    {
+        LOGE_ERRNO("uruchamianie_spawn_stdin(zygota)");
+        (void)close(fds[1]);
+        return -1;
+    }
+    zbieracz_zarejestruj(pid, ROLA_KLIENT);
+    kontekst->zygota_fd = fds[1];
+    return 0;
+}
+
 // ====== AWARYJNE ZAMKNIĘCIE ======
 
 static void zakoncz_klientow_i_wyczysc_stoliki_i_kolejke(void);
@@ -403,10 +545,6 @@ static int awaryjne_zamkniecie_fork(void) // sprzątanie przy błędzie fork()
 
     if (common_ctx->shm_id >= 0)
         shmctl(common_ctx->shm_id, IPC_RMID, NULL); // usuń pamięć współdzieloną
-    if (common_ctx->sem_id >= 0)
-        semctl(common_ctx->sem_id, 0, IPC_RMID); // usuń semafory
-    if (common_ctx->msgq_id >= 0)
-        msgctl(common_ctx->msgq_id, IPC_RMID, NULL); // usuń kolejkę komunikatów
 
     fprintf(stderr,
             "Awaryjne zamknięcie: nie udało się utworzyć procesu (fork).\n");
@@ -415,28 +553,23 @@ static int awaryjne_zamkniecie_fork(void) // sprzątanie przy błędzie fork()
 
 static void generator_stolikow(struct Stolik *stoliki_local)
 {
+    // Segment jest świeżo wyzerowany, więc grupy przy stolikach są puste.
     int idx = 0;
     for (int i = 0; i < 4; i++)
     {
-        for (int j = 0; j < ILOSC_STOLIKOW[i]; j++)
+        for (int j = 0; j < common_ctx->stoliki_wg_pojemnosci[i]; j++, idx++)
         {
-            int suma_poprzednich = 0;
-            for (int k = 0; k < i; k++)
-                suma_poprzednich += ILOSC_STOLIKOW[k];
-
-            idx = suma_poprzednich + j;
             stoliki_local[idx].numer_stolika = idx + 1;
             stoliki_local[idx].pojemnosc = i + 1;
             stoliki_local[idx].liczba_grup = 0;
             stoliki_local[idx].zajete_miejsca = 0;
-            memset(stoliki_local[idx].grupy, 0,
-                   sizeof(stoliki_local[idx].grupy));
 
             LOGP("Stolik %d o pojemności %d utworzony.\n",
                  stoliki_local[idx].numer_stolika,
                  stoliki_local[idx].pojemnosc);
         }
     }
+    wolne_miejsca_odbuduj();
 }
 
 static void zakoncz_klientow_i_wyczysc_stoliki_i_kolejke(
@@ -447,80 +580,67 @@ static void zakoncz_klientow_i_wyczysc_stoliki_i_kolejke(
 
     // Klienci usadzeni przy stolikach.
     int stoliki_locked = 0;
+    int zablokowane = 0;
     struct timespec lock_deadline;
     if (clock_gettime(CLOCK_REALTIME, &lock_deadline) == 0)
     {
         lock_deadline.tv_sec += 1;
-        if (common_ctx->stoliki_sync &&
-            pthread_mutex_timedlock(&common_ctx->stoliki_sync->mutex,
-                                    &lock_deadline) == 0)
-            stoliki_locked = 1;
+        while (common_ctx->stoliki_sync && zablokowane < common_ctx->liczba_szatni &&
+               pthread_mutex_timedlock(stoliki_mutex(zablokowane), &lock_deadline) == 0)
+            zablokowane++;
+        stoliki_locked = (zablokowane == common_ctx->liczba_szatni);
     }
-    if (!stoliki_locked)
-
-        for (int i = 0; i < MAX_STOLIKI; i++)
+    // Stan stolików i indeks wolnych miejsc zmieniamy tylko pod wszystkimi
+    // mutexami; bez nich zostawiamy je szatniom i klientom (procesy i tak
+    // zakończy zakoncz_wszystkie_dzieci()).
+    if (stoliki_locked)
+    {
+        for (int i = 0; i < common_ctx->liczba_stolikow; i++)
         {
+            struct Grupa *grupy = stolik_grupy(i);
             for (int j = 0; j < common_ctx->stoliki[i].liczba_grup; j++)
             {
-                pid_t pid = common_ctx->stoliki[i].grupy[j].proces_id;
+                pid_t pid = grupy[j].proces_id;
                 if (pid > 0)
                 {
                     (void)kill(pid, SIGTERM);
                 }
             }
 
-            memset(common_ctx->stoliki[i].grupy, 0,
-                   sizeof(common_ctx->stoliki[i].grupy));
+            memset(grupy, 0, sizeof(*grupy) * (size_t)common_ctx->grup_na_stoliku);
+            stoliki_rozlicz_miejsca(szatnia_stolika(i), -common_ctx->stoliki[i].zajete_miejsca);
             common_ctx->stoliki[i].liczba_grup = 0;
             common_ctx->stoliki[i].zajete_miejsca = 0;
         }
-    if (stoliki_locked)
-        pthread_mutex_unlock(&common_ctx->stoliki_sync->mutex);
+        wolne_miejsca_odbuduj();
+    }
+    else if (common_ctx->stoliki_sync)
+        LOGE("zakoncz_klientow: brak mutexów stolików po 1 s, nie czyszczę stolików\n");
+    while (zablokowane > 0)
+        pthread_mutex_unlock(stoliki_mutex(--zablokowane));
 
-    // Klienci w kolejce wejściowej.
+    // Klienci w kolejkach wejściowych szatni.
     LOGD("zakoncz_klientow_i_wyczysc_stoliki_i_kolejke: pid=%d cleaning queue\n",
          (int)getpid());
-    QueueMsg msg;
-    for (;;)
+    struct Grupa g;
+    for (int s = 0; s < common_ctx->liczba_szatni; s++)
     {
-        ssize_t r = msgrcv(common_ctx->msgq_id, &msg, sizeof(msg.grupa), 1,
-                           IPC_NOWAIT);
-        if (r < 0)
-        {
-            if (errno == ENOMSG)
-                break;
-            if (errno == EINTR)
-                continue;
-            if (errno == EIDRM || errno == EINVAL)
-                return;
-            break;
-        }
-
-        pid_t pid = msg.grupa.proces_id;
-        LOGD("zakoncz_klientow: pid=%d popped queued client pid=%d\n",
-             (int)getpid(), (int)pid);
-        if (pid > 0)
-        {
-            LOGD("zakoncz_klientow: pid=%d killing queued client pid=%d\n",
-                 (int)getpid(), (int)pid);
-            (void)kill(pid, SIGTERM);
-        }
-
-        // Zdjęliśmy komunikat z kolejki, więc zwalniamy slot w liczniku queue_sync.
-        if (pthread_mutex_trylock(&common_ctx->queue_sync->mutex) == 0)
+        for (int k = 0; k < KLASY_KOLEJKI; k++)
         {
-            if (common_ctx->queue_sync->count > 0)
-                common_ctx->queue_sync->count--;
-            /* Zmniejsz liczbę klientów w kolejce o rozmiar tej grupy. */
-            if (common_ctx->klienci_w_kolejce && msg.grupa.osoby > 0)
+            while (kolejka_sprobuj_pobierz(s, k, &g) == 0)
             {
-                if (*common_ctx->klienci_w_kolejce >= msg.grupa.osoby)
-                    *common_ctx->klienci_w_kolejce -= msg.grupa.osoby;
-                else
-                    *common_ctx->klienci_w_kolejce = 0;
+                pid_t pid = g.proces_id;
+                LOGD("zakoncz_klientow: pid=%d popped queued client pid=%d\n",
+                     (int)getpid(), (int)pid);
+                if (pid > 0)
+                {
+                    LOGD("zakoncz_klientow: pid=%d killing queued client pid=%d\n",
+                         (int)getpid(), (int)pid);
+                    (void)kill(pid, SIGTERM);
+                }
+                kolejka_zwolnij_miejsce(s, k);
+                statystyki_dodaj(STAT_KLIENCI_W_KOLEJCE, -g.osoby);
             }
-            pthread_cond_signal(&common_ctx->queue_sync->not_full);
-            pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
         }
     }
     LOGD("zakoncz_klientow_i_wyczysc_stoliki_i_kolejke: pid=%d done\n",
@@ -595,22 +715,30 @@ int inicjuj_restauracje(int argc, char **argv, int *out_czas_pracy)
     snprintf(log_level_str, sizeof(log_level_str), "%d", log_level);
     setenv("LOG_LEVEL", log_level_str, 1);
 
+    kontekst->start_ns = przybycia_teraz_ns();
     zainicjuj_losowosc();
+    wczytaj_tryb_klientow();
+    przybycia_inicjuj(czas);
+    uruchamianie_inicjuj();
+    rozmieszczenie_inicjuj();
+    /* Przed startem wątków i potomków: SIGCHLD ma trafiać tylko do signalfd. */
+    if (zbieracz_inicjuj() != 0)
+        LOGE("Nie udało się przygotować signalfd dla SIGCHLD\n");
 
     stworz_ipc();
+    wczytaj_limit_grup();
     generator_stolikow(common_ctx->stoliki);
     fflush(stdout);
-    snprintf(kontekst->arg_shm, sizeof(kontekst->arg_shm), "%d",
-             common_ctx->shm_id);
-    snprintf(kontekst->arg_sem, sizeof(kontekst->arg_sem), "%d",
-             common_ctx->sem_id);
-    snprintf(kontekst->arg_msgq, sizeof(kontekst->arg_msgq), "%d",
-             common_ctx->msgq_id);
+    segment_argument(kontekst->arg_shm, sizeof(kontekst->arg_shm));
+    uruchamianie_przekaz_fd(segment_fd());
 
     *common_ctx->restauracja_otwarta = 1;
     sygnalizuj_ture_na(1);
 
     /* Zarejestruj obsługę sygnałów przed startem potomków. */
+    kontekst->budzik_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (kontekst->budzik_fd < 0)
+        LOGE_ERRNO("eventfd(budzik)");
     signal(SIGINT, obsluz_sygnal_restauracji);
     signal(SIGQUIT, obsluz_sygnal_restauracji);
     signal(SIGTERM, obsluz_sygnal_restauracji);
@@ -623,21 +751,43 @@ int inicjuj_restauracje(int argc, char **argv, int *out_czas_pracy)
     common_ctx->pid_obsluga = p;
     if (common_ctx->pid_obsluga < 0)
         return awaryjne_zamkniecie_fork();
-    p = uruchom_potomka_i_ustaw_grupe(BIN_DIR "/szatnia", "szatnia", 0, 0,
-                                      NULL, 0);
-    common_ctx->pid_szatnia = p;
-    if (common_ctx->pid_szatnia < 0)
-        return awaryjne_zamkniecie_fork();
+    zbieracz_zarejestruj(p, ROLA_OBSLUGA);
+    rozmieszczenie_przypnij_role(p, ROLA_OBSLUGA);
+    /* Szatnia s dostaje swój numer jako drugi argument (część sali i
+     * kolejka); wszystkie mają rolę i rdzeń szatni. */
+    for (int s = 0; s < common_ctx->liczba_szatni; s++)
+    {
+        p = uruchom_potomka_i_ustaw_grupe(BIN_DIR "/szatnia", "szatnia", s, 1,
+                                          NULL, 0);
+        common_ctx->pid_szatni[s] = p;
+        if (common_ctx->pid_szatni[s] < 0)
+            return awaryjne_zamkniecie_fork();
+        zbieracz_zarejestruj(p, ROLA_SZATNIA);
+        rozmieszczenie_przypnij_role(p, ROLA_SZATNIA);
+    }
     p = uruchom_potomka_i_ustaw_grupe(BIN_DIR "/kucharz", "kucharz", 0, 0,
                                       NULL, 0);
     common_ctx->pid_kucharz = p;
     if (common_ctx->pid_kucharz < 0)
         return awaryjne_zamkniecie_fork();
+    zbieracz_zarejestruj(p, ROLA_KUCHARZ);
+    rozmieszczenie_przypnij_role(p, ROLA_KUCHARZ);
     p = uruchom_potomka_i_ustaw_grupe(BIN_DIR "/kierownik", "kierownik", 0,
                                       0, common_ctx->pid_kierownik_shm, 0);
     common_ctx->pid_kierownik = p;
     if (common_ctx->pid_kierownik < 0)
         return awaryjne_zamkniecie_fork();
+    zbieracz_zarejestruj(p, ROLA_KIEROWNIK);
+    rozmieszczenie_przypnij_role(p, ROLA_KIEROWNIK);
+    /* Od teraz rodzic (generator, korutyny) i wszystko, co uruchomi, ma
+     * maskę rdzeni klientów. */
+    rozmieszczenie_przypnij_rodzica();
+
+    if (kontekst->tryb_klientow == TRYB_ZYGOTA && uruchom_zygote() != 0)
+    {
+        LOGE("Nie udało się uruchomić zygoty, przełączam na tryb procesów\n");
+        kontekst->tryb_klientow = TRYB_PROCESY;
+    }
 
     if (out_czas_pracy)
         *out_czas_pracy = czas_pracy_domyslny;
@@ -647,35 +797,220 @@ int inicjuj_restauracje(int argc, char **argv, int *out_czas_pracy)
 /* Scentralizowana sekwencja zamknięcia/sprzątania. */
 int zamknij_restauracje(int *status)
 {
+    int niezakonczone_zadania = 0;
+    if (kontekst->tryb_klientow == TRYB_KORUTYNY)
+        niezakonczone_zadania = planista_zatrzymaj(SHUTDOWN_TERM_TIMEOUT);
     zakoncz_klientow_i_wyczysc_stoliki_i_kolejke();
     zakoncz_wszystkie_dzieci(status);
     if (common_ctx->shm_id >= 0)
         shmctl(common_ctx->shm_id, IPC_RMID, NULL);
-    if (common_ctx->sem_id >= 0)
-        semctl(common_ctx->sem_id, 0, IPC_RMID);
-    if (common_ctx->msgq_id >= 0)
-        msgctl(common_ctx->msgq_id, IPC_RMID, NULL);
+    if (kontekst->zygota_fd >= 0)
+    {
+        (void)close(kontekst->zygota_fd);
+        kontekst->zygota_fd = -1;
+    }
+    if (kontekst->budzik_fd >= 0)
+    {
+        (void)close(kontekst->budzik_fd);
+        kontekst->budzik_fd = -1;
+    }
+    long long sciana_ns = przybycia_teraz_ns() - kontekst->start_ns;
 
-    char buf[2048];
+    char buf[4096];
     size_t offset = 0;
     dopisz_do_bufora(buf, sizeof(buf), &offset, "\n\n\n========== STATYSTYKI KLIENTÓW =================\n");
-    int przyjeci = 0;
-    int opuscili = 0;
-    int kolejka = 0;
-    if (common_ctx->statystyki_sync &&
-        pthread_mutex_lock(&common_ctx->statystyki_sync->mutex) == 0)
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Klienci przyjęci: %lld\n",
+                     statystyki_suma(STAT_KLIENCI_PRZYJECI));
+    dopisz_do_bufora(buf, sizeof(buf), &offset,
+                     "Klienci którzy opuścili restaurację: %lld\n",
+                     statystyki_suma(STAT_KLIENCI_OPUSCILI));
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Klienci w kolejce: %lld\n",
+                     statystyki_suma(STAT_KLIENCI_W_KOLEJCE));
+    if (kontekst->tryb_klientow == TRYB_KORUTYNY)
+        dopisz_do_bufora(buf, sizeof(buf), &offset,
+                         "Tryb klientów: korutyny (wątki: %d, zadania: %ld, "
+                         "szczyt aktywnych: %ld, kradzieże: %ld, "
+                         "niezakończone: %d)\n",
+                         planista_liczba_watkow(), planista_zadania_utworzone(),
+                         planista_zadania_szczyt(), planista_kradziezy(),
+                         niezakonczone_zadania);
+    else if (kontekst->tryb_klientow == TRYB_PULA)
+        dopisz_do_bufora(buf, sizeof(buf), &offset,
+                         "Tryb klientów: pula (procesy robocze: %d)\n",
+                         kontekst->pula_procesow);
+    else if (kontekst->tryb_klientow == TRYB_ZYGOTA)
+        dopisz_do_bufora(buf, sizeof(buf), &offset,
+                         "Tryb klientów: zygota (grupy zlecone: %ld)\n",
+                         kontekst->zygota_zlecone);
+    else
+        dopisz_do_bufora(buf, sizeof(buf), &offset, "Tryb klientów: procesy\n");
+    char opis_rozmieszczenia[256];
+    rozmieszczenie_opisz(opis_rozmieszczenia, sizeof(opis_rozmieszczenia));
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Rozmieszczenie: %s\n",
+                     opis_rozmieszczenia);
+    char opis_segmentu[160];
+    segment_opisz(opis_segmentu, sizeof(opis_segmentu));
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Segment: %s\n", opis_segmentu);
+    const int *sp = common_ctx->stoliki_wg_pojemnosci;
+    dopisz_do_bufora(buf, sizeof(buf), &offset,
+                     "Sala: %d stolików (1/2/3/4-os.: %d/%d/%d/%d), taśma %d, "
+                     "grup na stolik %d\n",
+                     common_ctx->liczba_stolikow, sp[0], sp[1], sp[2], sp[3],
+                     common_ctx->dlugosc_tasmy, common_ctx->grup_na_stoliku);
+
+    long long obsluzone = statystyki_suma(STAT_GRUPY_OBSLUZONE);
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Grupy obsłużone: %lld (%.1f grup/s)",
+                     obsluzone,
+                     kontekst->czas_symulacji_s > 0
+                         ? (double)obsluzone / kontekst->czas_symulacji_s
+                         : 0.0);
+    const struct ZbieraczStat *zs = zbieracz_statystyki();
+    /* Dzieci zygoty nie są dziećmi rodzica, więc ich nie liczymy. */
+    if (kontekst->tryb_klientow != TRYB_ZYGOTA)
+        dopisz_do_bufora(buf, sizeof(buf), &offset, ", szczyt procesów klient: %d",
+                         zs->klienci_szczyt);
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "\n");
+
+    int miejsca = 0;
+    for (int c = 1; c <= 4; c++)
+        miejsca += c * common_ctx->stoliki_wg_pojemnosci[c - 1];
+    double okno_ns = kontekst->czas_symulacji_s * 1e9;
+    double srednio_zajete = okno_ns > 0 ? (double)kontekst->miejsca_ns_symulacji / okno_ns : 0.0;
+    long long usadzone = statystyki_suma(STAT_GRUPY_USADZONE);
+    dopisz_do_bufora(buf, sizeof(buf), &offset,
+                     "Polityka usadzania: %s, obłożenie miejsc: %.1f%% (średnio %.1f z %d), "
+                     "usadzone grupy: %lld (%.1f grup/s)\n",
+                     polityka_nazwa(polityka_biezaca()),
+                     miejsca > 0 ? 100.0 * srednio_zajete / miejsca : 0.0, srednio_zajete,
+                     miejsca, usadzone,
+                     kontekst->czas_symulacji_s > 0
+                         ? (double)usadzone / kontekst->czas_symulacji_s
+                         : 0.0);
+    long long partie = statystyki_suma(STAT_SZATNIA_PARTIE);
+    dopisz_do_bufora(buf, sizeof(buf), &offset,
+                     "Szatnia: partia do %d grup, sekcje krytyczne z usadzeniem: %lld "
+                     "(średnio %.2f grupy na sekcję)\n",
+                     szatnia_partia_z_env(), partie,
+                     partie > 0 ? (double)usadzone / (double)partie : 0.0);
+    for (int s = 0; s < common_ctx->liczba_szatni; s++)
+    {
+        long long przez_szatnie = statystyki_suma(STAT_SZATNIA_USADZONE + s);
+        int od = common_ctx->granice_szatni[s], do_ = common_ctx->granice_szatni[s + 1];
+        if (od < do_)
+            dopisz_do_bufora(buf, sizeof(buf), &offset, "  szatnia %d (stoliki %d-%d)", s,
+                             od + 1, do_);
+        else
+            dopisz_do_bufora(buf, sizeof(buf), &offset, "  szatnia %d (bez stolików)", s);
+        dopisz_do_bufora(buf, sizeof(buf), &offset, ": usadzone grupy %lld (%.1f grup/s)\n",
+                         przez_szatnie,
+                         kontekst->czas_symulacji_s > 0
+                             ? (double)przez_szatnie / kontekst->czas_symulacji_s
+                             : 0.0);
+    }
+    dopisz_do_bufora(buf, sizeof(buf), &offset,
+                     "Pas VIP: waga %d, starzenie %d ms, zwykłe grupy usadzone pasem VIP "
+                     "po starzeniu: %lld\n",
+                     szatnia_waga_vip_z_env(), szatnia_starzenie_ms_z_env(),
+                     statystyki_suma(STAT_SZATNIA_POSTARZONE));
+    dopisz_do_bufora(buf, sizeof(buf), &offset,
+                     "Grupy w lokalu: szczyt %d, limit %d, ponowienia spawnu (EAGAIN): %ld\n",
+                     kontekst->szczyt_grup_w_lokalu, kontekst->max_aktywnych_grup,
+                     kontekst->ponowienia_spawnu);
+
+    /* Grupy wysłane, ale nieusadzone do zamknięcia, wchodzą do histogramu z
+     * czasem do końca symulacji (dolna granica), zamiast z niego wypaść. */
+    int nieusadzone = 0;
+    for (int i = 1; i <= liczba_klientow; i++)
     {
-        przyjeci = *common_ctx->klienci_przyjeci;
-        opuscili = *common_ctx->klienci_opuscili;
-        pthread_mutex_unlock(&common_ctx->statystyki_sync->mutex);
+        long long plan = common_ctx->przybycia_ns[i];
+        if (plan <= 0)
+            continue;
+        nieusadzone++;
+        histogram_dodaj(common_ctx->opoznienie_usadzenia,
+                        kontekst->koniec_symulacji_ns > plan
+                            ? (unsigned long long)(kontekst->koniec_symulacji_ns - plan)
+                            : 0);
     }
-    if (common_ctx->klienci_w_kolejce)
-        kolejka = *common_ctx->klienci_w_kolejce;
+    const struct PrzybyciaStat *ps = przybycia_statystyki();
+    char opis_prz[256];
+    double okno_prz = (double)(ps->ostatni_ns - ps->pierwszy_ns) / 1e9;
+    histogram_opisz(&ps->opoznienie_generatora, opis_prz, sizeof(opis_prz));
+    if (ps->profil == PRZYBYCIA_BRAK)
+        dopisz_do_bufora(buf, sizeof(buf), &offset, "Przybycia: brak harmonogramu");
+    else
+        dopisz_do_bufora(buf, sizeof(buf), &offset,
+                         "Przybycia: %s, tempo %.1f..%.1f grup/s",
+                         przybycia_nazwa_profilu(ps->profil), ps->tempo, ps->tempo_max);
+    dopisz_do_bufora(buf, sizeof(buf), &offset, ", wysłane: %ld (%.1f grup/s)\n",
+                     ps->wyslane, okno_prz > 0 ? (double)ps->wyslane / okno_prz : 0.0);
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Spóźnienie generatora: %s\n", opis_prz);
+    histogram_opisz(common_ctx->opoznienie_usadzenia, opis_prz, sizeof(opis_prz));
+    dopisz_do_bufora(buf, sizeof(buf), &offset,
+                     "Od przybycia do usadzenia: %s (nieusadzone: %d)\n", opis_prz,
+                     nieusadzone);
+    /* Tylko usadzone grupy: liczba osób nieusadzonej grupy zna jej klient. */
+    for (int o = 1; o <= 4; o++)
+    {
+        histogram_opisz(&common_ctx->usadzenie_wg_osob[o - 1], opis_prz, sizeof(opis_prz));
+        dopisz_do_bufora(buf, sizeof(buf), &offset, "  grupy %d-os.: %s\n", o, opis_prz);
+    }
+    for (int k = 0; k < KLASY_KOLEJKI; k++)
+    {
+        histogram_opisz(&common_ctx->usadzenie_wg_klasy[k], opis_prz, sizeof(opis_prz));
+        dopisz_do_bufora(buf, sizeof(buf), &offset, "  %s: %s\n",
+                         k == KLASA_VIP ? "VIP" : "zwykłe", opis_prz);
+    }
+    histogram_opisz(common_ctx->oczekiwanie_na_danie, opis_prz, sizeof(opis_prz));
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Oczekiwanie na danie: %s\n", opis_prz);
 
-    dopisz_do_bufora(buf, sizeof(buf), &offset, "Klienci przyjęci: %d\n", przyjeci);
+    const struct UruchamianieStat *us = uruchamianie_statystyki();
+    double okno_s = (double)(us->ostatni_ns - us->pierwszy_ns) / 1e9;
+    char opis[256];
+    histogram_opisz(&us->opoznienie, opis, sizeof(opis));
     dopisz_do_bufora(buf, sizeof(buf), &offset,
-                     "Klienci którzy opuścili restaurację: %d\n", opuscili);
-    dopisz_do_bufora(buf, sizeof(buf), &offset, "Klienci w kolejce: %d\n", kolejka);
+                     "Uruchamianie procesów (%s, wątki: %d): %ld, błędy: %ld, "
+                     "tempo: %.1f/s\n",
+                     uruchamianie_nazwa_metody(us->metoda), kontekst->watki_spawnu,
+                     us->uruchomione, us->bledy,
+                     okno_s > 0 ? (double)us->uruchomione / okno_s : 0.0);
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Opóźnienie uruchomienia: %s\n", opis);
+
+    dopisz_do_bufora(buf, sizeof(buf), &offset,
+                     "Zebrane procesy: %ld (exit 0: %ld, exit != 0: %ld, "
+                     "sygnał: %ld, niezarejestrowane: %ld)\n",
+                     zs->zebrane, zs->wyjscie_zero, zs->wyjscie_blad,
+                     zs->zabite_sygnalem, zs->niezarejestrowane);
+    histogram_opisz(&zs->czas_zycia_klienta, opis, sizeof(opis));
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Czas życia klienta: %s\n", opis);
+    histogram_opisz(&zs->opoznienie, opis, sizeof(opis));
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "Opóźnienie zbierania: %s\n", opis);
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "CPU wg roli (user/sys s):");
+    for (int r = 0; r < ROLA_LICZBA; r++)
+        dopisz_do_bufora(buf, sizeof(buf), &offset, " %s(%ld) %.2f/%.2f",
+                         zbieracz_nazwa_roli((enum RolaProcesu)r), zs->procesy[r],
+                         (double)zs->cpu_user_ns[r] / 1e9,
+                         (double)zs->cpu_sys_ns[r] / 1e9);
+    dopisz_do_bufora(buf, sizeof(buf), &offset, "\n");
+    /* Zużycie CPU względem czasu zegarowego całego przebiegu: bezczynna
+     * restauracja (brak klientów) powinna mieć tu wszędzie ~0%. */
+    struct rusage ru_rodzic;
+    if (sciana_ns > 0 && getrusage(RUSAGE_SELF, &ru_rodzic) == 0)
+    {
+        double sciana = (double)sciana_ns;
+        double rodzic_ns = (double)ru_rodzic.ru_utime.tv_sec * 1e9 +
+                           (double)ru_rodzic.ru_utime.tv_usec * 1e3 +
+                           (double)ru_rodzic.ru_stime.tv_sec * 1e9 +
+                           (double)ru_rodzic.ru_stime.tv_usec * 1e3;
+        dopisz_do_bufora(buf, sizeof(buf), &offset,
+                         "Zajętość CPU wg roli (%% rdzenia przez %.1f s): restauracja %.1f%%",
+                         sciana / 1e9, 100.0 * rodzic_ns / sciana);
+        for (int r = 0; r < ROLA_LICZBA; r++)
+            dopisz_do_bufora(buf, sizeof(buf), &offset, ", %s %.1f%%",
+                             zbieracz_nazwa_roli((enum RolaProcesu)r),
+                             100.0 * (double)(zs->cpu_user_ns[r] + zs->cpu_sys_ns[r]) /
+                                 sciana);
+        dopisz_do_bufora(buf, sizeof(buf), &offset, "\n");
+    }
     dopisz_do_bufora(buf, sizeof(buf), &offset, "================================================\n");
     dopisz_do_bufora(buf, sizeof(buf), &offset, "Program zakończony.\n");
 
@@ -683,6 +1018,49 @@ int zamknij_restauracje(int *status)
     return 0;
 }
 
+/* Śpi do końca czasu pracy albo do sygnału zamknięcia. Takt kierownika
+ * odmierza timerfd, a handler sygnału budzi poll() przez `budzik_fd`, więc
+ * bezczynny rodzic nie zużywa CPU. */
+static void czekaj_do_konca_pracy(const struct timespec *sim_start, int czas_pracy,
+                                  int kierownik_interval)
+{
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (tfd < 0)
+        LOGE_ERRNO("timerfd_create");
+    else if (kierownik_interval > 0)
+    {
+        struct itimerspec takt = {.it_interval = {.tv_sec = kierownik_interval},
+                                  .it_value = {.tv_sec = kierownik_interval}};
+        if (timerfd_settime(tfd, 0, &takt, NULL) != 0)
+            LOGE_ERRNO("timerfd_settime");
+    }
+
+    long long koniec_ns = (long long)sim_start->tv_sec * 1000000000LL +
+                          sim_start->tv_nsec + (long long)czas_pracy * 1000000000LL;
+    struct pollfd pfd[2] = {{.fd = tfd, .events = POLLIN},
+                            {.fd = kontekst->budzik_fd, .events = POLLIN}};
+    while (!kontekst->zamkniecie_zadane)
+    {
+        long long teraz = przybycia_teraz_ns();
+        if (teraz >= koniec_ns)
+            break;
+        int timeout_ms = (int)((koniec_ns - teraz + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC);
+        if (poll(pfd, 2, timeout_ms) <= 0)
+            continue;
+        uint64_t n;
+        if ((pfd[0].revents & POLLIN) && read(tfd, &n, sizeof(n)) == sizeof(n))
+            sem_operacja(SEM_KIEROWNIK, 1);
+        if (pfd[1].revents & POLLIN)
+        {
+            ssize_t r = read(kontekst->budzik_fd, &n, sizeof(n));
+            (void)r;
+        }
+    }
+
+    if (tfd >= 0)
+        (void)close(tfd);
+}
+
 /* Uruchamia główną pętlę restauracji i wykonuje sprzątanie. */
 int uruchom_restauracje(int czas_pracy)
 {
@@ -691,54 +1069,72 @@ int uruchom_restauracje(int czas_pracy)
     int status;
     int liczba_utworzonych_grup = liczba_klientow;
     int kierownik_interval = KIEROWNIK_INTERVAL_DEFAULT;
-    struct timespec last_kierownik_post;
-    clock_gettime(CLOCK_MONOTONIC, &last_kierownik_post);
     int numer_grupy = 1;
 
+    if (kontekst->tryb_klientow == TRYB_KORUTYNY &&
+        planista_start(kontekst->watki_klientow) != 0)
+    {
+        LOGE("Nie udało się uruchomić planisty, przełączam na tryb procesów\n");
+        kontekst->tryb_klientow = TRYB_PROCESY;
+    }
+    if (kontekst->tryb_klientow == TRYB_PULA)
+    {
+        int uruchomione = uruchom_pule_klientow();
+        if (uruchomione == 0)
+        {
+            LOGE("Nie udało się uruchomić puli klientów, przełączam na tryb procesów\n");
+            kontekst->tryb_klientow = TRYB_PROCESY;
+        }
+        kontekst->pula_procesow = uruchomione;
+    }
+
+    przybycia_start();
     struct GeneratorGrupCtx *gen_ctx = malloc(sizeof(*gen_ctx));
     if (!gen_ctx)
         return 1;
     *gen_ctx = (struct GeneratorGrupCtx){
         .liczba_utworzonych_grup = liczba_utworzonych_grup,
         .numer_grupy = numer_grupy,
+        .nastepny = numer_grupy,
+        .utworzone = 0,
+        .aktywne_watki = kontekst->watki_spawnu,
     };
-    pthread_t watek_generatora;
-    pthread_t watek_zbieracza;
-    int rc_generator = pthread_create(&watek_generatora, NULL,
-                                      watek_generatora_grup, gen_ctx);
-    if (rc_generator != 0)
+    int uruchomione_watki = 0;
+    for (int i = 0; i < kontekst->watki_spawnu; i++)
     {
-        LOGE_ERRNO("pthread_create(watek_generatora_grup)");
-        (void)watek_generatora_grup(gen_ctx);
+        pthread_t watek_generatora;
+        if (pthread_create(&watek_generatora, NULL, watek_generatora_grup,
+                           gen_ctx) != 0)
+        {
+            LOGE_ERRNO("pthread_create(watek_generatora_grup)");
+            __atomic_sub_fetch(&gen_ctx->aktywne_watki, 1, __ATOMIC_ACQ_REL);
+            continue;
+        }
+        (void)pthread_detach(watek_generatora);
+        uruchomione_watki++;
     }
-    else
+    if (uruchomione_watki == 0)
     {
-        (void)pthread_detach(watek_generatora);
+        gen_ctx->aktywne_watki = 1;
+        (void)watek_generatora_grup(gen_ctx);
     }
 
-    int rc_zbieracz = pthread_create(&watek_zbieracza, NULL,
-                                     watek_zbieracza_zombie, NULL);
-    if (rc_zbieracz != 0)
-        LOGE_ERRNO("pthread_create(watek_zbieracza_zombie)");
-    else
-        (void)pthread_detach(watek_zbieracza);
+    (void)zbieracz_start();
 
     struct timespec sim_start;
     clock_gettime(CLOCK_MONOTONIC, &sim_start);
-    while (sekundy_od(&sim_start) < czas_pracy &&
-           !kontekst->zamkniecie_zadane)
-    {
-        if (kierownik_interval > 0 &&
-            sekundy_od(&last_kierownik_post) >= kierownik_interval)
-        {
-            sem_operacja(SEM_KIEROWNIK, 1);
-            clock_gettime(CLOCK_MONOTONIC, &last_kierownik_post);
-        }
-        sched_yield();
-    }
+    long long miejsca_ns_start = stoliki_miejsca_ns();
+    czekaj_do_konca_pracy(&sim_start, czas_pracy, kierownik_interval);
+    struct timespec sim_koniec;
+    clock_gettime(CLOCK_MONOTONIC, &sim_koniec);
+    kontekst->miejsca_ns_symulacji = stoliki_miejsca_ns() - miejsca_ns_start;
+    kontekst->czas_symulacji_s = (double)(sim_koniec.tv_sec - sim_start.tv_sec) +
+                                 (double)(sim_koniec.tv_nsec - sim_start.tv_nsec) / 1e9;
+    kontekst->koniec_symulacji_ns =
+        (long long)sim_koniec.tv_sec * 1000000000LL + sim_koniec.tv_nsec;
 
     kontekst->stop_generatora = 1;
-    kontekst->stop_zbieracza = 1;
+    zbieracz_zatrzymaj();
 
     int przerwano_sygnalem = kontekst->zamkniecie_zadane;
     int restauracja_otwarta_przed = *common_ctx->restauracja_otwarta;
@@ -750,6 +1146,19 @@ int uruchom_restauracje(int czas_pracy)
     *common_ctx->restauracja_otwarta = 0;
     if (common_ctx->stoliki_sync)
         (void)pthread_cond_broadcast(&common_ctx->stoliki_sync->cond);
+    /* Obsługa może spać na pełnej taśmie, szatnia na pustej kolejce lub na
+     * futeksie zdarzeń — wszyscy mają zobaczyć zamknięcie od razu. */
+    (void)pthread_cond_broadcast(&common_ctx->tasma_sync->not_full);
+    tasma_obudz_wszystkie();
+    kolejka_obudz_wszystkich();
+    for (int s = 0; s < common_ctx->liczba_szatni; s++)
+        szatnia_powiadom(s);
+    /* Kierownik śpi na swoim semaforze do następnego taktu — budzimy go,
+     * żeby od razu przeszedł do tury 3. */
+    sem_operacja(SEM_KIEROWNIK, 1);
+    /* Obudź bezczynnych pracowników puli i generator czekający na miejsce. */
+    futex_obudz(&common_ctx->pula->opublikowane, INT_MAX);
+    futex_obudz(&common_ctx->pula->pobrane, INT_MAX);
     if (przerwano_sygnalem)
     {
         const char *name = "(nieznany)";
@@ -0,0 +1,227 @@
+#define _GNU_SOURCE
+#include "rozmieszczenie.h"
+
+#include "common.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct RozmieszczenieCtx
+{
+    enum StrategiaRozmieszczenia strategia;
+    int liczba_dostepnych;
+    int dostepne[CPU_SETSIZE]; // maska startowa rodzica, rosnąco
+    int rdzen_roli[ROLA_LICZBA];
+    int liczba_klienckich;
+    int klienckie[CPU_SETSIZE];
+    long bledy;
+};
+
+static struct RozmieszczenieCtx rozm_storage = {.strategia = ROZMIESZCZENIE_BRAK};
+static struct RozmieszczenieCtx *rozm = &rozm_storage;
+
+static const char *nazwa_strategii(enum StrategiaRozmieszczenia s)
+{
+    switch (s)
+    {
+    case ROZMIESZCZENIE_ZWARTE:
+        return "zwarte";
+    case ROZMIESZCZENIE_ROZPROSZONE:
+        return "rozproszone";
+    default:
+        return "brak";
+    }
+}
+
+static int czy_dostepny(int cpu)
+{
+    for (int i = 0; i < rozm->liczba_dostepnych; i++)
+        if (rozm->dostepne[i] == cpu)
+            return 1;
+    return 0;
+}
+
+// Rdzenie ról z RESTAURACJA_RDZENIE_ROL ("o,s,k,m"); pozycje puste lub
+// spoza maski zostają przy rdzeniu wyliczonym ze strategii.
+static void wczytaj_rdzenie_rol(void)
+{
+    const char *s = getenv("RESTAURACJA_RDZENIE_ROL");
+    if (!s || !*s)
+        return;
+    const char *p = s;
+    for (int rola = ROLA_OBSLUGA; rola < ROLA_LICZBA && *p; rola++)
+    {
+        char *end = NULL;
+        errno = 0;
+        long cpu = strtol(p, &end, 10);
+        if (end != p && errno == 0 && cpu >= 0 && cpu < CPU_SETSIZE &&
+            czy_dostepny((int)cpu))
+            rozm->rdzen_roli[rola] = (int)cpu;
+        else if (end != p)
+            LOGE("RESTAURACJA_RDZENIE_ROL: rdzeń %ld niedostępny dla roli %s\n",
+                 cpu, zbieracz_nazwa_roli((enum RolaProcesu)rola));
+        p = strchr(p, ',');
+        if (!p)
+            break;
+        p++;
+    }
+}
+
+void rozmieszczenie_inicjuj(void)
+{
+    const char *s = getenv("RESTAURACJA_AFINICZNOSC");
+    if (!s || !*s || strcmp(s, "brak") == 0)
+        return;
+    if (strcmp(s, "zwarte") == 0 || strcmp(s, "compact") == 0)
+        rozm->strategia = ROZMIESZCZENIE_ZWARTE;
+    else if (strcmp(s, "rozproszone") == 0 || strcmp(s, "spread") == 0)
+        rozm->strategia = ROZMIESZCZENIE_ROZPROSZONE;
+    else
+    {
+        LOGE("Nieznane RESTAURACJA_AFINICZNOSC=%s, bez przypinania\n", s);
+        return;
+    }
+
+    cpu_set_t maska;
+    CPU_ZERO(&maska);
+    if (sched_getaffinity(0, sizeof(maska), &maska) != 0)
+    {
+        LOGE_ERRNO("sched_getaffinity");
+        rozm->strategia = ROZMIESZCZENIE_BRAK;
+        return;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &maska))
+            rozm->dostepne[rozm->liczba_dostepnych++] = cpu;
+    int n = rozm->liczba_dostepnych;
+    if (n == 0)
+    {
+        rozm->strategia = ROZMIESZCZENIE_BRAK;
+        return;
+    }
+
+    // Role numerujemy od 0 (obsługa) do 3 (kierownik).
+    for (int rola = ROLA_OBSLUGA; rola < ROLA_LICZBA; rola++)
+    {
+        int i = rola - ROLA_OBSLUGA;
+        int liczba_rol = ROLA_LICZBA - ROLA_OBSLUGA;
+        if (rozm->strategia == ROZMIESZCZENIE_ZWARTE)
+            rozm->rdzen_roli[rola] = rozm->dostepne[i % n];
+        else
+            rozm->rdzen_roli[rola] = rozm->dostepne[i * n / liczba_rol];
+    }
+    wczytaj_rdzenie_rol();
+
+    for (int i = 0; i < n; i++)
+    {
+        int cpu = rozm->dostepne[i];
+        int zajety = 0;
+        for (int rola = ROLA_OBSLUGA; rola < ROLA_LICZBA; rola++)
+            if (rozm->rdzen_roli[rola] == cpu)
+                zajety = 1;
+        if (!zajety)
+            rozm->klienckie[rozm->liczba_klienckich++] = cpu;
+    }
+    if (rozm->liczba_klienckich == 0)
+    {
+        // Za mało rdzeni, żeby oddzielić klientów od ról — dzielą wszystkie.
+        memcpy(rozm->klienckie, rozm->dostepne, sizeof(int) * (size_t)n);
+        rozm->liczba_klienckich = n;
+    }
+}
+
+static void przypnij(pid_t pid, const int *rdzenie, int ile)
+{
+    cpu_set_t maska;
+    CPU_ZERO(&maska);
+    for (int i = 0; i < ile; i++)
+        CPU_SET(rdzenie[i], &maska);
+    // ESRCH: krótko żyjący klient zdążył się zakończyć — nic do zrobienia.
+    if (sched_setaffinity(pid, sizeof(maska), &maska) != 0 && errno != ESRCH)
+    {
+        __atomic_add_fetch(&rozm->bledy, 1, __ATOMIC_RELAXED);
+        LOGD("rozmieszczenie: sched_setaffinity(%d) errno=%d\n", (int)pid, errno);
+    }
+}
+
+void rozmieszczenie_przypnij_role(pid_t pid, enum RolaProcesu rola)
+{
+    if (rozm->strategia == ROZMIESZCZENIE_BRAK || pid <= 0 || rola == ROLA_KLIENT)
+        return;
+    przypnij(pid, &rozm->rdzen_roli[rola], 1);
+}
+
+void rozmieszczenie_przypnij_klienta(pid_t pid, long indeks)
+{
+    // W strategii zwartej klienci dziedziczą maskę rodzica (rozmieszczenie_
+    // przypnij_rodzica), więc nie płacimy syscallem za każdy spawn.
+    if (rozm->strategia != ROZMIESZCZENIE_ROZPROSZONE || pid <= 0)
+        return;
+    long i = indeks % rozm->liczba_klienckich;
+    if (i < 0)
+        i += rozm->liczba_klienckich;
+    przypnij(pid, &rozm->klienckie[i], 1);
+}
+
+void rozmieszczenie_przypnij_rodzica(void)
+{
+    if (rozm->strategia == ROZMIESZCZENIE_BRAK)
+        return;
+    przypnij(0, rozm->klienckie, rozm->liczba_klienckich);
+}
+
+static void dopisz_do_bufora(char *buf, size_t rozmiar, size_t *offset,
+                             const char *fmt, ...)
+{
+    if (!buf || !offset || *offset >= rozmiar)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + *offset, rozmiar - *offset, fmt, ap);
+    va_end(ap);
+
+    if (n <= 0)
+        return;
+
+    size_t dodano = (size_t)n;
+    if (dodano >= rozmiar - *offset)
+        *offset = rozmiar - 1;
+    else
+        *offset += dodano;
+}
+
+void rozmieszczenie_opisz(char *buf, size_t rozmiar)
+{
+    if (!buf || rozmiar == 0)
+        return;
+    size_t off = 0;
+    buf[0] = '\0';
+    dopisz_do_bufora(buf, rozmiar, &off, "%s", nazwa_strategii(rozm->strategia));
+    if (rozm->strategia == ROZMIESZCZENIE_BRAK)
+        return;
+    for (int rola = ROLA_OBSLUGA; rola < ROLA_LICZBA; rola++)
+        dopisz_do_bufora(buf, rozmiar, &off, "%s%s %d",
+                         rola == ROLA_OBSLUGA ? " (" : ", ",
+                         zbieracz_nazwa_roli((enum RolaProcesu)rola),
+                         rozm->rdzen_roli[rola]);
+    // Rdzenie klientów jako zakresy, np. "1,3,4-7".
+    dopisz_do_bufora(buf, rozmiar, &off, "; klienci ");
+    const int *r = rozm->klienckie;
+    for (int i = 0; i < rozm->liczba_klienckich; i++)
+    {
+        int j = i;
+        while (j + 1 < rozm->liczba_klienckich && r[j + 1] == r[j] + 1)
+            j++;
+        if (j > i)
+            dopisz_do_bufora(buf, rozmiar, &off, "%s%d-%d", i ? "," : "", r[i], r[j]);
+        else
+            dopisz_do_bufora(buf, rozmiar, &off, "%s%d", i ? "," : "", r[i]);
+        i = j;
+    }
+    dopisz_do_bufora(buf, rozmiar, &off, "; błędy: %ld)", rozm->bledy);
+}
@@ -0,0 +1,313 @@
+#define _GNU_SOURCE
+#include "segment.h"
+
+#include "common.h"
+#include "uruchamianie.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/shm.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23 // Linux 5.14
+#endif
+#ifndef SHM_HUGETLB
+#define SHM_HUGETLB 04000
+#endif
+
+#define ROZMIAR_HUGE (2UL * 1024 * 1024)
+
+enum StronySegmentu
+{
+    STRONY_ZWYKLE = 0,
+    STRONY_HUGE = 1,
+    STRONY_THP = 2,
+};
+
+enum PrefaultSegmentu
+{
+    PREFAULT_BRAK = 0,
+    PREFAULT_POPULATE = 1,
+    PREFAULT_MLOCK = 2,
+};
+
+struct SegmentCtx
+{
+    enum BackendSegmentu backend;
+    enum StronySegmentu strony;
+    enum PrefaultSegmentu prefault;
+    int wczytano;
+    int hugetlb; // strony huge faktycznie przydzielone
+    int fd;      // kopia rodzica (O_CLOEXEC); -1 dla sysv
+    size_t rozmiar;
+    int mlock_errno;
+};
+
+static struct SegmentCtx seg_storage = {.backend = SEGMENT_SYSV, .fd = -1};
+static struct SegmentCtx *seg = &seg_storage;
+
+static const char *nazwa_backendu(enum BackendSegmentu b)
+{
+    switch (b)
+    {
+    case SEGMENT_MEMFD:
+        return "memfd";
+    case SEGMENT_POSIX:
+        return "posix";
+    default:
+        return "sysv";
+    }
+}
+
+// Dzieci po exec() czytają to samo środowisko, więc każdy proces stosuje
+// te same strony i prefault do swojego mapowania.
+static void wczytaj_ustawienia(void)
+{
+    if (seg->wczytano)
+        return;
+    seg->wczytano = 1;
+
+    const char *s = getenv("RESTAURACJA_SHM");
+    if (s && strcmp(s, "memfd") == 0)
+        seg->backend = SEGMENT_MEMFD;
+    else if (s && strcmp(s, "posix") == 0)
+        seg->backend = SEGMENT_POSIX;
+    else if (s && *s && strcmp(s, "sysv") != 0)
+        LOGE("Nieznany RESTAURACJA_SHM=%s, używam sysv\n", s);
+
+    s = getenv("RESTAURACJA_SHM_STRONY");
+    if (s && strcmp(s, "huge") == 0)
+        seg->strony = STRONY_HUGE;
+    else if (s && strcmp(s, "thp") == 0)
+        seg->strony = STRONY_THP;
+    else if (s && *s && strcmp(s, "zwykle") != 0)
+        LOGE("Nieznane RESTAURACJA_SHM_STRONY=%s, używam zwykłych\n", s);
+
+    s = getenv("RESTAURACJA_SHM_PREFAULT");
+    if (s && (strcmp(s, "populate") == 0 || strcmp(s, "1") == 0))
+        seg->prefault = PREFAULT_POPULATE;
+    else if (s && strcmp(s, "mlock") == 0)
+        seg->prefault = PREFAULT_MLOCK;
+    else if (s && *s && strcmp(s, "0") != 0)
+        LOGE("Nieznane RESTAURACJA_SHM_PREFAULT=%s, bez prefaultu\n", s);
+}
+
+static size_t zaokraglij(size_t n, size_t krok) { return (n + krok - 1) / krok * krok; }
+
+// MAP_POPULATE, chyba że chcemy THP na zwykłych stronach —
+// madvise(MADV_HUGEPAGE) musi przyjść przed pierwszym dotknięciem stron.
+static int populate_przy_mmap(void)
+{
+    return seg->prefault != PREFAULT_BRAK && (seg->hugetlb || seg->strony == STRONY_ZWYKLE);
+}
+
+static void *mapuj_fd(int fd, size_t rozmiar)
+{
+    int flagi = MAP_SHARED | (populate_przy_mmap() ? MAP_POPULATE : 0);
+    void *adres = mmap(NULL, rozmiar, PROT_READ | PROT_WRITE, flagi, fd, 0);
+    return adres == MAP_FAILED ? NULL : adres;
+}
+
+// Po zmapowaniu w każdym procesie: THP, prefault tam, gdzie nie zrobił go
+// MAP_POPULATE, i mlock.
+static void po_zmapowaniu(void *adres, size_t rozmiar, int zapelnione)
+{
+    if (!seg->hugetlb && seg->strony != STRONY_ZWYKLE)
+        (void)madvise(adres, rozmiar, MADV_HUGEPAGE);
+    // EINVAL na jądrach < 5.14 — zostają leniwe błędy stron.
+    if (seg->prefault != PREFAULT_BRAK && !zapelnione)
+        (void)madvise(adres, rozmiar, MADV_POPULATE_WRITE);
+    if (seg->prefault == PREFAULT_MLOCK && mlock(adres, rozmiar) != 0)
+    {
+        seg->mlock_errno = errno;
+        LOGD("segment: mlock(%zu) errno=%d\n", rozmiar, errno);
+    }
+}
+
+static void *utworz_sysv(size_t rozmiar)
+{
+    int id = -1;
+    if (seg->strony == STRONY_HUGE)
+    {
+        size_t r = zaokraglij(rozmiar, ROZMIAR_HUGE);
+        id = shmget(IPC_PRIVATE, r, IPC_CREAT | 0600 | SHM_HUGETLB);
+        if (id >= 0)
+        {
+            seg->hugetlb = 1;
+            seg->rozmiar = r;
+        }
+        else
+            LOGD("segment: SHM_HUGETLB niedostępne (errno=%d), zwykłe strony\n", errno);
+    }
+    if (id < 0)
+    {
+        id = shmget(IPC_PRIVATE, rozmiar, IPC_CREAT | 0600);
+        seg->rozmiar = rozmiar;
+    }
+    if (id < 0)
+    {
+        LOGE_ERRNO("shmget");
+        return NULL;
+    }
+    common_ctx->shm_id = id;
+    void *adres = shmat(id, NULL, 0);
+    if (adres == (void *)-1)
+    {
+        LOGE_ERRNO("shmat");
+        return NULL;
+    }
+    return adres;
+}
+
+static int otworz_fd(int hugetlb)
+{
+    if (seg->backend == SEGMENT_MEMFD)
+        return memfd_create("restauracja", MFD_CLOEXEC | (hugetlb ? MFD_HUGETLB : 0));
+
+    // Nazwa żyje tylko do shm_unlink — dalej segment jest dostępny wyłącznie
+    // przez deskryptor, jak memfd.
+    char nazwa[64];
+    snprintf(nazwa, sizeof(nazwa), "/restauracja.%d", (int)getpid());
+    int fd = shm_open(nazwa, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd >= 0)
+        (void)shm_unlink(nazwa);
+    return fd;
+}
+
+static void *utworz_fd(size_t rozmiar)
+{
+    void *adres = NULL;
+    // tmpfs pod shm_open nie daje hugetlb; tam `huge` kończy się na THP.
+    if (seg->strony == STRONY_HUGE && seg->backend == SEGMENT_MEMFD)
+    {
+        size_t r = zaokraglij(rozmiar, ROZMIAR_HUGE);
+        int fd = otworz_fd(1);
+        seg->hugetlb = 1;
+        if (fd >= 0 && ftruncate(fd, (off_t)r) == 0 && (adres = mapuj_fd(fd, r)) != NULL)
+        {
+            seg->fd = fd;
+            seg->rozmiar = r;
+        }
+        else
+        {
+            LOGD("segment: hugetlb niedostępne (errno=%d), zwykłe strony\n", errno);
+            seg->hugetlb = 0;
+            if (fd >= 0)
+                (void)close(fd);
+        }
+    }
+    if (!adres)
+    {
+        int fd = otworz_fd(0);
+        if (fd < 0)
+        {
+            LOGE_ERRNO(seg->backend == SEGMENT_MEMFD ? "memfd_create" : "shm_open");
+            return NULL;
+        }
+        if (ftruncate(fd, (off_t)rozmiar) != 0 || (adres = mapuj_fd(fd, rozmiar)) == NULL)
+        {
+            LOGE_ERRNO("ftruncate/mmap segmentu");
+            (void)close(fd);
+            return NULL;
+        }
+        seg->fd = fd;
+        seg->rozmiar = rozmiar;
+    }
+
+    // Dzieci dostają segment jako FD 3; kopia rodzica nie może nim być, bo
+    // dup2() na ten sam numer nie zdjęłoby O_CLOEXEC.
+    if (seg->fd <= URUCHAMIANIE_FD_PRZEKAZANY)
+    {
+        int nowy = fcntl(seg->fd, F_DUPFD_CLOEXEC, URUCHAMIANIE_FD_PRZEKAZANY + 1);
+        if (nowy >= 0)
+        {
+            (void)close(seg->fd);
+            seg->fd = nowy;
+        }
+    }
+    common_ctx->shm_id = -1;
+    return adres;
+}
+
+void *segment_utworz(size_t rozmiar)
+{
+    wczytaj_ustawienia();
+    void *adres = (seg->backend == SEGMENT_SYSV) ? utworz_sysv(rozmiar) : utworz_fd(rozmiar);
+    if (!adres)
+        exit(1);
+    po_zmapowaniu(adres, seg->rozmiar, seg->backend != SEGMENT_SYSV && populate_przy_mmap());
+    return adres;
+}
+
+void *segment_dolacz_sysv(int shm_id)
+{
+    wczytaj_ustawienia();
+    void *adres = shmat(shm_id, NULL, 0);
+    if (adres == (void *)-1)
+    {
+        LOGE_ERRNO("shmat");
+        return NULL;
+    }
+    struct shmid_ds ds;
+    if (shmctl(shm_id, IPC_STAT, &ds) == 0)
+    {
+        seg->rozmiar = ds.shm_segsz;
+        po_zmapowaniu(adres, seg->rozmiar, 0);
+    }
+    return adres;
+}
+
+void *segment_dolacz_fd(int fd)
+{
+    wczytaj_ustawienia();
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        LOGE_ERRNO("fstat segmentu");
+        return NULL;
+    }
+    // hugetlbfs zgłasza rozmiar bloku równy rozmiarowi dużej strony.
+    seg->hugetlb = st.st_blksize > sysconf(_SC_PAGESIZE);
+    seg->rozmiar = (size_t)st.st_size;
+    void *adres = mapuj_fd(fd, seg->rozmiar);
+    if (!adres)
+    {
+        LOGE_ERRNO("mmap segmentu");
+        return NULL;
+    }
+    // Mapowanie trzyma segment przy życiu; deskryptor nie jest już potrzebny.
+    (void)close(fd);
+    po_zmapowaniu(adres, seg->rozmiar, populate_przy_mmap());
+    return adres;
+}
+
+int segment_fd(void) { return seg->fd; }
+
+void segment_argument(char *buf, size_t rozmiar)
+{
+    if (seg->backend == SEGMENT_SYSV)
+        snprintf(buf, rozmiar, "%d", common_ctx->shm_id);
+    else
+        snprintf(buf, rozmiar, "fd:%d", URUCHAMIANIE_FD_PRZEKAZANY);
+}
+
+void segment_opisz(char *buf, size_t rozmiar)
+{
+    static const char *const strony[] = {"zwykle", "huge", "thp"};
+    static const char *const prefault[] = {"brak", "populate", "mlock"};
+    char mlock_blad[32] = "";
+    if (seg->mlock_errno)
+        snprintf(mlock_blad, sizeof(mlock_blad), " (mlock errno %d)", seg->mlock_errno);
+    snprintf(buf, rozmiar, "%s, %.1f KiB, strony %s%s, prefault %s%s",
+             nazwa_backendu(seg->backend), (double)seg->rozmiar / 1024.0,
+             strony[seg->strony],
+             (seg->strony == STRONY_HUGE && !seg->hugetlb) ? " (brak hugetlb, THP)" : "",
+             prefault[seg->prefault], mlock_blad);
+}
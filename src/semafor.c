@@ -0,0 +1,66 @@
+#include "semafor.h"
+
+#include "common.h"
+
+#include <limits.h>
+#include <time.h>
+
+// Pojedynczy FUTEX_WAIT bez limitu też ma granicę: sygnał, który przyjdzie
+// między sprawdzeniem `stop` a wejściem do jądra, nie przerwie czekania.
+#define SEMAFOR_PLASTER_MS 1000
+
+static long long teraz_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / NSEC_PER_MSEC;
+}
+
+void semafor_inicjuj(struct SemaforShm *s, int wartosc)
+{
+    __atomic_store_n(&s->wartosc, wartosc, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->czekajacy, 0, __ATOMIC_RELAXED);
+}
+
+void semafor_podnies(struct SemaforShm *s, int ile)
+{
+    __atomic_add_fetch(&s->wartosc, ile, __ATOMIC_RELEASE);
+    // Czekający zwiększa `czekajacy` przed odczytem wartości do FUTEX_WAIT,
+    // więc pełna bariera tutaj wystarcza, żeby go nie przeoczyć.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s->czekajacy, __ATOMIC_RELAXED) > 0)
+        futex_obudz(&s->wartosc, ile);
+}
+
+int semafor_sprobuj(struct SemaforShm *s)
+{
+    int v = __atomic_load_n(&s->wartosc, __ATOMIC_ACQUIRE);
+    while (v > 0)
+    {
+        if (__atomic_compare_exchange_n(&s->wartosc, &v, v - 1, 0, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE))
+            return 0;
+    }
+    return -1;
+}
+
+int semafor_opusc(struct SemaforShm *s, int timeout_ms, volatile sig_atomic_t *stop)
+{
+    long long koniec = timeout_ms >= 0 ? teraz_ms() + timeout_ms : LLONG_MAX;
+    for (;;)
+    {
+        if (semafor_sprobuj(s) == 0)
+            return 0;
+        if (stop && *stop)
+            return -1;
+        long long zostalo = koniec - teraz_ms();
+        if (zostalo <= 0)
+            return -1;
+        int plaster = zostalo < SEMAFOR_PLASTER_MS ? (int)zostalo : SEMAFOR_PLASTER_MS;
+
+        __atomic_add_fetch(&s->czekajacy, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&s->wartosc, __ATOMIC_SEQ_CST) <= 0)
+            (void)futex_czekaj(&s->wartosc, 0, plaster);
+        __atomic_sub_fetch(&s->czekajacy, 1, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,32 @@
+#define _GNU_SOURCE
+#include "statystyki.h"
+
+#include <sched.h>
+
+_Static_assert((STATYSTYKI_SHARDY & (STATYSTYKI_SHARDY - 1)) == 0,
+               "STATYSTYKI_SHARDY musi być potęgą dwójki");
+
+// sched_getcpu() idzie przez rseq/vDSO, więc nie wchodzi do jądra. Po
+// migracji wątku możemy trafić w cudzy shard — atomowe dodawanie to
+// znosi, a sumy są liczone dopiero przy raporcie.
+static struct ShardStatystyk *moj_shard(void)
+{
+    int cpu = sched_getcpu();
+    if (cpu < 0)
+        cpu = 0;
+    return &common_ctx->statystyki->shardy[cpu & (STATYSTYKI_SHARDY - 1)];
+}
+
+void statystyki_dodaj(enum LicznikStatystyk licznik, long long ile)
+{
+    __atomic_add_fetch(&moj_shard()->liczniki[licznik], ile, __ATOMIC_RELAXED);
+}
+
+long long statystyki_suma(enum LicznikStatystyk licznik)
+{
+    long long suma = 0;
+    for (int i = 0; i < STATYSTYKI_SHARDY; i++)
+        suma += __atomic_load_n(&common_ctx->statystyki->shardy[i].liczniki[licznik],
+                                __ATOMIC_RELAXED);
+    return suma;
+}
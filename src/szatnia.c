@@ -1,254 +1,303 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "szatnia.h"
+#include "kolejka.h"
+#include "statystyki.h"
+#include "wolne_miejsca.h"
 
-#include <errno.h>
-#include <sched.h>
 #include <stdlib.h>
-#include <sys/msg.h>
-#include <time.h>
 #include <unistd.h>
 
+/* Grupy pobrane z kolejki, które czekają na stolik — osobna lista FIFO dla
+ * każdej klasy (VIP / zwykła) i liczby osób. Listy jednej klasy mieszczą
+ * razem najwyżej KOLEJKA_POJEMNOSC grup, bo każda trzyma żeton pierścienia
+ * swojej klasy do usadzenia. */
+struct ListaOczekujacych
+{
+    struct Grupa grupy[KOLEJKA_POJEMNOSC];
+    unsigned long kolejnosc[KOLEJKA_POJEMNOSC]; // numer wejścia do szatni
+    long long wejscie_ns[KOLEJKA_POJEMNOSC];    // do starzenia
+    int glowa;
+    int liczba;
+};
+
+struct Usadzenie
+{
+    struct Grupa grupa;
+    int klasa;      // pierścień, któremu oddajemy żeton
+    int postarzona; // zwykła grupa usadzona z pasa VIP
+    int stolik;
+    int numer_stolika;
+    int zajete;
+    int pojemnosc;
+};
+
 struct SzatniaCtx
 {
     volatile sig_atomic_t shutdown_requested;
+    int numer;                           // część sali i kolejka tej szatni
+    struct ListaOczekujacych *czekajace; // [KLASY_KOLEJKI * 4], klasa * 4 + osoby - 1
+    unsigned long wejscia;
+    int partia;                    // RESTAURACJA_SZATNIA_PARTIA
+    int waga_vip;                  // RESTAURACJA_WAGA_VIP
+    long long starzenie_ns;        // RESTAURACJA_STARZENIE_MS, 0 = bez starzenia
+    int vip_z_rzedu;               // usadzenia z pasa VIP, gdy czekała też zwykła
+    struct Usadzenie *usadzone;    // [partia], wynik usadz_partie()
 };
 
 static struct SzatniaCtx szat_ctx_storage = {.shutdown_requested = 0};
 static struct SzatniaCtx *szat_ctx = &szat_ctx_storage;
 
-static void kolejka_dodaj_local(struct Grupa g);
-static struct Grupa kolejka_pobierz_local(void);
+static long long teraz_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 
-static int usadz_grupe(const struct Grupa *g, int *numer_stolika,
-                       int *zajete, int *pojemnosc)
+static struct ListaOczekujacych *lista(int klasa, int rozmiar)
 {
-    int stolik_idx = -1;
-    int usadzono = 0;
+    return &szat_ctx->czekajace[klasa * 4 + rozmiar];
+}
 
-    pthread_mutex_lock(&common_ctx->stoliki_sync->mutex);
-    stolik_idx = znajdz_stolik_dla_grupy_zablokowanej(g);
-    if (stolik_idx >= 0)
-    {
-        struct Stolik *st = &common_ctx->stoliki[stolik_idx];
-        st->grupy[st->liczba_grup] = *g;
-        st->zajete_miejsca += g->osoby;
-        st->liczba_grup++;
-        usadzono = 1;
-        if (numer_stolika)
-            *numer_stolika = st->numer_stolika;
-        if (zajete)
-            *zajete = st->zajete_miejsca;
-        if (pojemnosc)
-            *pojemnosc = st->pojemnosc;
-    }
-    pthread_mutex_unlock(&common_ctx->stoliki_sync->mutex);
+static void lista_dodaj(const struct Grupa *g, int klasa, long long teraz)
+{
+    struct ListaOczekujacych *l = lista(klasa, g->osoby - 1);
+    int i = (l->glowa + l->liczba) % KOLEJKA_POJEMNOSC;
+    l->grupy[i] = *g;
+    l->kolejnosc[i] = szat_ctx->wejscia++;
+    l->wejscie_ns[i] = teraz;
+    l->liczba++;
+}
 
-    return usadzono;
+static void lista_zdejmij(int klasa, int rozmiar, struct Grupa *g)
+{
+    struct ListaOczekujacych *l = lista(klasa, rozmiar);
+    *g = l->grupy[l->glowa];
+    l->glowa = (l->glowa + 1) % KOLEJKA_POJEMNOSC;
+    l->liczba--;
 }
 
-void szatnia(void)
+/* Przenosi do `partia` grup z pierścieni tej szatni na listy, najpierw z
+ * pasa VIP; zwraca ich liczbę. */
+static int pobierz_nowe_grupy(void)
 {
-    while (*common_ctx->restauracja_otwarta && !szat_ctx->shutdown_requested)
+    int n = 0;
+    struct Grupa g;
+    long long teraz = teraz_ns();
+    for (int klasa = 0; klasa < KLASY_KOLEJKI; klasa++)
     {
-        struct Grupa g = kolejka_pobierz_local();
-        LOGD("szatnia: pid=%d kolejka_pobierz returned group=%d\n",
-             (int)getpid(), g.numer_grupy);
-        if (g.numer_grupy == 0)
-            continue;
-
-        int numer_stolika = 0;
-        int zajete = 0;
-        int pojemnosc = 0;
-        if (usadz_grupe(&g, &numer_stolika, &zajete, &pojemnosc))
+        while (n < szat_ctx->partia &&
+               kolejka_sprobuj_pobierz(szat_ctx->numer, klasa, &g) == 0)
         {
-            LOGP("Grupa usadzona: %d przy stoliku: %d (%d/%d miejsc zajętych)\n",
-                 g.numer_grupy, numer_stolika, zajete, pojemnosc);
-            /* Zliczamy osoby (klientów), a nie grupy. */
-            if (common_ctx->statystyki_sync &&
-                pthread_mutex_lock(&common_ctx->statystyki_sync->mutex) == 0)
+            if (g.osoby < 1 || g.osoby > 4)
             {
-                (*common_ctx->klienci_przyjeci) += g.osoby;
-                pthread_mutex_unlock(&common_ctx->statystyki_sync->mutex);
+                LOGE("szatnia: grupa %d ma %d osób, pomijam\n", g.numer_grupy, g.osoby);
+                kolejka_zwolnij_miejsce(szat_ctx->numer, klasa);
+                statystyki_dodaj(STAT_KLIENCI_W_KOLEJCE, -g.osoby);
+                continue;
             }
-            if (g.proces_id > 0)
-                (void)kill(g.proces_id, SIGUSR1);
+            LOGD("szatnia %d: pid=%d grupa %d (%d os.%s) czeka na stolik\n", szat_ctx->numer,
+                 (int)getpid(), g.numer_grupy, g.osoby, klasa == KLASA_VIP ? ", VIP" : "");
+            lista_dodaj(&g, klasa, teraz);
+            n++;
         }
-        else if (*common_ctx->restauracja_otwarta)
-        {
-            kolejka_dodaj_local(g);
-        }
-
-        sched_yield();
     }
+    return n;
 }
 
-static void kolejka_dodaj_local(struct Grupa g)
+/* Kandydat jednego pasa: najstarsza głowa list, dla której jest stolik. */
+struct Kandydat
 {
-    QueueMsg msg;
-    msg.mtype = 1;
-    msg.grupa = g;
-    for (;;)
-    {
-        if (!*common_ctx->restauracja_otwarta)
-            return;
-
-        struct timespec now, abstime;
-        clock_gettime(CLOCK_REALTIME, &now);
-        abstime = now;
-        abstime.tv_sec += 1;
+    int klasa;
+    int rozmiar; // -1: brak
+    int stolik;
+    unsigned long kolejnosc;
+};
 
-        if (pthread_mutex_lock(&common_ctx->queue_sync->mutex) != 0)
-            continue;
-        while (common_ctx->queue_sync->count >= common_ctx->queue_sync->max)
+/* Wybiera następną grupę do usadzenia. Pas VIP to grupy VIP i zwykłe
+ * czekające dłużej niż starzenie; w każdym pasie wygrywa najstarsza grupa,
+ * dla której jest stolik (sprawdzenie to zapytanie do indeksu, więc najwyżej
+ * osiem zapytań). Gdy mają kandydata oba pasy, na `waga_vip` grup z pasa
+ * VIP przypada jedna zwykła. Zwraca 0 i wypełnia `wybrany` albo -1; wołać
+ * pod mutexem stolików. */
+static int wybierz_zablokowana(long long teraz, struct Kandydat *wybrany, int *postarzona)
+{
+    struct Kandydat pas[2] = {{.rozmiar = -1}, {.rozmiar = -1}};
+    int pas_postarzony = 0;
+    for (int klasa = 0; klasa < KLASY_KOLEJKI; klasa++)
+    {
+        for (int r = 0; r < 4; r++)
         {
-            int rc = pthread_cond_timedwait(
-                &common_ctx->queue_sync->not_full, &common_ctx->queue_sync->mutex,
-                &abstime);
-            if (rc == ETIMEDOUT)
-            {
-                if (!*common_ctx->restauracja_otwarta)
-                {
-                    pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-                    return;
-                }
-                clock_gettime(CLOCK_REALTIME, &now);
-                abstime = now;
-                abstime.tv_sec += 1;
+            struct ListaOczekujacych *l = lista(klasa, r);
+            if (l->liczba == 0)
                 continue;
-            }
-            if (rc != 0)
-            {
-                if (common_ctx->shutdown_flag_ptr &&
-                    *common_ctx->shutdown_flag_ptr)
-                {
-                    pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-                    exit(0);
-                }
+            int stara = klasa != KLASA_VIP && szat_ctx->starzenie_ns > 0 &&
+                        teraz - l->wejscie_ns[l->glowa] >= szat_ctx->starzenie_ns;
+            struct Kandydat *k = &pas[(klasa == KLASA_VIP || stara) ? 0 : 1];
+            if (k->rozmiar >= 0 && l->kolejnosc[l->glowa] > k->kolejnosc)
                 continue;
-            }
-        }
-
-        if (msgsnd(common_ctx->msgq_id, &msg, sizeof(msg.grupa), IPC_NOWAIT) == 0)
-        {
-            common_ctx->queue_sync->count++;
-            (*common_ctx->klienci_w_kolejce) += msg.grupa.osoby;
-            pthread_cond_signal(&common_ctx->queue_sync->not_empty);
-            pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-            return;
+            int i = znajdz_stolik_dla_grupy_zablokowanej(&l->grupy[l->glowa]);
+            if (i < 0)
+                continue;
+            *k = (struct Kandydat){klasa, r, i, l->kolejnosc[l->glowa]};
+            if (k == &pas[0])
+                pas_postarzony = stara;
         }
+    }
 
-        pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
+    int p;
+    if (pas[0].rozmiar < 0 && pas[1].rozmiar < 0)
+        return -1;
+    if (pas[1].rozmiar < 0)
+        p = 0;
+    else if (pas[0].rozmiar < 0)
+        p = 1;
+    else
+        p = (szat_ctx->waga_vip == 0 || szat_ctx->vip_z_rzedu < szat_ctx->waga_vip) ? 0 : 1;
 
-        if (errno == EINTR)
-            continue;
-        if (errno == EAGAIN)
-            continue;
-        if (errno == EIDRM || errno == EINVAL)
-            exit(0);
+    if (p == 0 && pas[1].rozmiar >= 0)
+        szat_ctx->vip_z_rzedu++;
+    else if (p == 1)
+        szat_ctx->vip_z_rzedu = 0;
+    *wybrany = pas[p];
+    *postarzona = (p == 0) && pas_postarzony;
+    return 0;
+}
 
-        return;
+/* Usadza do `partia` grup wybranych przez wybierz_zablokowana() w jednej
+ * sekcji krytycznej stolików tej szatni; wyniki trafiają do
+ * szat_ctx->usadzone. Zwraca ich liczbę. */
+static int usadz_partie(void)
+{
+    int n = 0;
+    long long teraz = teraz_ns();
+    pthread_mutex_lock(stoliki_mutex(szat_ctx->numer));
+    while (n < szat_ctx->partia)
+    {
+        struct Kandydat k;
+        int postarzona = 0;
+        if (wybierz_zablokowana(teraz, &k, &postarzona) != 0)
+            break;
+        int stolik_idx = k.stolik;
+        struct Usadzenie *u = &szat_ctx->usadzone[n++];
+        lista_zdejmij(k.klasa, k.rozmiar, &u->grupa);
+        u->klasa = k.klasa;
+        u->postarzona = postarzona;
+        struct Stolik *st = &common_ctx->stoliki[stolik_idx];
+        stolik_grupy(stolik_idx)[st->liczba_grup] = u->grupa;
+        st->zajete_miejsca += u->grupa.osoby;
+        st->liczba_grup++;
+        stoliki_rozlicz_miejsca(szat_ctx->numer, u->grupa.osoby);
+        wolne_miejsca_aktualizuj(stolik_idx);
+        u->stolik = stolik_idx;
+        u->numer_stolika = st->numer_stolika;
+        u->zajete = st->zajete_miejsca;
+        u->pojemnosc = st->pojemnosc;
     }
+    pthread_mutex_unlock(stoliki_mutex(szat_ctx->numer));
+    return n;
+}
+
+// Grupa zrezygnowała (zamknięcie), zanim dostała stolik — zwalniamy miejsce.
+static void wycofaj_grupe(const struct Grupa *g, int stolik_idx)
+{
+    pthread_mutex_lock(stoliki_mutex(szat_ctx->numer));
+    (void)stolik_usun_grupe(stolik_idx, g);
+    pthread_mutex_unlock(stoliki_mutex(szat_ctx->numer));
 }
 
-static struct Grupa kolejka_pobierz_local(void)
+void szatnia(void)
 {
-    struct Grupa g = {0};
-    QueueMsg msg;
-    for (;;)
+    /* Grupa, dla której nie ma stolika, czeka na swojej liście zamiast wracać
+     * na koniec kolejki. Szatnia śpi na futeksie zdarzeń (nowa grupa w
+     * kolejce / zwolnione miejsce z opusc_stolik()) i po każdym budzeniu
+     * usadza grupy, które się mieszczą, wg pasów (wybierz_zablokowana()) —
+     * partiami: do `partia` grup z kolejki, do `partia` usadzeń pod jednym
+     * mutexem stolików, potem żetony kolejki i liczniki hurtem. Przy kilku szatniach każda robi to
+     * samo na swojej części sali, pod swoim mutexem. */
+    int *licznik_zdarzen = &common_ctx->zdarzenia_szatni[szat_ctx->numer].licznik;
+    while (*common_ctx->restauracja_otwarta && !szat_ctx->shutdown_requested)
     {
-        if (!*common_ctx->restauracja_otwarta)
-            return g;
-
-        if (pthread_mutex_lock(&common_ctx->queue_sync->mutex) != 0)
-            continue;
-        struct timespec now, abstime;
-        clock_gettime(CLOCK_REALTIME, &now);
-        abstime = now;
-        abstime.tv_sec += 1;
-        while (common_ctx->queue_sync->count <= 0)
+        int zdarzenia = __atomic_load_n(licznik_zdarzen, __ATOMIC_ACQUIRE);
+        int nowe = pobierz_nowe_grupy();
+        int n = usadz_partie();
+        if (n > 0)
         {
-            if (!*common_ctx->restauracja_otwarta)
-            {
-                pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-                return g;
-            }
-            int rc = pthread_cond_timedwait(&common_ctx->queue_sync->not_empty,
-                                            &common_ctx->queue_sync->mutex,
-                                            &abstime);
-            if (rc == ETIMEDOUT)
+            /* Grupa opuszcza kolejkę dopiero tutaj — żeton i licznik osób
+             * w kolejce oddajemy przy usadzeniu, nie przy pobraniu na listę. */
+            int zetony[KLASY_KOLEJKI] = {0};
+            long long z_kolejki = 0;
+            for (int i = 0; i < n; i++)
             {
-                if (!*common_ctx->restauracja_otwarta ||
-                    (common_ctx->shutdown_flag_ptr &&
-                     *common_ctx->shutdown_flag_ptr))
-                {
-                    pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-                    return g;
-                }
-                clock_gettime(CLOCK_REALTIME, &now);
-                abstime = now;
-                abstime.tv_sec += 1;
-                continue;
+                zetony[szat_ctx->usadzone[i].klasa]++;
+                z_kolejki += szat_ctx->usadzone[i].grupa.osoby;
             }
-            if (rc != 0)
+            for (int klasa = 0; klasa < KLASY_KOLEJKI; klasa++)
+                if (zetony[klasa] > 0)
+                    kolejka_zwolnij_miejsca(szat_ctx->numer, klasa, zetony[klasa]);
+            statystyki_dodaj(STAT_KLIENCI_W_KOLEJCE, -z_kolejki);
+            long long osoby = 0;
+            int usadzone = 0;
+            int postarzone = 0;
+            for (int i = 0; i < n; i++)
             {
-                if (common_ctx->shutdown_flag_ptr &&
-                    *common_ctx->shutdown_flag_ptr)
+                const struct Usadzenie *u = &szat_ctx->usadzone[i];
+                /* Stolik trafia do skrzynki grupy; futex budzi tylko ją. */
+                if (skrzynka_dostarcz(u->grupa.numer_grupy, u->stolik) != 0)
                 {
-                    pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-                    exit(0);
+                    LOGD("szatnia: grupa %d zrezygnowała przed usadzeniem\n",
+                         u->grupa.numer_grupy);
+                    wycofaj_grupe(&u->grupa, u->stolik);
+                    continue;
                 }
-                continue;
+                LOGP("Grupa usadzona: %d przy stoliku: %d (%d/%d miejsc zajętych)\n",
+                     u->grupa.numer_grupy, u->numer_stolika, u->zajete, u->pojemnosc);
+                osoby += u->grupa.osoby;
+                usadzone++;
+                postarzone += u->postarzona;
             }
+            /* Zliczamy osoby (klientów), a nie grupy. */
+            statystyki_dodaj(STAT_KLIENCI_PRZYJECI, osoby);
+            statystyki_dodaj(STAT_GRUPY_USADZONE, usadzone);
+            statystyki_dodaj(STAT_SZATNIA_USADZONE + szat_ctx->numer, usadzone);
+            statystyki_dodaj(STAT_SZATNIA_PARTIE, 1);
+            if (postarzone > 0)
+                statystyki_dodaj(STAT_SZATNIA_POSTARZONE, postarzone);
         }
-
-        common_ctx->queue_sync->count--;
-        pthread_cond_signal(&common_ctx->queue_sync->not_full);
-        pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-
-        ssize_t r = msgrcv(common_ctx->msgq_id, &msg, sizeof(msg.grupa), 1,
-                           IPC_NOWAIT);
-        if (r >= 0)
-        {
-            if (pthread_mutex_lock(&common_ctx->queue_sync->mutex) == 0)
-            {
-                if (*common_ctx->klienci_w_kolejce >= msg.grupa.osoby)
-                    *common_ctx->klienci_w_kolejce -= msg.grupa.osoby;
-                else
-                    *common_ctx->klienci_w_kolejce = 0;
-                pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-            }
-            return msg.grupa;
-        }
-
-        LOGD("kolejka_pobierz: pid=%d msgrcv failed errno=%d\n", (int)getpid(),
-             errno);
-        if (errno == EINTR || errno == ENOMSG)
-        {
-            if (pthread_mutex_lock(&common_ctx->queue_sync->mutex) == 0)
-            {
-                common_ctx->queue_sync->count++;
-                pthread_cond_signal(&common_ctx->queue_sync->not_empty);
-                pthread_mutex_unlock(&common_ctx->queue_sync->mutex);
-            }
-            continue;
-        }
-
-        if (errno == EIDRM || errno == EINVAL)
-            exit(0);
-
-        return g;
+        if (nowe == 0 && n == 0)
+            (void)futex_czekaj(licznik_zdarzen, zdarzenia, POLL_MS_LONG);
     }
 }
 
 int main(int argc, char **argv)
 {
-    if (dolacz_ipc_z_argv(argc, argv, 0, NULL) != 0)
+    // Opcjonalny drugi argument: numer szatni (domyślnie 0).
+    int numer = 0;
+    if (dolacz_ipc_z_argv(argc, argv, argc > 2, &numer) != 0)
+        return 1;
+    if (numer < 0 || numer >= common_ctx->liczba_szatni)
+    {
+        LOGE("szatnia: numer %d poza zakresem 0..%d\n", numer, common_ctx->liczba_szatni - 1);
         return 1;
+    }
+    szat_ctx->numer = numer;
 
     ustaw_obsluge_sigterm(&szat_ctx->shutdown_requested);
     ustaw_shutdown_flag(&szat_ctx->shutdown_requested);
 
+    szat_ctx->partia = szatnia_partia_z_env();
+    szat_ctx->waga_vip = szatnia_waga_vip_z_env();
+    szat_ctx->starzenie_ns = szatnia_starzenie_ms_z_env() * 1000000LL;
+    szat_ctx->czekajace = calloc(KLASY_KOLEJKI * 4, sizeof(*szat_ctx->czekajace));
+    szat_ctx->usadzone = calloc((size_t)szat_ctx->partia, sizeof(*szat_ctx->usadzone));
+    if (!szat_ctx->czekajace || !szat_ctx->usadzone)
+    {
+        LOGE_ERRNO("calloc list szatni");
+        return 1;
+    }
     szatnia();
+    free(szat_ctx->usadzone);
+    free(szat_ctx->czekajace);
     return 0;
 }
@@ -0,0 +1,322 @@
+#include "tasma.h"
+
+#include "common.h"
+
+#include <string.h>
+
+_Static_assert((long long)DLUGOSC_TASMY_MAX <= 64LL * 64 * 64 * TASMA_SLOWA_L2_MAX,
+               "za mało słów na poziomie 2 mapy wolnych pozycji taśmy");
+
+// Mapa wolnych pozycji: [poziom 2][poziom 1][poziom 0: bit na pozycję],
+// listy dań specjalnych stolików i ich ogniwa (pozycja fizyczna + 1), bit
+// na pozycję ze zwykłym daniem i stoliki ze śpiącymi: [poziom 1][bit na
+// stolik].
+struct TasmaCtx
+{
+    uint64_t *l2;
+    uint64_t *l1;
+    uint64_t *l0;
+    struct SpecjalneStolika *specjalne;
+    int *nastepny;
+    uint64_t *zwykle;
+    uint64_t *czekajace_l1;
+    uint64_t *czekajace;
+};
+
+static struct TasmaCtx tasma_ctx_storage = {0};
+static struct TasmaCtx *tasma_ctx = &tasma_ctx_storage;
+
+// Bity 0..b słowa.
+static uint64_t maska_do(int b) { return ~0ULL >> (63 - b); }
+
+static int najwyzszy_bit(uint64_t slowo) { return 63 - __builtin_clzll(slowo); }
+
+static void ustaw_wolna(int f)
+{
+    size_t s0 = (size_t)f / 64;
+    if (tasma_ctx->l0[s0] == 0)
+    {
+        size_t s1 = s0 / 64;
+        if (tasma_ctx->l1[s1] == 0)
+            tasma_ctx->l2[s1 / 64] |= 1ULL << (s1 % 64);
+        tasma_ctx->l1[s1] |= 1ULL << (s0 % 64);
+    }
+    tasma_ctx->l0[s0] |= 1ULL << (f % 64);
+}
+
+static void ustaw_zajeta(int f)
+{
+    size_t s0 = (size_t)f / 64;
+    tasma_ctx->l0[s0] &= ~(1ULL << (f % 64));
+    if (tasma_ctx->l0[s0] == 0)
+    {
+        size_t s1 = s0 / 64;
+        tasma_ctx->l1[s1] &= ~(1ULL << (s0 % 64));
+        if (tasma_ctx->l1[s1] == 0)
+            tasma_ctx->l2[s1 / 64] &= ~(1ULL << (s1 % 64));
+    }
+}
+
+// Najwyższa wolna pozycja fizyczna <= `f` albo -1: reszta słowa na
+// poziomie 0, reszta słowa na poziomie 1, potem poziom 2 w dół.
+static int najwyzsza_wolna_do(int f)
+{
+    if (f < 0)
+        return -1;
+    size_t s0 = (size_t)f / 64;
+    uint64_t slowo = tasma_ctx->l0[s0] & maska_do(f % 64);
+    if (slowo)
+        return (int)(s0 * 64) + najwyzszy_bit(slowo);
+    if (s0 == 0)
+        return -1;
+
+    s0--;
+    size_t s1 = s0 / 64;
+    slowo = tasma_ctx->l1[s1] & maska_do((int)(s0 % 64));
+    for (;;)
+    {
+        if (slowo)
+        {
+            s0 = s1 * 64 + (size_t)najwyzszy_bit(slowo);
+            return (int)(s0 * 64) + najwyzszy_bit(tasma_ctx->l0[s0]);
+        }
+        if (s1 == 0)
+            return -1;
+        // Najwyższe niepuste słowo poziomu 1 poniżej s1.
+        s1--;
+        size_t s2 = s1 / 64;
+        uint64_t l2 = tasma_ctx->l2[s2] & maska_do((int)(s1 % 64));
+        while (!l2 && s2 > 0)
+            l2 = tasma_ctx->l2[--s2];
+        if (!l2)
+            return -1;
+        s1 = s2 * 64 + (size_t)najwyzszy_bit(l2);
+        slowo = tasma_ctx->l1[s1];
+    }
+}
+
+// Pozycja fizyczna pozycji logicznej `p`.
+static int fizyczna(int p)
+{
+    int f = common_ctx->tasma_sync->glowa + p;
+    return f >= common_ctx->dlugosc_tasmy ? f - common_ctx->dlugosc_tasmy : f;
+}
+
+static void ustaw_czekajacy(int stolik)
+{
+    size_t s0 = (size_t)stolik / 64;
+    if (tasma_ctx->czekajace[s0] == 0)
+        tasma_ctx->czekajace_l1[s0 / 64] |= 1ULL << (s0 % 64);
+    tasma_ctx->czekajace[s0] |= 1ULL << (stolik % 64);
+}
+
+static void wyczysc_czekajacy(int stolik)
+{
+    size_t s0 = (size_t)stolik / 64;
+    tasma_ctx->czekajace[s0] &= ~(1ULL << (stolik % 64));
+    if (tasma_ctx->czekajace[s0] == 0)
+        tasma_ctx->czekajace_l1[s0 / 64] &= ~(1ULL << (s0 % 64));
+}
+
+// Bity zwykłych dań z pozycji fizycznych f..f + ile - 1 (ile 1..64,
+// f + ile <= dlugosc_tasmy), najniższy bit to `f`.
+static uint64_t zwykle_od(int f, int ile)
+{
+    size_t s0 = (size_t)f / 64;
+    int b = f % 64;
+    uint64_t slowo = tasma_ctx->zwykle[s0] >> b;
+    if (b + ile > 64)
+        slowo |= tasma_ctx->zwykle[s0 + 1] << (64 - b);
+    return ile == 64 ? slowo : slowo & ((1ULL << ile) - 1);
+}
+
+// Jak zwykle_od(), ale od pozycji logicznej `p`, z zawinięciem pierścienia.
+static uint64_t zwykle_przed(int p, int ile)
+{
+    int f = fizyczna(p);
+    int do_konca = common_ctx->dlugosc_tasmy - f;
+    if (ile <= do_konca)
+        return zwykle_od(f, ile);
+    return zwykle_od(f, do_konca) | zwykle_od(0, ile - do_konca) << do_konca;
+}
+
+// Bit stolika zostaje, póki ktoś przy nim śpi; zerujemy go dopiero, gdy
+// przy próbie budzenia nie ma już nikogo (czekający nie biorą mutexa, gdy
+// zmniejszają licznik).
+static void obudz_czekajacych(int stolik)
+{
+    if (__atomic_load_n(&common_ctx->budziki[stolik].czekajacy, __ATOMIC_RELAXED) == 0)
+    {
+        wyczysc_czekajacy(stolik);
+        return;
+    }
+    tasma_obudz_stolik(stolik, 1);
+}
+
+// Lista stolika, do którego jedzie danie z pozycji `f`, albo NULL dla
+// dania zwykłego (i numeru stolika spoza sali).
+static struct SpecjalneStolika *lista_specjalnych(int f)
+{
+    int s = common_ctx->tasma[f].stolik_specjalny;
+    if (s < 1 || s > common_ctx->liczba_stolikow)
+        return NULL;
+    return &tasma_ctx->specjalne[s - 1];
+}
+
+static void dopisz_specjalne(int f)
+{
+    struct SpecjalneStolika *l = lista_specjalnych(f);
+    if (!l)
+        return;
+    tasma_ctx->nastepny[f] = l->pierwsza;
+    l->pierwsza = f + 1;
+    l->liczba++;
+}
+
+// Zwykle zdejmowane jest pierwsze danie listy; inaczej lista stolika jest
+// krótka (najwyżej po daniu na zamówienie grupy).
+static void wypisz_specjalne(int f)
+{
+    struct SpecjalneStolika *l = lista_specjalnych(f);
+    if (!l)
+        return;
+    int *ogniwo = &l->pierwsza;
+    while (*ogniwo != 0 && *ogniwo != f + 1)
+        ogniwo = &tasma_ctx->nastepny[*ogniwo - 1];
+    if (*ogniwo == 0)
+        return;
+    *ogniwo = tasma_ctx->nastepny[f];
+    tasma_ctx->nastepny[f] = 0;
+    l->liczba--;
+}
+
+void tasma_przypisz(uint64_t *wolne, struct SpecjalneStolika *specjalne, int *nastepny,
+                    uint64_t *zwykle, uint64_t *czekajace)
+{
+    size_t w0 = ((size_t)common_ctx->dlugosc_tasmy + 63) / 64;
+    size_t w1 = (w0 + 63) / 64;
+    tasma_ctx->l2 = wolne;
+    tasma_ctx->l1 = wolne + (w1 + 63) / 64;
+    tasma_ctx->l0 = tasma_ctx->l1 + w1;
+    tasma_ctx->specjalne = specjalne;
+    tasma_ctx->nastepny = nastepny;
+    tasma_ctx->zwykle = zwykle;
+    size_t c0 = ((size_t)common_ctx->liczba_stolikow + 63) / 64;
+    tasma_ctx->czekajace_l1 = czekajace;
+    tasma_ctx->czekajace = czekajace + (c0 + 63) / 64;
+}
+
+void tasma_odbuduj(void)
+{
+    size_t slowa = tasma_wolne_slowa(common_ctx->dlugosc_tasmy);
+    for (size_t i = 0; i < slowa; i++)
+        tasma_ctx->l2[i] = 0;
+    memset(tasma_ctx->zwykle, 0, tasma_zwykle_rozmiar(common_ctx->dlugosc_tasmy));
+    memset(tasma_ctx->czekajace_l1, 0, tasma_czekajace_rozmiar(common_ctx->liczba_stolikow));
+    for (int s = 0; s < common_ctx->liczba_stolikow; s++)
+        tasma_ctx->specjalne[s] = (struct SpecjalneStolika){0, 0};
+    int zajete = 0;
+    for (int f = 0; f < common_ctx->dlugosc_tasmy; f++)
+    {
+        tasma_ctx->nastepny[f] = 0;
+        if (common_ctx->tasma[f].cena != 0)
+        {
+            zajete++;
+            dopisz_specjalne(f);
+            if (common_ctx->tasma[f].stolik_specjalny == 0)
+                tasma_ctx->zwykle[f / 64] |= 1ULL << (f % 64);
+        }
+        else
+            ustaw_wolna(f);
+    }
+    common_ctx->tasma_sync->count = zajete;
+}
+
+struct Talerzyk *tasma_pozycja(int p)
+{
+    return &common_ctx->tasma[fizyczna(p)];
+}
+
+void tasma_poloz(int cena, int stolik_specjalny)
+{
+    // Najwyższa wolna pozycja logiczna: fizycznie od glowa - 1 w dół, potem
+    // od końca tablicy do głowy. Staje się pozycją 0.
+    int glowa = common_ctx->tasma_sync->glowa;
+    int f = najwyzsza_wolna_do(glowa - 1);
+    if (f < 0)
+        f = najwyzsza_wolna_do(common_ctx->dlugosc_tasmy - 1);
+    if (f < 0)
+        return;
+    common_ctx->tasma_sync->glowa = f;
+    common_ctx->tasma[f].cena = cena;
+    common_ctx->tasma[f].stolik_specjalny = stolik_specjalny;
+    ustaw_zajeta(f);
+    dopisz_specjalne(f);
+    if (stolik_specjalny == 0)
+        tasma_ctx->zwykle[f / 64] |= 1ULL << (f % 64);
+    common_ctx->tasma_sync->count++;
+}
+
+void tasma_zdejmij(int p)
+{
+    int f = fizyczna(p);
+    if (common_ctx->tasma[f].cena == 0)
+        return;
+    wypisz_specjalne(f);
+    tasma_ctx->zwykle[f / 64] &= ~(1ULL << (f % 64));
+    common_ctx->tasma[f].cena = 0;
+    common_ctx->tasma[f].stolik_specjalny = 0;
+    ustaw_wolna(f);
+    if (common_ctx->tasma_sync->count > 0)
+        common_ctx->tasma_sync->count--;
+}
+
+int tasma_specjalne_stolika(int stolik)
+{
+    int f = tasma_ctx->specjalne[stolik].pierwsza - 1;
+    if (f < 0)
+        return -1;
+    int p = f - common_ctx->tasma_sync->glowa;
+    return p < 0 ? p + common_ctx->dlugosc_tasmy : p;
+}
+
+int tasma_specjalne_liczba(int stolik) { return tasma_ctx->specjalne[stolik].liczba; }
+
+void tasma_zapisz_czekajacego(int stolik)
+{
+    __atomic_add_fetch(&common_ctx->budziki[stolik].czekajacy, 1, __ATOMIC_RELAXED);
+    ustaw_czekajacy(stolik);
+}
+
+void tasma_powiadom_stoliki(int stolik_specjalny)
+{
+    // Danie specjalne widzi tylko jego stolik, gdziekolwiek leży. Śpiący
+    // przy innych stolikach sprawdzili swoje listy, zanim zasnęli.
+    int n = common_ctx->liczba_stolikow;
+    if (stolik_specjalny > 0 && stolik_specjalny <= n)
+        obudz_czekajacych(stolik_specjalny - 1);
+
+    // Zwykłe dania: tylko stoliki z pozycją na taśmie, słowo po słowie wśród
+    // niepustych słów mapy śpiących.
+    int z_pozycja = n < common_ctx->dlugosc_tasmy ? n : common_ctx->dlugosc_tasmy;
+    size_t slowa = ((size_t)z_pozycja + 63) / 64;
+    for (size_t s1 = 0; s1 * 64 < slowa; s1++)
+    {
+        uint64_t niepuste = tasma_ctx->czekajace_l1[s1];
+        while (niepuste)
+        {
+            size_t s0 = s1 * 64 + (size_t)__builtin_ctzll(niepuste);
+            niepuste &= niepuste - 1;
+            if (s0 >= slowa)
+                break;
+            int p = (int)(s0 * 64);
+            int ile = z_pozycja - p < 64 ? z_pozycja - p : 64;
+            uint64_t do_obudzenia = tasma_ctx->czekajace[s0] & zwykle_przed(p, ile);
+            while (do_obudzenia)
+            {
+                obudz_czekajacych(p + __builtin_ctzll(do_obudzenia));
+                do_obudzenia &= do_obudzenia - 1;
+            }
+        }
+    }
+}
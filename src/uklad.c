@@ -0,0 +1,250 @@
+#include "uklad.h"
+
+#include "common.h"
+#include "histogram.h"
+#include "kolejka.h"
+#include "semafor.h"
+#include "statystyki.h"
+#include "tasma.h"
+#include "wolne_miejsca.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Struktury, które same układają pola na liniach cache, muszą mieć
+// wyrównanie nie większe niż linia — inaczej przesunięcia regionów nie
+// wystarczą.
+_Static_assert(_Alignof(struct KolejkaGrup) <= UKLAD_LINIA, "KolejkaGrup: wyrównanie > linii");
+_Static_assert(_Alignof(struct TasmaSync) <= UKLAD_LINIA, "TasmaSync: wyrównanie > linii");
+_Static_assert(_Alignof(struct BudzikStolika) <= UKLAD_LINIA, "BudzikStolika: wyrównanie > linii");
+_Static_assert(_Alignof(struct BudzeniaKorutyn) <= UKLAD_LINIA, "BudzeniaKorutyn: wyrównanie > linii");
+_Static_assert(sizeof(struct NaglowekShm) <= 4096, "nagłówek shm za duży");
+_Static_assert(sizeof(((struct WymiaryLokalu *)0)->granice_szatni) ==
+                   sizeof(int32_t) * (SZATNIE_MAX + 1),
+               "granice_szatni: SZATNIE_MAX + 1 wpisów");
+
+static const char *const NAZWY_REGIONOW[REGION_LICZBA] = {
+    [REGION_NAGLOWEK] = "naglowek",
+    [REGION_STOLIKI] = "stoliki",
+    [REGION_GRUPY_PRZY_STOLIKACH] = "grupy_przy_stolikach",
+    [REGION_WOLNE_MIEJSCA] = "wolne_miejsca",
+    [REGION_TASMA] = "tasma",
+    [REGION_TASMA_WOLNE] = "tasma_wolne",
+    [REGION_TASMA_SPECJALNE] = "specjalne_stolikow",
+    [REGION_TASMA_NASTEPNY] = "tasma_nastepny_specjalny",
+    [REGION_TASMA_ZWYKLE] = "tasma_zwykle",
+    [REGION_OTWARTA] = "restauracja_otwarta",
+    [REGION_GRUPY_W_LOKALU] = "grupy_w_lokalu",
+    [REGION_ZDARZENIA_SZATNI] = "zdarzenia_szatni",
+    [REGION_PIDY] = "pidy",
+    [REGION_STOLIKI_SYNC] = "stoliki_sync",
+    [REGION_TASMA_SYNC] = "tasma_sync",
+    [REGION_BUDZIKI] = "budziki_stolikow",
+    [REGION_STOLIKI_CZEKAJACE] = "stoliki_czekajace",
+    [REGION_SEMAFORY] = "semafory",
+    [REGION_STATYSTYKI] = "statystyki",
+    [REGION_PULA] = "pula",
+    [REGION_KOLEJKA] = "kolejka",
+    [REGION_HISTOGRAM] = "opoznienie_usadzenia",
+    [REGION_HISTOGRAM_DANIA] = "oczekiwanie_na_danie",
+    [REGION_HISTOGRAM_WG_OSOB] = "usadzenie_wg_osob",
+    [REGION_HISTOGRAM_WG_KLASY] = "usadzenie_wg_klasy",
+    [REGION_SKRZYNKI] = "skrzynki_przydzialu",
+    [REGION_BUDZENIA_KORUTYN] = "budzenia_korutyn",
+    [REGION_PRZYBYCIA] = "przybycia_ns",
+};
+
+// Parsuje "a,b,c,d" do `stoliki`; 0 przy sukcesie.
+static int parsuj_stoliki(const char *s, int32_t stoliki[4])
+{
+    for (int i = 0; i < 4; i++)
+    {
+        errno = 0;
+        char *end = NULL;
+        long v = strtol(s, &end, 10);
+        if (errno != 0 || end == s || v < 0 || v > STOLIKI_MAX)
+            return -1;
+        stoliki[i] = (int32_t)v;
+        if (i < 3 && *end != ',')
+            return -1;
+        s = end + 1;
+    }
+    return (s[-1] == '\0') ? 0 : -1;
+}
+
+static int32_t wymiar_z_env(const char *nazwa, int32_t domyslna, long max)
+{
+    const char *s = getenv(nazwa);
+    if (!s || !*s)
+        return domyslna;
+    errno = 0;
+    char *end = NULL;
+    long v = strtol(s, &end, 10);
+    if (errno == 0 && end != s && *end == '\0' && v >= 1 && v <= max)
+        return (int32_t)v;
+    LOGE("Nieprawidłowe %s=%s (1..%ld), używam %d\n", nazwa, s, max, (int)domyslna);
+    return domyslna;
+}
+
+void uklad_wymiary_z_env(struct WymiaryLokalu *w)
+{
+    const int32_t domyslne[4] = {X1, X2, X3, X4};
+    const char *s = getenv("RESTAURACJA_STOLIKI");
+    if (!s || !*s || parsuj_stoliki(s, w->stoliki) != 0)
+    {
+        if (s && *s)
+            LOGE("Nieprawidłowe RESTAURACJA_STOLIKI=%s (\"a,b,c,d\", 0..%d), "
+                 "używam %d,%d,%d,%d\n",
+                 s, STOLIKI_MAX, X1, X2, X3, X4);
+        for (int i = 0; i < 4; i++)
+            w->stoliki[i] = domyslne[i];
+    }
+    w->liczba_stolikow = w->stoliki[0] + w->stoliki[1] + w->stoliki[2] + w->stoliki[3];
+    if (w->liczba_stolikow == 0)
+    {
+        LOGE("RESTAURACJA_STOLIKI bez żadnego stolika, używam %d,%d,%d,%d\n",
+             X1, X2, X3, X4);
+        for (int i = 0; i < 4; i++)
+            w->stoliki[i] = domyslne[i];
+        w->liczba_stolikow = X1 + X2 + X3 + X4;
+    }
+    // Zwykły talerz trafia do stolika o numerze swojej pozycji, więc domyślna
+    // taśma sięga co najmniej do ostatniego stolika.
+    int32_t tasma = w->liczba_stolikow > DLUGOSC_TASMY_DEFAULT ? w->liczba_stolikow
+                                                                : DLUGOSC_TASMY_DEFAULT;
+    w->dlugosc_tasmy = wymiar_z_env("RESTAURACJA_TASMA", tasma, DLUGOSC_TASMY_MAX);
+    w->grup_na_stoliku = wymiar_z_env("RESTAURACJA_GRUP_NA_STOLIKU",
+                                      GRUP_NA_STOLIKU_DEFAULT, GRUP_NA_STOLIKU_MAX);
+    w->szatnie = wymiar_z_env("RESTAURACJA_SZATNIE", 1, SZATNIE_MAX);
+    for (int s = 0; s <= SZATNIE_MAX; s++)
+    {
+        w->granice_szatni[s] = 0;
+        for (int c = 1; c <= 4; c++)
+            if ((c - 1) * w->szatnie / 4 < s)
+                w->granice_szatni[s] += w->stoliki[c - 1];
+    }
+}
+
+static size_t rozmiar_regionu(enum RegionShm r, int liczba_grup,
+                              const struct WymiaryLokalu *w)
+{
+    switch (r)
+    {
+    case REGION_NAGLOWEK:
+        return sizeof(struct NaglowekShm);
+    case REGION_STOLIKI:
+        return sizeof(struct Stolik) * (size_t)w->liczba_stolikow;
+    case REGION_GRUPY_PRZY_STOLIKACH:
+        return sizeof(struct Grupa) * (size_t)w->liczba_stolikow * (size_t)w->grup_na_stoliku;
+    case REGION_WOLNE_MIEJSCA:
+        return wolne_miejsca_rozmiar(w->szatnie, w->granice_szatni);
+    case REGION_TASMA:
+        return sizeof(struct Talerzyk) * (size_t)w->dlugosc_tasmy;
+    case REGION_TASMA_WOLNE:
+        return tasma_wolne_rozmiar(w->dlugosc_tasmy);
+    case REGION_TASMA_SPECJALNE:
+        return sizeof(struct SpecjalneStolika) * (size_t)w->liczba_stolikow;
+    case REGION_TASMA_NASTEPNY:
+        return sizeof(int) * (size_t)w->dlugosc_tasmy;
+    case REGION_TASMA_ZWYKLE:
+        return tasma_zwykle_rozmiar(w->dlugosc_tasmy);
+    case REGION_BUDZIKI:
+        return sizeof(struct BudzikStolika) * (size_t)w->liczba_stolikow;
+    case REGION_STOLIKI_CZEKAJACE:
+        return tasma_czekajace_rozmiar(w->liczba_stolikow);
+    case REGION_SEMAFORY:
+        return sizeof(struct SemaforShm) * SEM_LICZBA;
+    case REGION_PIDY:
+        return sizeof(pid_t) * 2;
+    case REGION_STOLIKI_SYNC:
+        return sizeof(struct StolikiSync) * (size_t)w->szatnie;
+    case REGION_ZDARZENIA_SZATNI:
+        return sizeof(struct ZdarzeniaSzatni) * (size_t)w->szatnie;
+    case REGION_TASMA_SYNC:
+        return sizeof(struct TasmaSync);
+    case REGION_STATYSTYKI:
+        return sizeof(struct Statystyki);
+    case REGION_PULA:
+        return sizeof(struct PulaKlientow);
+    case REGION_KOLEJKA:
+        return sizeof(struct KolejkaGrup) * (size_t)w->szatnie * KLASY_KOLEJKI;
+    case REGION_HISTOGRAM:
+    case REGION_HISTOGRAM_DANIA:
+        return sizeof(struct Histogram);
+    case REGION_HISTOGRAM_WG_OSOB:
+        return sizeof(struct Histogram) * 4;
+    case REGION_HISTOGRAM_WG_KLASY:
+        return sizeof(struct Histogram) * KLASY_KOLEJKI;
+    case REGION_SKRZYNKI:
+        return sizeof(int) * (size_t)((liczba_grup > 0 ? liczba_grup : 0) + 1);
+    case REGION_BUDZENIA_KORUTYN:
+        return sizeof(struct BudzeniaKorutyn);
+    case REGION_PRZYBYCIA:
+        return sizeof(long long) * (size_t)((liczba_grup > 0 ? liczba_grup : 0) + 1);
+    default:
+        return sizeof(int); // pojedyncze liczniki i słowa futeksa
+    }
+}
+
+static size_t do_linii(size_t n)
+{
+    return (n + UKLAD_LINIA - 1) & ~(size_t)(UKLAD_LINIA - 1);
+}
+
+size_t uklad_oblicz(struct NaglowekShm *n, int liczba_grup, const struct WymiaryLokalu *w)
+{
+    size_t off = 0;
+    n->magia = UKLAD_MAGIA;
+    n->wersja = UKLAD_WERSJA;
+    n->liczba_regionow = REGION_LICZBA;
+    n->wymiary = *w;
+    for (int r = 0; r < REGION_LICZBA; r++)
+    {
+        size_t rozmiar = rozmiar_regionu((enum RegionShm)r, liczba_grup, w);
+        n->regiony[r].przesuniecie = (uint32_t)off;
+        n->regiony[r].rozmiar = (uint32_t)rozmiar;
+        off += do_linii(rozmiar);
+        if (off > UINT32_MAX)
+            return 0;
+    }
+    n->rozmiar_calkowity = (uint32_t)off;
+    return off;
+}
+
+int uklad_sprawdz(const struct NaglowekShm *n)
+{
+    if (n->magia != UKLAD_MAGIA || n->wersja != UKLAD_WERSJA ||
+        n->liczba_regionow != REGION_LICZBA)
+        return -1;
+    const struct WymiaryLokalu *w = &n->wymiary;
+    if (w->liczba_stolikow < 1 || w->dlugosc_tasmy < 1 || w->grup_na_stoliku < 1 ||
+        w->stoliki[0] + w->stoliki[1] + w->stoliki[2] + w->stoliki[3] != w->liczba_stolikow ||
+        w->szatnie < 1 || w->szatnie > SZATNIE_MAX || w->granice_szatni[0] != 0 ||
+        w->granice_szatni[w->szatnie] != w->liczba_stolikow)
+        return -1;
+    for (int s = 0; s < w->szatnie; s++)
+        if (w->granice_szatni[s] > w->granice_szatni[s + 1])
+            return -1;
+    for (int r = 0; r < REGION_LICZBA; r++)
+    {
+        const struct RegionOpis *o = &n->regiony[r];
+        if (o->przesuniecie % UKLAD_LINIA != 0 ||
+            (uint64_t)o->przesuniecie + o->rozmiar > n->rozmiar_calkowity)
+            return -1;
+    }
+    return 0;
+}
+
+void *uklad_region(void *baza, enum RegionShm r)
+{
+    const struct NaglowekShm *n = (const struct NaglowekShm *)baza;
+    return (char *)baza + n->regiony[r].przesuniecie;
+}
+
+const char *uklad_nazwa_regionu(enum RegionShm r)
+{
+    if (r < 0 || r >= REGION_LICZBA)
+        return "?";
+    return NAZWY_REGIONOW[r];
+}
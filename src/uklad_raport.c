@@ -0,0 +1,53 @@
+#include "uklad.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Raport układu segmentu współdzielonego (`make uklad`): przesunięcie,
+// rozmiar i linie cache każdego regionu. Kończy się kodem 1, gdy dwa
+// regiony dzielą linię albo region nie zaczyna się na jej granicy.
+int main(int argc, char **argv)
+{
+    int liczba_grup = (argc > 1) ? atoi(argv[1]) : 1000;
+    struct WymiaryLokalu w;
+    uklad_wymiary_z_env(&w);
+    struct NaglowekShm n;
+    size_t rozmiar = uklad_oblicz(&n, liczba_grup, &w);
+    if (rozmiar == 0)
+    {
+        printf("Segment przekracza 4 GiB\nBŁĄD układu\n");
+        return 1;
+    }
+
+    printf("Układ shm: magia %#x, wersja %u, %d regionów, %zu B dla %d grup\n",
+           n.magia, n.wersja, REGION_LICZBA, rozmiar, liczba_grup);
+    printf("Sala: %d stolików (%d/%d/%d/%d), taśma %d, grup na stolik %d, szatnie %d\n",
+           w.liczba_stolikow, w.stoliki[0], w.stoliki[1], w.stoliki[2], w.stoliki[3],
+           w.dlugosc_tasmy, w.grup_na_stoliku, w.szatnie);
+    printf("%-22s %10s %10s %6s %8s\n", "region", "przes.", "rozmiar",
+           "linie", "dopełn.");
+
+    int bledy = 0;
+    size_t poprzedni_koniec = 0;
+    for (int r = 0; r < REGION_LICZBA; r++)
+    {
+        const struct RegionOpis *o = &n.regiony[r];
+        size_t linie = (o->rozmiar + UKLAD_LINIA - 1) / UKLAD_LINIA;
+        size_t dopelnienie = linie * UKLAD_LINIA - o->rozmiar;
+        printf("%-22s %10u %10u %6zu %8zu\n",
+               uklad_nazwa_regionu((enum RegionShm)r), o->przesuniecie,
+               o->rozmiar, linie, dopelnienie);
+        if (o->przesuniecie % UKLAD_LINIA != 0 || o->przesuniecie < poprzedni_koniec)
+        {
+            printf("  ! %s dzieli linię z poprzednim regionem\n",
+                   uklad_nazwa_regionu((enum RegionShm)r));
+            bledy++;
+        }
+        poprzedni_koniec = o->przesuniecie + o->rozmiar;
+    }
+    if (uklad_sprawdz(&n) != 0)
+        bledy++;
+
+    printf("%s\n", bledy ? "BŁĄD układu" : "OK");
+    return bledy ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+#define _GNU_SOURCE
+#include "uruchamianie.h"
+
+#include "common.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+#define MA_ADDCLOSEFROM_NP 1
+#endif
+
+extern char **environ;
+
+static struct UruchamianieStat uruch_stat_storage = {.metoda = URUCHAMIANIE_POSIX_SPAWN};
+static struct UruchamianieStat *uruch_stat = &uruch_stat_storage;
+static int fd_przekazany = -1;
+
+static long long teraz_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+const char *uruchamianie_nazwa_metody(enum MetodaUruchamiania m)
+{
+    switch (m)
+    {
+    case URUCHAMIANIE_VFORK:
+        return "vfork";
+    case URUCHAMIANIE_FORK:
+        return "fork";
+    default:
+        return "posix_spawn";
+    }
+}
+
+/* Pierwszy FD zamykany w dziecku: przekazany deskryptor zajmuje 3. */
+static int pierwszy_zamykany_fd(void)
+{
+    return fd_przekazany >= 0 ? URUCHAMIANIE_FD_PRZEKAZANY + 1 : 3;
+}
+
+/* Zamyka FD >= `od` w dziecku. close_range() to jedno wywołanie zamiast
+ * miliona przy dużym `ulimit -n`; pętla zostaje jako awaryjna ścieżka dla
+ * starszych jąder (ENOSYS). */
+static void zamknij_odziedziczone_fd(int od)
+{
+    if (close_range((unsigned)od, ~0U, 0) == 0)
+        return;
+
+    long max_fd = sysconf(_SC_OPEN_MAX);
+    if (max_fd <= 0)
+        max_fd = 1024;
+    for (int fd = od; fd < (int)max_fd; fd++)
+        (void)close(fd);
+}
+
+void uruchamianie_inicjuj(void)
+{
+    const char *s = getenv("RESTAURACJA_SPAWN");
+    if (s && strcmp(s, "vfork") == 0)
+        uruch_stat->metoda = URUCHAMIANIE_VFORK;
+    else if (s && strcmp(s, "fork") == 0)
+        uruch_stat->metoda = URUCHAMIANIE_FORK;
+    else
+    {
+        if (s && *s && strcmp(s, "posix_spawn") != 0)
+            LOGE("Nieznany RESTAURACJA_SPAWN=%s, używam posix_spawn\n", s);
+        uruch_stat->metoda = URUCHAMIANIE_POSIX_SPAWN;
+    }
+
+    // Wszystko, co rodzic ma już otwarte, ma nie przeciekać do potomków.
+    // Nowe FD rodzica otwieramy z O_CLOEXEC.
+    (void)close_range(3, ~0U, CLOSE_RANGE_CLOEXEC);
+}
+
+void uruchamianie_przekaz_fd(int fd) { fd_przekazany = fd; }
+
+static pid_t spawn_posix(const char *plik, char *const argv[], pid_t pgid,
+                         int fd_stdin)
+{
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t fa;
+    sigset_t pusty;
+    short flagi = POSIX_SPAWN_SETSIGMASK;
+
+    if (posix_spawnattr_init(&attr) != 0)
+        return -1;
+    if (posix_spawn_file_actions_init(&fa) != 0)
+    {
+        posix_spawnattr_destroy(&attr);
+        return -1;
+    }
+
+    // Dziecko startuje z pustą maską sygnałów, niezależnie od wątku rodzica.
+    sigemptyset(&pusty);
+    (void)posix_spawnattr_setsigmask(&attr, &pusty);
+    if (pgid >= 0)
+    {
+        flagi |= POSIX_SPAWN_SETPGROUP;
+        (void)posix_spawnattr_setpgroup(&attr, pgid);
+    }
+    (void)posix_spawnattr_setflags(&attr, flagi);
+    if (fd_stdin >= 0)
+        (void)posix_spawn_file_actions_adddup2(&fa, fd_stdin, STDIN_FILENO);
+    // dup2 zdejmuje O_CLOEXEC z kopii, więc przeżywa exec.
+    if (fd_przekazany >= 0)
+        (void)posix_spawn_file_actions_adddup2(&fa, fd_przekazany,
+                                               URUCHAMIANIE_FD_PRZEKAZANY);
+#ifdef MA_ADDCLOSEFROM_NP
+    (void)posix_spawn_file_actions_addclosefrom_np(&fa, pierwszy_zamykany_fd());
+#endif
+
+    pid_t pid = -1;
+    int rc = posix_spawn(&pid, plik, &fa, &attr, argv, environ);
+
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    if (rc != 0)
+    {
+        errno = rc;
+        return -1;
+    }
+    return pid;
+}
+
+static pid_t spawn_fork(const char *plik, char *const argv[], pid_t pgid,
+                        int fd_stdin, int uzyj_vfork)
+{
+    // Jak posix_spawn w glibc: sygnały zablokowane od vfork() do resetu
+    // obsługi w dziecku. Inaczej SIGTSTP z terminala albo SIGTERM do grupy
+    // wykonałby w dziecku obsługę rodzica, a ta po vfork() pisze w jego
+    // pamięci (i w segmencie).
+    sigset_t wszystkie, poprzednia;
+    sigfillset(&wszystkie);
+    (void)pthread_sigmask(SIG_SETMASK, &wszystkie, &poprzednia);
+    pid_t pid = uzyj_vfork ? vfork() : fork();
+    if (pid == 0)
+    {
+        // Po vfork() dozwolone są tylko wywołania systemowe i exec/_exit.
+        struct sigaction sa;
+        for (int s = 1; s < NSIG; s++)
+        {
+            if (sigaction(s, NULL, &sa) != 0 || sa.sa_handler == SIG_DFL ||
+                sa.sa_handler == SIG_IGN)
+                continue;
+            sa.sa_handler = SIG_DFL;
+            sa.sa_flags = 0;
+            sigemptyset(&sa.sa_mask);
+            (void)sigaction(s, &sa, NULL);
+        }
+        sigset_t pusty;
+        sigemptyset(&pusty);
+        (void)sigprocmask(SIG_SETMASK, &pusty, NULL);
+        if (pgid >= 0)
+            (void)setpgid(0, pgid);
+        if (fd_stdin >= 0 && dup2(fd_stdin, STDIN_FILENO) < 0)
+            _exit(127);
+        if (fd_przekazany >= 0 && dup2(fd_przekazany, URUCHAMIANIE_FD_PRZEKAZANY) < 0)
+            _exit(127);
+        zamknij_odziedziczone_fd(pierwszy_zamykany_fd());
+        execv(plik, argv);
+        _exit(127);
+    }
+    int e = errno;
+    (void)pthread_sigmask(SIG_SETMASK, &poprzednia, NULL);
+    errno = e;
+    return pid;
+}
+
+pid_t uruchamianie_spawn(const char *plik, char *const argv[], pid_t pgid)
+{
+    return uruchamianie_spawn_stdin(plik, argv, pgid, -1);
+}
+
+pid_t uruchamianie_spawn_stdin(const char *plik, char *const argv[], pid_t pgid,
+                               int fd_stdin)
+{
+    long long start = teraz_ns();
+    pid_t pid;
+    switch (uruch_stat->metoda)
+    {
+    case URUCHAMIANIE_VFORK:
+        pid = spawn_fork(plik, argv, pgid, fd_stdin, 1);
+        break;
+    case URUCHAMIANIE_FORK:
+        pid = spawn_fork(plik, argv, pgid, fd_stdin, 0);
+        break;
+    default:
+        pid = spawn_posix(plik, argv, pgid, fd_stdin);
+        break;
+    }
+    long long koniec = teraz_ns();
+
+    if (pid < 0)
+    {
+        int e = errno;
+        __atomic_add_fetch(&uruch_stat->bledy, 1, __ATOMIC_RELAXED);
+        errno = e;
+        return -1;
+    }
+
+    histogram_dodaj(&uruch_stat->opoznienie, (unsigned long long)(koniec - start));
+    __atomic_add_fetch(&uruch_stat->uruchomione, 1, __ATOMIC_RELAXED);
+    long long zero = 0;
+    (void)__atomic_compare_exchange_n(&uruch_stat->pierwszy_ns, &zero, start, 0,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    long long ostatni = __atomic_load_n(&uruch_stat->ostatni_ns, __ATOMIC_RELAXED);
+    while (koniec > ostatni &&
+           !__atomic_compare_exchange_n(&uruch_stat->ostatni_ns, &ostatni, koniec,
+                                        0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    return pid;
+}
+
+const struct UruchamianieStat *uruchamianie_statystyki(void) { return uruch_stat; }
@@ -0,0 +1,208 @@
+#include "wolne_miejsca.h"
+
+#include "common.h"
+
+_Static_assert(4 * (long long)STOLIKI_MAX <= 64LL * 64 * 64 * WOLNE_MIEJSCA_SLOWA_L2_MAX,
+               "za mało słów na poziomie 2 map bitowych");
+
+// Część sali jednej szatni; numery stolików w mapach liczone od `od`.
+struct CzescIndeksu
+{
+    uint64_t *pamiec;
+    int od;
+    int liczba_stolikow;
+    size_t slowa_l2;
+    size_t slowa_l1;
+    size_t slowa_kubelka;
+};
+
+struct WolneMiejscaCtx
+{
+    struct CzescIndeksu czesci[SZATNIE_MAX];
+    int liczba_czesci;
+};
+
+static struct WolneMiejscaCtx wm_storage = {0};
+static struct WolneMiejscaCtx *wm = &wm_storage;
+
+// Kubełek f (1..4): [poziom 2][poziom 1][poziom 0: bit na stolik].
+static uint64_t *poziom2(const struct CzescIndeksu *c, int f)
+{
+    return c->pamiec + (size_t)(f - 1) * c->slowa_kubelka;
+}
+static uint64_t *poziom1(const struct CzescIndeksu *c, int f) { return poziom2(c, f) + c->slowa_l2; }
+static uint64_t *poziom0(const struct CzescIndeksu *c, int f) { return poziom1(c, f) + c->slowa_l1; }
+
+static void ustaw(const struct CzescIndeksu *c, int f, int stolik)
+{
+    uint64_t *l0 = poziom0(c, f);
+    size_t s0 = (size_t)stolik / 64;
+    uint64_t bit = 1ULL << (stolik % 64);
+    if (l0[s0] & bit)
+        return;
+    if (l0[s0] == 0)
+    {
+        uint64_t *l1 = poziom1(c, f);
+        size_t s1 = s0 / 64;
+        if (l1[s1] == 0)
+            poziom2(c, f)[s1 / 64] |= 1ULL << (s1 % 64);
+        l1[s1] |= 1ULL << (s0 % 64);
+    }
+    l0[s0] |= bit;
+}
+
+static void wyczysc(const struct CzescIndeksu *c, int f, int stolik)
+{
+    uint64_t *l0 = poziom0(c, f);
+    size_t s0 = (size_t)stolik / 64;
+    uint64_t bit = 1ULL << (stolik % 64);
+    if (!(l0[s0] & bit))
+        return;
+    l0[s0] &= ~bit;
+    if (l0[s0] == 0)
+    {
+        uint64_t *l1 = poziom1(c, f);
+        size_t s1 = s0 / 64;
+        l1[s1] &= ~(1ULL << (s0 % 64));
+        if (l1[s1] == 0)
+            poziom2(c, f)[s1 / 64] &= ~(1ULL << (s1 % 64));
+    }
+}
+
+// Najniższy stolik w niepustym słowie `s1` poziomu 1.
+static int zejdz_z_l1(const struct CzescIndeksu *c, int f, size_t s1)
+{
+    size_t s0 = s1 * 64 + (size_t)__builtin_ctzll(poziom1(c, f)[s1]);
+    return (int)(s0 * 64 + (size_t)__builtin_ctzll(poziom0(c, f)[s0]));
+}
+
+// Najniższy stolik w słowach poziomu 1 o numerach >= `s1` albo -1; na
+// poziomie 2 są najwyżej WOLNE_MIEJSCA_SLOWA_L2_MAX słowa.
+static int od_slowa_l1(const struct CzescIndeksu *c, int f, size_t s1)
+{
+    uint64_t *l2 = poziom2(c, f);
+    for (size_t s2 = s1 / 64; s2 < c->slowa_l2; s2++)
+    {
+        uint64_t slowo = l2[s2];
+        if (s2 == s1 / 64)
+            slowo &= ~0ULL << (s1 % 64);
+        if (slowo)
+            return zejdz_z_l1(c, f, s2 * 64 + (size_t)__builtin_ctzll(slowo));
+    }
+    return -1;
+}
+
+// Najniższy stolik w kubełku albo -1.
+static int pierwszy(const struct CzescIndeksu *c, int f) { return od_slowa_l1(c, f, 0); }
+
+// Najniższy stolik >= `od` w kubełku albo -1: najpierw reszta słowa na
+// poziomie 0, potem reszta słowa na poziomie 1, potem poziom 2.
+static int nastepny(const struct CzescIndeksu *c, int f, int od)
+{
+    if (od >= c->liczba_stolikow)
+        return -1;
+    uint64_t *l0 = poziom0(c, f);
+    size_t s0 = (size_t)od / 64;
+    uint64_t slowo = l0[s0] & (~0ULL << (od % 64));
+    if (slowo)
+        return (int)(s0 * 64 + (size_t)__builtin_ctzll(slowo));
+
+    s0++;
+    size_t s1 = s0 / 64;
+    if (s0 % 64 != 0 && s1 < c->slowa_l1)
+    {
+        slowo = poziom1(c, f)[s1] & (~0ULL << (s0 % 64));
+        if (slowo)
+        {
+            s0 = s1 * 64 + (size_t)__builtin_ctzll(slowo);
+            return (int)(s0 * 64 + (size_t)__builtin_ctzll(l0[s0]));
+        }
+        s1++;
+    }
+    return od_slowa_l1(c, f, s1);
+}
+
+// Część, do której należy stolik (części są posortowane i przylegają).
+static const struct CzescIndeksu *czesc_stolika(int stolik)
+{
+    int i = wm->liczba_czesci - 1;
+    while (i > 0 && stolik < wm->czesci[i].od)
+        i--;
+    return &wm->czesci[i];
+}
+
+void wolne_miejsca_przypisz(uint64_t *pamiec, int czesci, const int32_t *granice)
+{
+    wm->liczba_czesci = czesci;
+    for (int i = 0; i < czesci; i++)
+    {
+        struct CzescIndeksu *c = &wm->czesci[i];
+        int n = granice[i + 1] - granice[i];
+        size_t w0 = ((size_t)(n > 0 ? n : 0) + 63) / 64;
+        c->pamiec = pamiec;
+        c->od = granice[i];
+        c->liczba_stolikow = n;
+        c->slowa_l1 = (w0 + 63) / 64;
+        c->slowa_l2 = (c->slowa_l1 + 63) / 64;
+        c->slowa_kubelka = wolne_miejsca_slowa_kubelka(n);
+        pamiec += wolne_miejsca_slowa_czesci(n);
+    }
+}
+
+void wolne_miejsca_aktualizuj(int stolik)
+{
+    const struct Stolik *st = &common_ctx->stoliki[stolik];
+    const struct CzescIndeksu *c = czesc_stolika(stolik);
+    int wolne = 0;
+    if (st->liczba_grup < common_ctx->grup_na_stoliku)
+        wolne = st->pojemnosc - st->zajete_miejsca;
+    for (int f = 1; f <= WOLNE_MIEJSCA_KUBELKI; f++)
+    {
+        if (f == wolne)
+            ustaw(c, f, stolik - c->od);
+        else
+            wyczysc(c, f, stolik - c->od);
+    }
+}
+
+void wolne_miejsca_odbuduj(void)
+{
+    for (int i = 0; i < common_ctx->liczba_stolikow; i++)
+        wolne_miejsca_aktualizuj(i);
+}
+
+int wolne_miejsca_znajdz(int osoby)
+{
+    // Części idą po kolei, więc pierwsza z trafieniem ma najniższy stolik.
+    for (int k = 0; k < wm->liczba_czesci; k++)
+    {
+        const struct CzescIndeksu *c = &wm->czesci[k];
+        int najlepszy = -1;
+        for (int f = osoby < 1 ? 1 : osoby; f <= WOLNE_MIEJSCA_KUBELKI; f++)
+        {
+            int i = pierwszy(c, f);
+            if (i >= 0 && (najlepszy < 0 || i < najlepszy))
+                najlepszy = i;
+        }
+        if (najlepszy >= 0)
+            return c->od + najlepszy;
+    }
+    return -1;
+}
+
+int wolne_miejsca_w_przedziale(int wolne, int od, int do_)
+{
+    if (wolne < 1 || wolne > WOLNE_MIEJSCA_KUBELKI || od >= do_)
+        return -1;
+    for (int k = 0; k < wm->liczba_czesci; k++)
+    {
+        const struct CzescIndeksu *c = &wm->czesci[k];
+        if (c->od >= do_)
+            break;
+        int lokalny = od > c->od ? od - c->od : 0;
+        int i = nastepny(c, wolne, lokalny);
+        if (i >= 0)
+            return (c->od + i < do_) ? c->od + i : -1;
+    }
+    return -1;
+}
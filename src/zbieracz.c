@@ -0,0 +1,325 @@
+#define _GNU_SOURCE
+#include "zbieracz.h"
+
+#include "common.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Tablica PID -> wpis z adresowaniem otwartym (sondowanie liniowe, usuwanie
+// z przesunięciem wstecz, więc nie zostają nagrobki). Wypełnienie trzymamy
+// poniżej 3/4, żeby sondy były krótkie.
+#define ZBIERACZ_TABLICA 16384
+#define ZBIERACZ_TABLICA_LIMIT (ZBIERACZ_TABLICA / 4 * 3)
+
+enum StanWpisu
+{
+    WPIS_PUSTY = 0,
+    WPIS_ZYWY = 1,    // zarejestrowany, czeka na zebranie
+    WPIS_ZEBRANY = 2, // zebrany, zanim spawner zdążył go zarejestrować
+};
+
+struct WpisPid
+{
+    pid_t pid;
+    unsigned char stan;
+    unsigned char rola;
+    unsigned char grupa; // proces jednej grupy: przy zebraniu grupy_zwolnij()
+    int status;
+    long long czas_ns; // WPIS_ZYWY: start, WPIS_ZEBRANY: koniec
+    long long user_ns;
+    long long sys_ns;
+};
+
+struct ZbieraczCtx
+{
+    int sfd;
+    int watek_dziala;
+    volatile int stop;
+    pthread_t watek;
+    pthread_mutex_t mutex;
+    size_t zajete;
+    struct WpisPid tablica[ZBIERACZ_TABLICA];
+    struct ZbieraczStat stat;
+};
+
+static struct ZbieraczCtx zbieracz_storage = {.sfd = -1,
+                                              .mutex = PTHREAD_MUTEX_INITIALIZER};
+static struct ZbieraczCtx *zb = &zbieracz_storage;
+
+static long long teraz_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static long long timeval_ns(const struct timeval *tv)
+{
+    return (long long)tv->tv_sec * 1000000000LL + (long long)tv->tv_usec * 1000LL;
+}
+
+const char *zbieracz_nazwa_roli(enum RolaProcesu rola)
+{
+    switch (rola)
+    {
+    case ROLA_OBSLUGA:
+        return "obsluga";
+    case ROLA_SZATNIA:
+        return "szatnia";
+    case ROLA_KUCHARZ:
+        return "kucharz";
+    case ROLA_KIEROWNIK:
+        return "kierownik";
+    default:
+        return "klient";
+    }
+}
+
+// ====== TABLICA PID ======
+
+static size_t indeks_pid(pid_t pid)
+{
+    return ((unsigned)pid * 2654435761u) & (ZBIERACZ_TABLICA - 1);
+}
+
+// Zwraca slot z danym PID albo pierwszy pusty slot na jego ścieżce sondowania.
+static size_t znajdz_slot(pid_t pid)
+{
+    size_t i = indeks_pid(pid);
+    while (zb->tablica[i].stan != WPIS_PUSTY && zb->tablica[i].pid != pid)
+        i = (i + 1) & (ZBIERACZ_TABLICA - 1);
+    return i;
+}
+
+static void usun_slot(size_t i)
+{
+    size_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & (ZBIERACZ_TABLICA - 1);
+        if (zb->tablica[j].stan == WPIS_PUSTY)
+            break;
+        size_t k = indeks_pid(zb->tablica[j].pid);
+        // Wpis j zostaje, jeśli jego slot domowy leży cyklicznie w (i, j].
+        if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        zb->tablica[i] = zb->tablica[j];
+        i = j;
+    }
+    zb->tablica[i].stan = WPIS_PUSTY;
+    zb->zajete--;
+}
+
+// ====== ROZLICZANIE ======
+
+// Wołać z zablokowanym mutexem.
+static void rozlicz(enum RolaProcesu rola, int status, long long user_ns,
+                    long long sys_ns, long long czas_zycia_ns)
+{
+    struct ZbieraczStat *s = &zb->stat;
+    s->zebrane++;
+    s->procesy[rola]++;
+    s->cpu_user_ns[rola] += user_ns;
+    s->cpu_sys_ns[rola] += sys_ns;
+    if (WIFSIGNALED(status))
+        s->zabite_sygnalem++;
+    else if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        s->wyjscie_zero++;
+    else
+        s->wyjscie_blad++;
+
+    if (rola == ROLA_KLIENT && czas_zycia_ns >= 0)
+        histogram_dodaj(&s->czas_zycia_klienta, (unsigned long long)czas_zycia_ns);
+}
+
+static void zarejestruj(pid_t pid, enum RolaProcesu rola, int grupa)
+{
+    long long teraz = teraz_ns();
+    int zwolnij = 0;
+    pthread_mutex_lock(&zb->mutex);
+    size_t i = znajdz_slot(pid);
+    struct WpisPid *w = &zb->tablica[i];
+    if (w->stan == WPIS_ZEBRANY)
+    {
+        // Dziecko zakończyło się, zanim spawner wrócił z posix_spawn(), więc
+        // czas życia jest krótszy niż samo uruchomienie — liczymy go jako 0.
+        rozlicz(rola, w->status, w->user_ns, w->sys_ns, 0);
+        usun_slot(i);
+        zwolnij = grupa;
+    }
+    else if (zb->zajete < ZBIERACZ_TABLICA_LIMIT)
+    {
+        *w = (struct WpisPid){.pid = pid, .stan = WPIS_ZYWY,
+                              .rola = (unsigned char)rola,
+                              .grupa = (unsigned char)grupa, .czas_ns = teraz};
+        zb->zajete++;
+        if (rola == ROLA_KLIENT &&
+            ++zb->stat.klienci_aktywni > zb->stat.klienci_szczyt)
+            zb->stat.klienci_szczyt = zb->stat.klienci_aktywni;
+    }
+    else
+    {
+        zb->stat.niezarejestrowane++;
+    }
+    pthread_mutex_unlock(&zb->mutex);
+    if (zwolnij)
+        grupy_zwolnij();
+}
+
+void zbieracz_zarejestruj(pid_t pid, enum RolaProcesu rola) { zarejestruj(pid, rola, 0); }
+
+void zbieracz_zarejestruj_grupe(pid_t pid) { zarejestruj(pid, ROLA_KLIENT, 1); }
+
+// Zbiera wszystkie zakończone dzieci. `powiadomienie_ns` > 0 to moment
+// odebrania SIGCHLD z signalfd (próbka opóźnienia zbierania).
+static int zbierz_wait4(int *status, long long powiadomienie_ns)
+{
+    int klienci = 0;
+    for (;;)
+    {
+        int st = 0;
+        struct rusage ru;
+        pid_t p = wait4(-1, &st, WNOHANG, &ru);
+        if (p <= 0)
+            break;
+        long long teraz = teraz_ns();
+        if (status)
+            *status = st;
+        long long user_ns = timeval_ns(&ru.ru_utime);
+        long long sys_ns = timeval_ns(&ru.ru_stime);
+        int zwolnij = 0;
+
+        pthread_mutex_lock(&zb->mutex);
+        if (powiadomienie_ns > 0)
+            histogram_dodaj(&zb->stat.opoznienie,
+                            (unsigned long long)(teraz - powiadomienie_ns));
+        size_t i = znajdz_slot(p);
+        struct WpisPid *w = &zb->tablica[i];
+        if (w->stan == WPIS_ZYWY)
+        {
+            enum RolaProcesu rola = (enum RolaProcesu)w->rola;
+            rozlicz(rola, st, user_ns, sys_ns, teraz - w->czas_ns);
+            if (rola == ROLA_KLIENT)
+            {
+                zb->stat.klienci_aktywni--;
+                klienci++;
+            }
+            zwolnij = w->grupa;
+            usun_slot(i);
+        }
+        else if (zb->zajete < ZBIERACZ_TABLICA_LIMIT)
+        {
+            *w = (struct WpisPid){.pid = p, .stan = WPIS_ZEBRANY, .status = st,
+                                  .czas_ns = teraz, .user_ns = user_ns,
+                                  .sys_ns = sys_ns};
+            zb->zajete++;
+        }
+        else
+        {
+            zb->stat.niezarejestrowane++;
+        }
+        pthread_mutex_unlock(&zb->mutex);
+        // Miejsce grupy oddajemy tu, a nie w samym kliencie: zabity
+        // sygnałem proces też trafia do wait4().
+        if (zwolnij)
+            grupy_zwolnij();
+
+        LOGD("zbieracz: pid=%d zebrano=%d status=%d\n", (int)getpid(), (int)p, st);
+    }
+    return klienci;
+}
+
+int zbieracz_zbierz(int *status) { return zbierz_wait4(status, 0); }
+
+// Opróżnia signalfd; zwraca moment odczytu albo 0, gdy nic nie czekało.
+static long long oproznij_signalfd(void)
+{
+    struct signalfd_siginfo si[16];
+    long long powiadomienie = 0;
+    // Sygnały SIGCHLD się sklejają; opróżniamy signalfd i zbieramy
+    // wszystko, co jest gotowe.
+    while (read(zb->sfd, si, sizeof(si)) > 0)
+        if (!powiadomienie)
+            powiadomienie = teraz_ns();
+    return powiadomienie;
+}
+
+int zbieracz_czekaj(int *status, int timeout_ms)
+{
+    if (zb->sfd >= 0)
+    {
+        struct pollfd pfd = {.fd = zb->sfd, .events = POLLIN};
+        (void)poll(&pfd, 1, timeout_ms);
+        (void)oproznij_signalfd();
+    }
+    return zbierz_wait4(status, 0);
+}
+
+// ====== WĄTEK ======
+
+static void *watek_zbieracza(void *arg)
+{
+    (void)arg;
+    struct pollfd pfd = {.fd = zb->sfd, .events = POLLIN};
+    while (!zb->stop)
+    {
+        // Bez limitu czasu: zbieracz_zatrzymaj() budzi nas własnym SIGCHLD.
+        long long powiadomienie = 0;
+        if (poll(&pfd, 1, -1) > 0)
+            powiadomienie = oproznij_signalfd();
+        (void)zbierz_wait4(NULL, powiadomienie);
+    }
+    return NULL;
+}
+
+int zbieracz_inicjuj(void)
+{
+    sigset_t maska;
+    sigemptyset(&maska);
+    sigaddset(&maska, SIGCHLD);
+    if (pthread_sigmask(SIG_BLOCK, &maska, NULL) != 0)
+        return -1;
+    zb->sfd = signalfd(-1, &maska, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (zb->sfd < 0)
+    {
+        LOGE_ERRNO("signalfd(SIGCHLD)");
+        return -1;
+    }
+    return 0;
+}
+
+int zbieracz_start(void)
+{
+    if (zb->sfd < 0)
+        return -1;
+    zb->stop = 0;
+    if (pthread_create(&zb->watek, NULL, watek_zbieracza, NULL) != 0)
+    {
+        LOGE_ERRNO("pthread_create(watek_zbieracza)");
+        return -1;
+    }
+    zb->watek_dziala = 1;
+    return 0;
+}
+
+void zbieracz_zatrzymaj(void)
+{
+    if (!zb->watek_dziala)
+        return;
+    zb->stop = 1;
+    // SIGCHLD jest zablokowany, więc trafia do signalfd i budzi poll().
+    (void)kill(getpid(), SIGCHLD);
+    (void)pthread_join(zb->watek, NULL);
+    zb->watek_dziala = 0;
+}
+
+const struct ZbieraczStat *zbieracz_statystyki(void) { return &zb->stat; }
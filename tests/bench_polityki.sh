@@ -0,0 +1,57 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Porównanie polityk usadzania (RESTAURACJA_POLITYKA) na tym samym ruchu:
+# obłożenie miejsc, usadzone grupy na sekundę i mediana czekania na stolik
+# wg liczby osób w grupie.
+#
+#   POLITYKI_LISTA="pierwszy najlepszy klasa bez_dzielenia"
+#   POLITYKI_GRUPY=2000   grupy na przebieg
+#   POLITYKI_CZAS=3       sekundy na przebieg
+#   POLITYKI_TEMPO=       tempo przybyć w grupach/s (puste = wszystkie naraz)
+# Układ sali jak zwykle z RESTAURACJA_STOLIKI / RESTAURACJA_GRUP_NA_STOLIKU.
+# Bez RESTAURACJA_SEED: to samo ziarno w każdym procesie `klient` daje
+# wszystkim grupom ten sam rozmiar.
+#
+# Nie wchodzi do `make test` — uruchamiaj przez `make polityki`.
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+cd "$ROOT_DIR"
+
+LISTA="${POLITYKI_LISTA:-pierwszy najlepszy klasa bez_dzielenia}"
+GRUPY="${POLITYKI_GRUPY:-2000}"
+CZAS="${POLITYKI_CZAS:-3}"
+LOG="$(mktemp /tmp/restauracja_polityki.XXXXXX)"
+trap 'rm -f "$LOG"' EXIT
+
+make -s all
+
+env_tempo=()
+if [[ -n "${POLITYKI_TEMPO:-}" ]]; then
+  env_tempo=(RESTAURACJA_PRZYBYCIA=poisson RESTAURACJA_TEMPO="$POLITYKI_TEMPO")
+fi
+
+# "  grupy N-os.: n=... p50=X ms ..." -> "X"
+mediana() {
+  sed -nE "s/^  grupy $1-os\\.: .*p50=([0-9.]+) ms.*/\\1/p" "$LOG" | head -n1
+}
+
+printf "%-14s %10s %12s %9s %9s %9s %9s\n" "polityka" "oblozenie" "usadzone/s" \
+  "1os.p50" "2os.p50" "3os.p50" "4os.p50"
+for p in $LISTA; do
+  set +e
+  env RESTAURACJA_POLITYKA="$p" "${env_tempo[@]}" \
+    RESTAURACJA_LOG_LEVEL=0 \
+    timeout $((CZAS + 60)) ./build/bin/restauracja "$GRUPY" "$CZAS" >"$LOG" 2>&1
+  rc=$?
+  set -e
+  if [[ $rc -ne 0 ]]; then
+    echo "[polityki] FAIL: $p, kod wyjścia $rc"
+    tail -n 20 "$LOG"
+    exit 1
+  fi
+  oblozenie="$(sed -nE 's/^Polityka usadzania: .*obłożenie miejsc: ([0-9.]+%).*/\1/p' "$LOG")"
+  tempo="$(sed -nE 's/^Polityka usadzania: .*usadzone grupy: [0-9]+ \(([0-9.]+) grup\/s\).*/\1/p' "$LOG")"
+  printf "%-14s %10s %12s %9s %9s %9s %9s\n" "$p" "${oblozenie:--}" "${tempo:--}" \
+    "$(mediana 1)" "$(mediana 2)" "$(mediana 3)" "$(mediana 4)"
+done
@@ -0,0 +1,60 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Skalowanie sali: ten sam ruch dla coraz większej liczby stolików.
+# Dla każdego rozmiaru (stoliki łącznie, po równo na pojemności 1..4)
+# wypisuje grupy obsłużone, opóźnienie usadzenia i oczekiwanie na danie.
+#
+#   SKALA_ROZMIARY="40 200 1000 2000"  liczby stolików
+#   SKALA_CZAS=3                        sekundy na przebieg
+#   SKALA_GRUPY_NA_STOLIK=1             grupy wysyłane na stolik (min. 100)
+#   SKALA_TASMA=                        stała długość taśmy (domyślnie
+#                                       max(150, liczba stolików))
+#
+# Nie wchodzi do `make test` — uruchamiaj przez `make skala`.
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+cd "$ROOT_DIR"
+
+ROZMIARY="${SKALA_ROZMIARY:-40 200 1000 2000}"
+CZAS="${SKALA_CZAS:-3}"
+NA_STOLIK="${SKALA_GRUPY_NA_STOLIK:-1}"
+LOG="$(mktemp /tmp/restauracja_skala.XXXXXX)"
+trap 'rm -f "$LOG"' EXIT
+
+make -s all
+
+# "n=... p50=X ms p90=... p99=Y ms" -> "X Y"
+percentyle() {
+  sed -nE "s/^$1: .*p50=([0-9.]+) ms .*p99=([0-9.]+) ms.*/\1 \2/p" "$LOG" | head -n1
+}
+
+printf "%8s %7s %10s %10s %10s %10s %10s\n" "stoliki" "tasma" "obsluzone" \
+  "usadz.p50" "usadz.p99" "danie.p50" "danie.p99"
+for n in $ROZMIARY; do
+  cz=$((n / 4))
+  reszta=$((n - 3 * cz))
+  grupy=$((n * NA_STOLIK))
+  ((grupy < 100)) && grupy=100
+  env_tasma=()
+  [[ -n "${SKALA_TASMA:-}" ]] && env_tasma=(RESTAURACJA_TASMA="$SKALA_TASMA")
+
+  set +e
+  env RESTAURACJA_STOLIKI="$cz,$cz,$cz,$reszta" "${env_tasma[@]}" \
+    RESTAURACJA_LOG_LEVEL=0 RESTAURACJA_SEED=7 \
+    timeout $((CZAS + 60)) ./build/bin/restauracja "$grupy" "$CZAS" >"$LOG" 2>&1
+  rc=$?
+  set -e
+  if [[ $rc -ne 0 ]]; then
+    echo "[skala] FAIL: $n stolików, kod wyjścia $rc"
+    tail -n 20 "$LOG"
+    exit 1
+  fi
+
+  tasma="$(sed -nE 's/^Sala: .*taśma ([0-9]+),.*/\1/p' "$LOG")"
+  obsluzone="$(sed -nE 's/^Grupy obsłużone: ([0-9]+).*/\1/p' "$LOG")"
+  read -r u50 u99 <<<"$(percentyle 'Od przybycia do usadzenia')"
+  read -r d50 d99 <<<"$(percentyle 'Oczekiwanie na danie')"
+  printf "%8d %7s %10s %10s %10s %10s %10s\n" "$n" "$tasma" "$obsluzone/$grupy" \
+    "${u50:--}" "${u99:--}" "${d50:--}" "${d99:--}"
+done
@@ -0,0 +1,225 @@
+// Mikrobenchmark szukania stolika: dawny skan first-fit po wszystkich
+// stolikach kontra indeks wolnych miejsc (wolne_miejsca.h). Dla każdej
+// wielkości sali zapełnia stoliki losowymi grupami (first-fit, jak
+// szatnia), zwalnia część z nich i mierzy średni czas jednego szukania.
+// Oba sposoby muszą dać ten sam stolik — inaczej kod wyjścia 1. Tak samo
+// pozostałe polityki (polityka.h) porównujemy z ich wersją skanującą. Każdą
+// salę sprawdzamy z indeksem w jednej części i podzielonym na SZATNIE_MAX
+// części (jak przy RESTAURACJA_SZATNIE), bo szukanie przechodzi granice.
+//
+//   bench_stoliki [stoliki...]   (domyślnie 40 1000 10000 100000)
+
+#define _POSIX_C_SOURCE 200809L
+#include "common.h"
+#include "polityka.h"
+#include "wolne_miejsca.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SZUKANIA 200000
+
+static long long teraz_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Kopia dawnego znajdz_stolik_dla_grupy_zablokowanej().
+static int skan_liniowy(int osoby)
+{
+    for (int i = 0; i < common_ctx->liczba_stolikow; i++)
+    {
+        if (common_ctx->stoliki[i].zajete_miejsca + osoby <= common_ctx->stoliki[i].pojemnosc &&
+            common_ctx->stoliki[i].liczba_grup < common_ctx->grup_na_stoliku)
+            return i;
+    }
+    return -1;
+}
+
+static int wolne(int i)
+{
+    const struct Stolik *st = &common_ctx->stoliki[i];
+    return st->liczba_grup < common_ctx->grup_na_stoliku ? st->pojemnosc - st->zajete_miejsca : 0;
+}
+
+// Wersje skanujące polityk: ten sam wybór co polityka.c, liczony wprost.
+static int skan_polityki(enum PolitykaUsadzania p, int osoby)
+{
+    int wynik = -1;
+    for (int i = 0; i < common_ctx->liczba_stolikow; i++)
+    {
+        int w = wolne(i);
+        if (w < osoby)
+            continue;
+        const struct Stolik *st = &common_ctx->stoliki[i];
+        const struct Stolik *naj = wynik >= 0 ? &common_ctx->stoliki[wynik] : NULL;
+        int lepszy = 0;
+        switch (p)
+        {
+        case POLITYKA_NAJLEPSZY:
+            lepszy = !naj || w < wolne(wynik);
+            break;
+        case POLITYKA_KLASA:
+            lepszy = !naj || st->pojemnosc < naj->pojemnosc;
+            break;
+        case POLITYKA_BEZ_DZIELENIA:
+        {
+            // Klucz: (niepusty, pojemność pustego / wolne dzielonego).
+            int pusty = (st->zajete_miejsca == 0 && st->liczba_grup == 0);
+            int naj_pusty = naj && naj->zajete_miejsca == 0 && naj->liczba_grup == 0;
+            if (!naj || (pusty && !naj_pusty))
+                lepszy = 1;
+            else if (pusty == naj_pusty)
+                lepszy = pusty ? st->pojemnosc < naj->pojemnosc : w < wolne(wynik);
+            break;
+        }
+        default:
+            lepszy = !naj;
+            break;
+        }
+        if (lepszy)
+            wynik = i;
+    }
+    return wynik;
+}
+
+static void usadz(int i, int osoby)
+{
+    common_ctx->stoliki[i].zajete_miejsca += osoby;
+    common_ctx->stoliki[i].liczba_grup++;
+    wolne_miejsca_aktualizuj(i);
+}
+
+// Zwraca liczbę niezgodności między skanem a indeksem.
+static int przebieg(int n, int szatnie, unsigned int *ziarno)
+{
+    int pojemnosci[4] = {0, 0, 0, 0};
+    for (int i = 0; i < n; i++)
+        pojemnosci[(int)((long long)i * 4 / n)]++;
+    // Granice części jak w uklad_wymiary_z_env().
+    int32_t granice[SZATNIE_MAX + 1];
+    for (int s = 0; s <= szatnie; s++)
+    {
+        granice[s] = 0;
+        for (int c = 1; c <= 4; c++)
+            if ((c - 1) * szatnie / 4 < s)
+                granice[s] += pojemnosci[c - 1];
+    }
+
+    struct Stolik *stoliki = calloc((size_t)n, sizeof(*stoliki));
+    uint64_t *indeks = calloc(1, wolne_miejsca_rozmiar(szatnie, granice));
+    int *osoby = malloc(sizeof(int) * SZUKANIA);
+    if (!stoliki || !indeks || !osoby)
+    {
+        perror("calloc");
+        exit(1);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        stoliki[i].numer_stolika = i + 1;
+        stoliki[i].pojemnosc = 1 + (int)((long long)i * 4 / n);
+    }
+    common_ctx->stoliki = stoliki;
+    common_ctx->liczba_stolikow = n;
+    common_ctx->grup_na_stoliku = GRUP_NA_STOLIKU_DEFAULT;
+    for (int c = 0; c < 4; c++)
+        common_ctx->stoliki_wg_pojemnosci[c] = pojemnosci[c];
+    wolne_miejsca_przypisz(indeks, szatnie, granice);
+    wolne_miejsca_odbuduj();
+
+    // Sala pełna jak w szczycie: first-fit aż do braku miejsca dla jednej
+    // osoby, potem co dziesiąty stolik się zwalnia. Zapełnianie idzie przez
+    // indeks (skan byłby kwadratowy); co pewien krok porównujemy ze skanem.
+    int niezgodne = 0;
+    for (long krok = 0;; krok++)
+    {
+        int o = 1 + (int)(rand_r(ziarno) % 4);
+        int i = wolne_miejsca_znajdz(o);
+        if (krok % 97 == 0)
+            niezgodne += (i != skan_liniowy(o));
+        if (i >= 0)
+            usadz(i, o);
+        else if (wolne_miejsca_znajdz(1) < 0)
+            break;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        if (rand_r(ziarno) % 10 != 0)
+            continue;
+        stoliki[i].zajete_miejsca = 0;
+        stoliki[i].liczba_grup = 0;
+        wolne_miejsca_aktualizuj(i);
+    }
+
+    for (int k = 0; k < SZUKANIA; k++)
+        osoby[k] = 1 + (int)(rand_r(ziarno) % 4);
+
+    // Skan kosztuje O(n), więc dla dużych sal mierzymy go na mniejszej próbce.
+    int skany = (int)(SZUKANIA * 40LL / n);
+    if (skany > SZUKANIA)
+        skany = SZUKANIA;
+    if (skany < 1000)
+        skany = 1000;
+
+    volatile int wynik = 0;
+    long long t0 = teraz_ns();
+    for (int k = 0; k < skany; k++)
+        wynik += skan_liniowy(osoby[k]);
+    long long t1 = teraz_ns();
+    for (int k = 0; k < SZUKANIA; k++)
+        wynik += wolne_miejsca_znajdz(osoby[k]);
+    long long t2 = teraz_ns();
+    for (int k = 0; k < skany; k++)
+        niezgodne += (skan_liniowy(osoby[k]) != wolne_miejsca_znajdz(osoby[k]));
+    for (int p = POLITYKA_NAJLEPSZY; p < POLITYKA_LICZBA; p++)
+        for (int k = 0; k < skany / 10; k++)
+            niezgodne += (skan_polityki((enum PolitykaUsadzania)p, osoby[k]) !=
+                          polityka_znajdz_wg((enum PolitykaUsadzania)p, osoby[k]));
+    (void)wynik;
+
+    double ns_skan = (double)(t1 - t0) / skany;
+    double ns_indeks = (double)(t2 - t1) / SZUKANIA;
+    printf("%8d %7d %14.1f %14.1f %10.1fx %s\n", n, szatnie, ns_skan, ns_indeks,
+           ns_indeks > 0 ? ns_skan / ns_indeks : 0.0, niezgodne ? "NIEZGODNE" : "zgodne");
+
+    free(osoby);
+    free(indeks);
+    free(stoliki);
+    return niezgodne;
+}
+
+int main(int argc, char **argv)
+{
+    static const int domyslne[] = {40, 1000, 10000, 100000};
+    unsigned int ziarno = 7;
+    int niezgodne = 0;
+
+    printf("%8s %7s %14s %14s %11s\n", "stoliki", "szatnie", "skan [ns]", "indeks [ns]",
+           "przyspiesz.");
+    if (argc > 1)
+    {
+        for (int a = 1; a < argc; a++)
+        {
+            int n = atoi(argv[a]);
+            if (n < 1 || n > 4 * STOLIKI_MAX)
+            {
+                fprintf(stderr, "Liczba stolików poza zakresem 1..%d: %s\n", 4 * STOLIKI_MAX, argv[a]);
+                return 2;
+            }
+            niezgodne += przebieg(n, 1, &ziarno);
+            niezgodne += przebieg(n, SZATNIE_MAX, &ziarno);
+        }
+    }
+    else
+    {
+        for (size_t a = 0; a < sizeof(domyslne) / sizeof(domyslne[0]); a++)
+        {
+            niezgodne += przebieg(domyslne[a], 1, &ziarno);
+            niezgodne += przebieg(domyslne[a], SZATNIE_MAX, &ziarno);
+        }
+    }
+    return niezgodne ? 1 : 0;
+}
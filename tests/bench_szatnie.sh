@@ -0,0 +1,45 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Skalowanie szatni (RESTAURACJA_SZATNIE): ten sam ruch przy 1, 2 i 4
+# procesach szatni. Dla każdej liczby wypisuje usadzone grupy na sekundę,
+# medianę i p99 czekania na stolik oraz grupy usadzone przez każdą szatnię.
+#
+#   SZATNIE_LISTA="1 2 4"
+#   SZATNIE_GRUPY=4000   grupy na przebieg
+#   SZATNIE_CZAS=3       sekundy na przebieg
+# Układ sali jak zwykle z RESTAURACJA_STOLIKI / RESTAURACJA_GRUP_NA_STOLIKU.
+# Bez RESTAURACJA_SEED: to samo ziarno w każdym procesie `klient` daje
+# wszystkim grupom ten sam rozmiar, a wtedy pracuje tylko jedna szatnia.
+#
+# Nie wchodzi do `make test` — uruchamiaj przez `make szatnie`.
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+cd "$ROOT_DIR"
+
+LISTA="${SZATNIE_LISTA:-1 2 4}"
+GRUPY="${SZATNIE_GRUPY:-4000}"
+CZAS="${SZATNIE_CZAS:-3}"
+LOG="$(mktemp /tmp/restauracja_szatnie.XXXXXX)"
+trap 'rm -f "$LOG"' EXIT
+
+make -s all
+
+printf "%8s %12s %10s %10s  %s\n" "szatnie" "usadzone/s" "usadz.p50" "usadz.p99" \
+  "grupy wg szatni"
+for n in $LISTA; do
+  set +e
+  env RESTAURACJA_SZATNIE="$n" RESTAURACJA_LOG_LEVEL=0 \
+    timeout $((CZAS + 60)) ./build/bin/restauracja "$GRUPY" "$CZAS" >"$LOG" 2>&1
+  rc=$?
+  set -e
+  if [[ $rc -ne 0 ]]; then
+    echo "[szatnie] FAIL: $n szatni, kod wyjścia $rc"
+    tail -n 20 "$LOG"
+    exit 1
+  fi
+  tempo="$(sed -nE 's/^Polityka usadzania: .*usadzone grupy: [0-9]+ \(([0-9.]+) grup\/s\).*/\1/p' "$LOG")"
+  read -r u50 u99 <<<"$(sed -nE 's/^Od przybycia do usadzenia: .*p50=([0-9.]+) ms .*p99=([0-9.]+) ms.*/\1 \2/p' "$LOG" | head -n1)"
+  wg_szatni="$(sed -nE 's/^  szatnia [0-9]+ .*: usadzone grupy ([0-9]+) .*/\1/p' "$LOG" | paste -sd/)"
+  printf "%8s %12s %10s %10s  %s\n" "$n" "${tempo:--}" "${u50:--}" "${u99:--}" "${wg_szatni:--}"
+done
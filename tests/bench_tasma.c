@@ -0,0 +1,366 @@
+// Mikrobenchmark dodawania dania na taśmę, czyli całego dodaj_danie() bez
+// czekania na miejsce: dawny obrót całej tablicy o jedną pozycję aż do
+// wolnej pozycji 0 i budzenie po przejrzeniu stolików kontra pierścień z
+// ruchomą głową, indeksem wolnych pozycji i mapami śpiących stolików
+// (tasma.h). Dla każdej długości taśma jest zapełniona w połowie i do pełna
+// (jak przy kuchni szybszej od klientów); jeden krok to zdjęcie losowego
+// dania, dodanie nowego i obudzenie stolików. Przy SPIACE stolikach
+// rozłożonych równo po sali ktoś śpi i nie zdejmuje dań, więc obie wersje
+// robią podobną liczbę futex_obudz(); kolumny budz. podają jej średnią na
+// krok. Dawny obrót mierzymy
+// najwyżej przez LIMIT_STAREGO_NS, bo na pełnej taśmie kosztuje O(n^2), a
+// dla taśm dłuższych niż OBROT_MAX wcale (samo napełnienie trwałoby minuty).
+// Po tej samej liczbie kroków obie taśmy muszą mieć to samo na każdej
+// pozycji, a co pewien krok pozycja wybrana przez indeks musi być najwyższą
+// wolną pozycją ze skanu, a lista dań specjalnych stolika zgadzać się ze
+// skanem taśmy — inaczej kod wyjścia 1. Stolików jest tyle, co pozycji.
+// Na końcu mierzymy też szukanie dania specjalnego dla losowego stolika:
+// dawny skan taśmy (prawie zawsze nic nie znajduje) kontra lista stolika.
+//
+//   bench_tasma [dlugosc...]   (domyślnie 150 1500 15000)
+
+#define _POSIX_C_SOURCE 200809L
+#include "common.h"
+#include "tasma.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define KROKI 200000
+#define LIMIT_STAREGO_NS 300000000LL
+#define OBROT_MAX 20000
+#define SPIACE 8
+
+static long long teraz_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct Krok
+{
+    int pozycja; // pozycja logiczna zdejmowanego dania
+    int cena;
+    int stolik_specjalny;
+};
+
+// Kopia dawnego dodaj_danie() z obsluga.c (bez czekania; budzenie niżej).
+static void stara_poloz(struct Talerzyk *t, int dlugosc, int cena, int stolik_specjalny)
+{
+    do
+    {
+        struct Talerzyk ostatni = t[dlugosc - 1];
+        for (int i = dlugosc - 1; i > 0; i--)
+            t[i] = t[i - 1];
+        t[0] = ostatni;
+    } while (t[0].cena != 0);
+    t[0].cena = cena;
+    t[0].stolik_specjalny = stolik_specjalny;
+}
+
+// Kopia dawnego tasma_powiadom_stoliki() z common.c: zwykłe dania przed
+// stolikami i dania specjalne z przeglądu całej taśmy.
+static void stara_powiadom(const struct Talerzyk *t, int dlugosc, int *do_zdjecia)
+{
+    int n = common_ctx->liczba_stolikow;
+    for (int i = 0; i < n && i < dlugosc; i++)
+        if (t[i].cena != 0 && t[i].stolik_specjalny == 0)
+            do_zdjecia[i]++;
+    for (int i = 0; i < dlugosc; i++)
+    {
+        int s = t[i].stolik_specjalny;
+        if (t[i].cena != 0 && s > 0 && s <= n)
+            do_zdjecia[s - 1]++;
+    }
+    for (int i = 0; i < n; i++)
+        if (do_zdjecia[i] > 0)
+        {
+            tasma_obudz_stolik(i, do_zdjecia[i]);
+            do_zdjecia[i] = 0;
+        }
+}
+
+// Przy SPIACE stolikach (albo wszystkich, gdy jest ich mniej) śpi jedna
+// osoba; liczniki budzików od zera.
+static void uspij_stoliki(int stoliki)
+{
+    for (int i = 0; i < stoliki; i++)
+        common_ctx->budziki[i] = (struct BudzikStolika){0, 0};
+    for (int k = 0; k < SPIACE && k < stoliki; k++)
+        tasma_zapisz_czekajacego((int)((long long)k * stoliki / (SPIACE < stoliki ? SPIACE : stoliki)));
+}
+
+// Suma podbić budzików od uspij_stoliki().
+static long long budzenia(int stoliki)
+{
+    long long suma = 0;
+    for (int i = 0; i < stoliki; i++)
+        suma += common_ctx->budziki[i].zdarzenia;
+    return suma;
+}
+
+static void losuj_danie(unsigned int *ziarno, int dlugosc, int *cena, int *stolik_specjalny)
+{
+    *cena = 10 + 5 * (int)(rand_r(ziarno) % 3);
+    *stolik_specjalny = rand_r(ziarno) % 4 == 0 ? 1 + (int)(rand_r(ziarno) % (unsigned)dlugosc) : 0;
+}
+
+// Pełna taśma, potem zdjęcia z losowych pozycji aż zostanie `dan` dań —
+// wolne pozycje są rozrzucone, a nie w jednym bloku. Obie wersje z tego
+// samego ziarna, więc dają ten sam stan.
+static void napelnij_pierscien(int dlugosc, int dan)
+{
+    unsigned int ziarno = 11;
+    memset(common_ctx->tasma, 0, sizeof(struct Talerzyk) * (size_t)dlugosc);
+    common_ctx->tasma_sync->glowa = 0;
+    tasma_odbuduj();
+    for (int i = 0; i < dlugosc; i++)
+    {
+        int cena, spec;
+        losuj_danie(&ziarno, dlugosc, &cena, &spec);
+        tasma_poloz(cena, spec);
+    }
+    for (int zostalo = dlugosc; zostalo > dan;)
+    {
+        int p = (int)(rand_r(&ziarno) % (unsigned)dlugosc);
+        if (tasma_pozycja(p)->cena == 0)
+            continue;
+        tasma_zdejmij(p);
+        zostalo--;
+    }
+    uspij_stoliki(dlugosc);
+}
+
+static void napelnij_stara(struct Talerzyk *stara, int dlugosc, int dan)
+{
+    unsigned int ziarno = 11;
+    memset(stara, 0, sizeof(struct Talerzyk) * (size_t)dlugosc);
+    for (int i = 0; i < dlugosc; i++)
+    {
+        int cena, spec;
+        losuj_danie(&ziarno, dlugosc, &cena, &spec);
+        stara_poloz(stara, dlugosc, cena, spec);
+    }
+    for (int zostalo = dlugosc; zostalo > dan;)
+    {
+        int p = (int)(rand_r(&ziarno) % (unsigned)dlugosc);
+        if (stara[p].cena == 0)
+            continue;
+        stara[p].cena = 0;
+        stara[p].stolik_specjalny = 0;
+        zostalo--;
+    }
+}
+
+// Jeden krok na pierścieniu; zwraca 0, gdy na pozycji było danie.
+static int krok_pierscien(const struct Krok *k)
+{
+    int bylo = tasma_pozycja(k->pozycja)->cena != 0;
+    tasma_zdejmij(k->pozycja);
+    tasma_poloz(k->cena, k->stolik_specjalny);
+    tasma_powiadom_stoliki(k->stolik_specjalny);
+    return bylo ? 0 : -1;
+}
+
+// Najwyższa wolna pozycja logiczna (tam dawny obrót kładł danie) albo -1.
+static int skan_wolnej(int dlugosc)
+{
+    for (int p = dlugosc - 1; p >= 0; p--)
+        if (tasma_pozycja(p)->cena == 0)
+            return p;
+    return -1;
+}
+
+// Liczba dań specjalnych dla stolika `stolik` (indeks od 0) na całej taśmie.
+static int skan_specjalnych(int dlugosc, int stolik)
+{
+    int n = 0;
+    for (int p = 0; p < dlugosc; p++)
+        n += (tasma_pozycja(p)->cena != 0 && tasma_pozycja(p)->stolik_specjalny == stolik + 1);
+    return n;
+}
+
+// Kopia dawnego szukania w sprobuj_pobrac_danie(): pierwsza pozycja z daniem
+// specjalnym dla stolika albo -1.
+static int skan_pierwszego_specjalnego(int dlugosc, int stolik)
+{
+    for (int p = 0; p < dlugosc; p++)
+        if (tasma_pozycja(p)->cena != 0 && tasma_pozycja(p)->stolik_specjalny == stolik + 1)
+            return p;
+    return -1;
+}
+
+// Zwraca liczbę niezgodności między dawnym obrotem a pierścieniem.
+static int przebieg(int dlugosc, int procent, unsigned int *ziarno)
+{
+    struct Talerzyk *tasma = calloc((size_t)dlugosc, sizeof(*tasma));
+    struct Talerzyk *stara = calloc((size_t)dlugosc, sizeof(*stara));
+    uint64_t *indeks = calloc(1, tasma_wolne_rozmiar(dlugosc));
+    struct SpecjalneStolika *specjalne = calloc((size_t)dlugosc, sizeof(*specjalne));
+    int *nastepny = calloc((size_t)dlugosc, sizeof(*nastepny));
+    uint64_t *zwykle = calloc(1, tasma_zwykle_rozmiar(dlugosc));
+    uint64_t *czekajace = calloc(1, tasma_czekajace_rozmiar(dlugosc));
+    struct BudzikStolika *budziki = aligned_alloc(64, sizeof(*budziki) * (size_t)dlugosc);
+    int *do_zdjecia = calloc((size_t)dlugosc, sizeof(*do_zdjecia));
+    struct Krok *kroki = malloc(sizeof(*kroki) * KROKI);
+    struct TasmaSync sync;
+    if (!tasma || !stara || !indeks || !specjalne || !nastepny || !zwykle || !czekajace ||
+        !budziki || !do_zdjecia || !kroki)
+    {
+        perror("calloc");
+        exit(1);
+    }
+    memset(&sync, 0, sizeof(sync));
+    common_ctx->tasma = tasma;
+    common_ctx->tasma_sync = &sync;
+    common_ctx->dlugosc_tasmy = dlugosc;
+    common_ctx->liczba_stolikow = dlugosc;
+    common_ctx->budziki = budziki;
+    tasma_przypisz(indeks, specjalne, nastepny, zwykle, czekajace);
+    int dan = (int)((long long)dlugosc * procent / 100);
+    if (dan < 1)
+        dan = 1;
+
+    // Kroki losujemy na pierścieniu: zdejmujemy pierwsze danie od losowej
+    // pozycji w górę, więc zapełnienie się nie zmienia.
+    // Skan kosztuje O(n), więc dla długich taśm sprawdzamy co `co` krok.
+    int niezgodne = 0;
+    int co = 1 + dlugosc / 1000;
+    napelnij_pierscien(dlugosc, dan);
+    for (int k = 0; k < KROKI; k++)
+    {
+        int p = (int)(rand_r(ziarno) % (unsigned)dlugosc);
+        while (tasma_pozycja(p)->cena == 0)
+            p = p + 1 < dlugosc ? p + 1 : 0;
+        kroki[k].pozycja = p;
+        losuj_danie(ziarno, dlugosc, &kroki[k].cena, &kroki[k].stolik_specjalny);
+        if (k % co != 0)
+        {
+            krok_pierscien(&kroki[k]);
+            continue;
+        }
+        int zdjety = tasma_pozycja(p)->stolik_specjalny;
+        tasma_zdejmij(p);
+        struct Talerzyk *oczekiwana = tasma_pozycja(skan_wolnej(dlugosc));
+        tasma_poloz(kroki[k].cena, kroki[k].stolik_specjalny);
+        tasma_powiadom_stoliki(kroki[k].stolik_specjalny);
+        niezgodne += (tasma_pozycja(0) != oczekiwana);
+        if (zdjety > 0)
+            niezgodne += (tasma_specjalne_liczba(zdjety - 1) != skan_specjalnych(dlugosc, zdjety - 1));
+        int s = kroki[k].stolik_specjalny;
+        if (s > 0)
+            niezgodne += (tasma_specjalne_stolika(s - 1) != 0 ||
+                          tasma_specjalne_liczba(s - 1) != skan_specjalnych(dlugosc, s - 1));
+    }
+
+    napelnij_pierscien(dlugosc, dan);
+    long long t0 = teraz_ns();
+    for (int k = 0; k < KROKI; k++)
+        niezgodne += (krok_pierscien(&kroki[k]) != 0);
+    long long t1 = teraz_ns();
+    double budz_pierscien = (double)budzenia(dlugosc) / KROKI;
+
+    int stare_kroki = 0;
+    long long t2 = teraz_ns(), t3 = t2;
+    if (dlugosc <= OBROT_MAX)
+    {
+        napelnij_stara(stara, dlugosc, dan);
+        uspij_stoliki(dlugosc);
+    }
+    while (dlugosc <= OBROT_MAX && stare_kroki < KROKI && t3 - t2 < LIMIT_STAREGO_NS)
+    {
+        const struct Krok *k = &kroki[stare_kroki++];
+        niezgodne += (stara[k->pozycja].cena == 0);
+        stara[k->pozycja].cena = 0;
+        stara[k->pozycja].stolik_specjalny = 0;
+        stara_poloz(stara, dlugosc, k->cena, k->stolik_specjalny);
+        stara_powiadom(stara, dlugosc, do_zdjecia);
+        t3 = teraz_ns();
+    }
+    double budz_obrot = stare_kroki > 0 ? (double)budzenia(dlugosc) / stare_kroki : 0.0;
+
+    // Tyle samo kroków na pierścieniu i porównanie pozycja po pozycji.
+    napelnij_pierscien(dlugosc, dan);
+    for (int k = 0; k < stare_kroki; k++)
+        krok_pierscien(&kroki[k]);
+    for (int p = 0; p < dlugosc && stare_kroki > 0; p++)
+    {
+        const struct Talerzyk *t = tasma_pozycja(p);
+        niezgodne += (t->cena != stara[p].cena || t->stolik_specjalny != stara[p].stolik_specjalny);
+    }
+
+    // Szukanie dania specjalnego. Oba sposoby muszą się zgadzać co do tego,
+    // czy danie jest; lista daje najnowsze, skan najbliższe pozycji 0.
+    int skany = (int)(20000000LL / dlugosc);
+    skany = skany < 200 ? 200 : (skany > KROKI ? KROKI : skany);
+    for (int k = 0; k < KROKI; k++)
+        kroki[k].pozycja = (int)(rand_r(ziarno) % (unsigned)dlugosc);
+    volatile int wynik = 0;
+    long long t4 = teraz_ns();
+    for (int k = 0; k < skany; k++)
+        wynik += skan_pierwszego_specjalnego(dlugosc, kroki[k].pozycja);
+    long long t5 = teraz_ns();
+    for (int k = 0; k < KROKI; k++)
+        wynik += tasma_specjalne_stolika(kroki[k].pozycja);
+    long long t6 = teraz_ns();
+    (void)wynik;
+    for (int k = 0; k < skany; k++)
+    {
+        int s = kroki[k].pozycja;
+        int p = tasma_specjalne_stolika(s);
+        niezgodne += ((p < 0) != (skan_pierwszego_specjalnego(dlugosc, s) < 0));
+        niezgodne += (p >= 0 && tasma_pozycja(p)->stolik_specjalny != s + 1);
+    }
+
+    char obrot[32] = "-", przysp[32] = "-", budz[32] = "-";
+    double ns_pierscien = (double)(t1 - t0) / KROKI;
+    if (stare_kroki > 0)
+    {
+        double ns_obrot = (double)(t3 - t2) / stare_kroki;
+        snprintf(obrot, sizeof(obrot), "%.1f", ns_obrot);
+        snprintf(przysp, sizeof(przysp), "%.1fx", ns_pierscien > 0 ? ns_obrot / ns_pierscien : 0.0);
+        snprintf(budz, sizeof(budz), "%.1f", budz_obrot);
+    }
+    printf("%8d %7d%% %12s %12.1f %11s %8s %8.1f %14.1f %14.1f %s\n", dlugosc, procent, obrot,
+           ns_pierscien, przysp, budz, budz_pierscien, (double)(t5 - t4) / skany,
+           (double)(t6 - t5) / KROKI, niezgodne ? "NIEZGODNE" : "zgodne");
+
+    free(kroki);
+    free(do_zdjecia);
+    free(budziki);
+    free(czekajace);
+    free(zwykle);
+    free(nastepny);
+    free(specjalne);
+    free(indeks);
+    free(stara);
+    free(tasma);
+    return niezgodne;
+}
+
+int main(int argc, char **argv)
+{
+    static const int domyslne[] = {150, 1500, 15000};
+    unsigned int ziarno = 7;
+    int niezgodne = 0;
+    int n = argc > 1 ? argc - 1 : (int)(sizeof(domyslne) / sizeof(domyslne[0]));
+
+    printf("%8s %8s %12s %12s %11s %8s %8s %14s %14s\n", "tasma", "zapeln.", "dawne [ns]",
+           "nowe [ns]", "przyspiesz.", "budz.d.", "budz.n.", "spec.skan [ns]", "spec.lista [ns]");
+    for (int a = 0; a < n; a++)
+    {
+        int dlugosc = argc > 1 ? atoi(argv[a + 1]) : domyslne[a];
+        if (dlugosc < 1 || dlugosc > DLUGOSC_TASMY_MAX)
+        {
+            fprintf(stderr, "Długość taśmy poza zakresem 1..%d: %s\n", DLUGOSC_TASMY_MAX,
+                    argv[a + 1]);
+            return 2;
+        }
+        niezgodne += przebieg(dlugosc, 50, &ziarno);
+        niezgodne += przebieg(dlugosc, 100, &ziarno);
+    }
+    return niezgodne ? 1 : 0;
+}
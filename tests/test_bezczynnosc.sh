@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Bezczynna restauracja (jedna grupa na cały przebieg) nie może palić CPU:
+# żadna rola nie ma prawa przekroczyć MAX_PROC % rdzenia. Zamknięcie po
+# czasie pracy nie może się ciągnąć dłużej niż MAX_ZAMKNIECIE_MS.
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+cd "$ROOT_DIR"
+
+MAX_PROC="${MAX_PROC:-10}"
+MAX_ZAMKNIECIE_MS="${MAX_ZAMKNIECIE_MS:-1500}"
+LOG_FILE="${LOG_FILE:-/tmp/restauracja_bezczynnosc.log}"
+
+make >/dev/null
+
+rm -f "$LOG_FILE"
+set +e
+start_ns="$(date +%s%N)"
+RESTAURACJA_PRZYBYCIA=staly RESTAURACJA_TEMPO=0.2 RESTAURACJA_SEED=123 \
+  RESTAURACJA_LOG_FILE="$LOG_FILE" RESTAURACJA_LOG_STDIO=0 \
+  timeout 30 ./build/bin/restauracja 1 3 >/dev/null
+rc=$?
+zamkniecie_ms=$((($(date +%s%N) - start_ns) / 1000000 - 3000))
+set -e
+if [[ $rc -ne 0 ]]; then
+  echo "[bezczynnosc] FAIL: restauracja exit code=$rc"
+  exit 1
+fi
+echo "[bezczynnosc] zamknięcie po czasie pracy: ${zamkniecie_ms} ms"
+if ((zamkniecie_ms > MAX_ZAMKNIECIE_MS)); then
+  echo "[bezczynnosc] FAIL: zamknięcie trwało ${zamkniecie_ms} ms (> ${MAX_ZAMKNIECIE_MS} ms)"
+  exit 1
+fi
+
+line="$(grep -a "Zajętość CPU wg roli" "$LOG_FILE" || true)"
+if [[ -z "$line" ]]; then
+  echo "[bezczynnosc] FAIL: brak linii zajętości CPU w $LOG_FILE"
+  exit 1
+fi
+echo "[bezczynnosc] $line"
+
+# Wyciągnij pary "rola X.Y%" i porównaj z progiem.
+bad="$(echo "${line#*): }" | tr ',' '\n' |
+  awk -v max="$MAX_PROC" '{ v = $2; sub("%", "", v); if (v + 0 > max) print $1 "=" v "%" }')"
+if [[ -n "$bad" ]]; then
+  echo "[bezczynnosc] FAIL: zajętość powyżej ${MAX_PROC}%: $bad"
+  exit 1
+fi
+
+echo "[bezczynnosc] OK"
@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Każde zaplecze segmentu (sysv, memfd, posix) musi dać dzieciom ten sam
+# układ: grupy obsłużone, podsumowanie z nazwą zaplecza, bez resztek w /dev/shm.
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+cd "$ROOT_DIR"
+
+WAIT_SEC="${WAIT_SEC:-30}"
+LOG_FILE="${LOG_FILE:-/tmp/restauracja_segment.log}"
+
+make >/dev/null
+
+for backend in sysv memfd posix; do
+  rm -f "$LOG_FILE"
+  set +e
+  RESTAURACJA_SHM="$backend" RESTAURACJA_SHM_PREFAULT=populate \
+    RESTAURACJA_LOG_FILE="$LOG_FILE" RESTAURACJA_LOG_STDIO=0 RESTAURACJA_SEED=123 \
+    timeout "$WAIT_SEC" ./build/bin/restauracja 100 2 >/dev/null
+  rc=$?
+  set -e
+  if [[ $rc -ne 0 ]]; then
+    echo "[segment] FAIL: RESTAURACJA_SHM=$backend exit code=$rc"
+    exit 1
+  fi
+  if ! grep -aq "Segment: $backend" "$LOG_FILE"; then
+    echo "[segment] FAIL: brak podsumowania segmentu $backend"
+    exit 1
+  fi
+  if ! grep -aq "Grupy obsłużone: 100 " "$LOG_FILE"; then
+    echo "[segment] FAIL: $backend nie obsłużył wszystkich grup"
+    grep -a "Grupy obsłużone" "$LOG_FILE" || true
+    exit 1
+  fi
+done
+
+if ls /dev/shm 2>/dev/null | grep -q '^restauracja\.'; then
+  echo "[segment] FAIL: pozostałości shm_open w /dev/shm"
+  exit 1
+fi
+
+echo "[segment] OK"
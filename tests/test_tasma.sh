@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Pierścień taśmy kładzie dania tam, gdzie dawny obrót całej tablicy, indeks
+# wolnych pozycji wskazuje najwyższą wolną pozycję, a listy dań specjalnych
+# stolików zgadzają się z taśmą — także na granicach słów mapy bitowej
+# (63/64/65, 4095/4096/4097, 262143/262144/262145).
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+cd "$ROOT_DIR"
+
+make -s build/bin/bench_tasma
+if ! out="$(./build/bin/bench_tasma 1 2 63 64 65 4095 4096 4097 262143 262144 262145)"; then
+  echo "$out"
+  echo "[tasma] FAIL: pierścień niezgodny z obrotem taśmy"
+  exit 1
+fi
+echo "[tasma] OK"
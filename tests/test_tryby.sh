@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+cd "$ROOT_DIR"
+
+WAIT_SEC="${WAIT_SEC:-15}"
+LOG_FILE="${LOG_FILE:-/tmp/restauracja_tryby.log}"
+OUT_FILE="${OUT_FILE:-/tmp/restauracja_tryby.out}"
+
+make clean && make
+
+# Każdy tryb klientów musi obsłużyć grupy i zakończyć się w limicie czasu.
+for tryb in procesy korutyny pula zygota; do
+  rm -f "$LOG_FILE" "$OUT_FILE"
+  echo "[tryby] run RESTAURACJA_TRYB_KLIENTOW=$tryb"
+  set +e
+  RESTAURACJA_TRYB_KLIENTOW="$tryb" RESTAURACJA_LOG_FILE="$LOG_FILE" RESTAURACJA_LOG_STDIO=0 \
+    RESTAURACJA_SEED=123 RESTAURACJA_DISABLE_MANAGER_CLOSE=1 \
+    timeout "${WAIT_SEC}" ./build/bin/restauracja 200 2 1 >"$OUT_FILE" 2>&1
+  rc=$?
+  set -e
+
+  if [[ $rc -ne 0 ]]; then
+    echo "[tryby] FAIL: tryb=$tryb exit code=$rc"
+    exit 1
+  fi
+
+  if ! grep -q "Tryb klientów: $tryb" "$OUT_FILE"; then
+    echo "[tryby] FAIL: brak podsumowania trybu $tryb"
+    exit 1
+  fi
+
+  przyjeci="$(sed -n 's/.*Klienci przyjęci: \([0-9]*\).*/\1/p' "$OUT_FILE" | tail -1)"
+  if [[ -z "$przyjeci" || "$przyjeci" -le 0 ]]; then
+    echo "[tryby] FAIL: tryb=$tryb nie przyjął żadnych klientów"
+    exit 1
+  fi
+  echo "[tryby] $tryb: przyjęto $przyjeci klientów"
+done
+
+echo "[tryby] OK"
@@ -0,0 +1,72 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Raport układu shm: każdy region od granicy linii cache, bez wspólnych linii.
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+cd "$ROOT_DIR"
+
+for grupy in 1 1000 100000; do
+  if ! out="$(make -s uklad UKLAD_GRUPY=$grupy)"; then
+    echo "$out"
+    echo "[uklad] FAIL: błędny układ dla $grupy grup"
+    exit 1
+  fi
+done
+
+# Wymiary sali z env trafiają do nagłówka i rozmiaru regionów.
+out="$(RESTAURACJA_STOLIKI=1,2,3,4 RESTAURACJA_TASMA=7 RESTAURACJA_GRUP_NA_STOLIKU=2 \
+  make -s uklad UKLAD_GRUPY=10)"
+if ! grep -q "^Sala: 10 stolików (1/2/3/4), taśma 7, grup na stolik 2" <<<"$out"; then
+  echo "$out"
+  echo "[uklad] FAIL: wymiary z env nie trafiły do nagłówka"
+  exit 1
+fi
+duza="$(RESTAURACJA_STOLIKI=500,500,500,500 make -s uklad UKLAD_GRUPY=10)"
+if ! grep -q "^Sala: 2000 stolików (500/500/500/500), taśma 2000, grup na stolik 4" <<<"$duza"; then
+  echo "$duza"
+  echo "[uklad] FAIL: duża sala"
+  exit 1
+fi
+bledne="$(RESTAURACJA_STOLIKI=1,x RESTAURACJA_TASMA=0 make -s uklad UKLAD_GRUPY=10 2>/dev/null)"
+if ! grep -q "^Sala: 40 stolików (10/10/10/10), taśma 150, grup na stolik 4" <<<"$bledne"; then
+  echo "$bledne"
+  echo "[uklad] FAIL: błędne wymiary nie wróciły do domyślnych"
+  exit 1
+fi
+
+# Mała sala i krótka taśma w prawdziwym przebiegu.
+set +e
+log="$(RESTAURACJA_STOLIKI=2,2,0,1 RESTAURACJA_TASMA=5 RESTAURACJA_GRUP_NA_STOLIKU=1 \
+  RESTAURACJA_LOG_LEVEL=0 RESTAURACJA_SEED=5 timeout 30 ./build/bin/restauracja 40 2 2>&1)"
+rc=$?
+set -e
+if [[ $rc -ne 0 ]] || ! grep -q "^Sala: 5 stolików (1/2/3/4-os.: 2/2/0/1), taśma 5, grup na stolik 1" <<<"$log" ||
+  ! grep -qE "^Grupy obsłużone: [1-9]" <<<"$log"; then
+  echo "$log" | tail -n 40
+  echo "[uklad] FAIL: przebieg z małą salą (rc=$rc)"
+  exit 1
+fi
+
+# Cztery szatnie, jedna bez stolików: jej grupy (3-os.) idą do następnej.
+# Bez RESTAURACJA_SEED, żeby grupy miały różne wielkości.
+szatnie="$(RESTAURACJA_STOLIKI=2,2,0,1 RESTAURACJA_SZATNIE=4 make -s uklad UKLAD_GRUPY=10)"
+if ! grep -q "^Sala: 5 stolików (2/2/0/1), .*, szatnie 4" <<<"$szatnie"; then
+  echo "$szatnie"
+  echo "[uklad] FAIL: liczba szatni nie trafiła do nagłówka"
+  exit 1
+fi
+set +e
+log="$(RESTAURACJA_STOLIKI=2,2,0,1 RESTAURACJA_SZATNIE=4 RESTAURACJA_LOG_LEVEL=0 \
+  timeout 30 ./build/bin/restauracja 60 2 2>&1)"
+rc=$?
+set -e
+if [[ $rc -ne 0 ]] || ! grep -q "^  szatnia 2 (bez stolików)" <<<"$log" ||
+  ! grep -qE "^  szatnia 3 \(stoliki 5-5\): usadzone grupy [1-9]" <<<"$log" ||
+  ! grep -qE "^Grupy obsłużone: [1-9]" <<<"$log"; then
+  echo "$log" | tail -n 40
+  echo "[uklad] FAIL: przebieg z czterema szatniami (rc=$rc)"
+  exit 1
+fi
+
+echo "[uklad] OK"
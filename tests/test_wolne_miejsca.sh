@@ -0,0 +1,17 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Indeks wolnych miejsc daje ten sam stolik co dawny skan first-fit, a
+# polityki usadzania to samo co ich wersje skanujące — także na granicach
+# słów mapy bitowej (63/64/65, 4095/4096/4097, 262143/262144/262145).
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+cd "$ROOT_DIR"
+
+make -s build/bin/bench_stoliki
+if ! out="$(./build/bin/bench_stoliki 1 3 63 64 65 4095 4096 4097 262143 262144 262145 400000)"; then
+  echo "$out"
+  echo "[wolne_miejsca] FAIL: indeks niezgodny ze skanem"
+  exit 1
+fi
+echo "[wolne_miejsca] OK"